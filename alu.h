@@ -0,0 +1,41 @@
+#ifndef ALU_H
+#define ALU_H
+
+#include <stdint.h>
+#include "cpu.h"
+#include "alu_tables.h"
+
+// Accumulator arithmetic by table lookup. alu_tables.h is generated at
+// build time by alugen from the flag-by-flag formulas in alu_ref.h, and
+// opcheck tests these helpers against the same formulas over all operands,
+// carries and PSW values.
+//
+// ADD, ADDC and SUBB share one table: XORing the operands with the 9-bit
+// result leaves, bit by bit, the carry (or borrow) that came into it. Bit 8
+// is CY, bit 4 is AC, and bit 7 against bit 8 is OV. DA goes by CY:AC:A.
+//
+// Each helper takes the PSW before the instruction and returns the one
+// after it.
+
+#define ALU_FLAGS (PSW_CY | PSW_AC | PSW_OV | PSW_P)
+
+static inline uint8_t alu_addc_psw(uint8_t a, uint8_t val, uint8_t carry, uint8_t psw, uint8_t *result) {
+    uint32_t sum = a + val + carry;
+    *result = (uint8_t)sum;
+    return (psw & ~ALU_FLAGS) | alu_carry_flags[(a ^ val ^ sum) & 0x1FF] | alu_parity[sum & 0xFF];
+}
+
+static inline uint8_t alu_subb_psw(uint8_t a, uint8_t val, uint8_t borrow, uint8_t psw, uint8_t *result) {
+    uint32_t diff = a - val - borrow;
+    *result = (uint8_t)diff;
+    return (psw & ~ALU_FLAGS) | alu_carry_flags[(a ^ val ^ diff) & 0x1FF] | alu_parity[diff & 0xFF];
+}
+
+// CY is only ever set by DA, never cleared
+static inline uint8_t alu_da_psw(uint8_t a, uint8_t psw, uint8_t *result) {
+    uint16_t entry = alu_da[(psw & PSW_CY ? 0x200 : 0) | (psw & PSW_AC ? 0x100 : 0) | a];
+    *result = (uint8_t)entry;
+    return (psw & ~PSW_P) | (entry >> 8);
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef ALU_REF_H
+#define ALU_REF_H
+
+#include <stdint.h>
+#include "cpu.h"
+
+// Reference formulas for the accumulator arithmetic, flag by flag as the
+// datasheet states them. alugen builds alu_tables.h from these, and
+// opcheck tests the alu.h lookups and the interpreter against them. They
+// take and return the whole PSW so that the checks cover the bits the
+// instructions must leave alone.
+
+static inline uint8_t alu_ref_parity(uint8_t a) {
+    uint8_t count = 0;
+    for (int i = 0; i < 8; i++) {
+        if (a & (1 << i)) count++;
+    }
+    return count % 2 ? PSW_P : 0;
+}
+
+// ADD is ADDC with no carry in
+static inline uint8_t alu_ref_addc(uint8_t a, uint8_t val, uint8_t carryin, uint8_t *psw) {
+    uint16_t result = a + val + carryin;
+
+    uint8_t c7 = result > 0xFF;
+    uint8_t c6 = ((a & 0x7F) + (val & 0x7F) + carryin) > 0x7F;
+    *psw &= ~(PSW_CY | PSW_AC | PSW_OV | PSW_P);
+    if (c7) *psw |= PSW_CY;
+    if (c6 ^ c7) *psw |= PSW_OV;
+    if ((a & 0x0F) + (val & 0x0F) + carryin > 0x0F) *psw |= PSW_AC;
+    *psw |= alu_ref_parity((uint8_t)result);
+    return (uint8_t)result;
+}
+
+static inline uint8_t alu_ref_subb(uint8_t a, uint8_t val, uint8_t carry, uint8_t *psw) {
+    uint16_t result = a - val - carry;
+
+    uint8_t c7 = result > 0xFF;
+    uint8_t c6 = (a & 0x7F) < ((val & 0x7F) + carry);
+    *psw &= ~(PSW_CY | PSW_AC | PSW_OV | PSW_P);
+    if (c7) *psw |= PSW_CY;
+    if ((a & 0x0F) < (val & 0x0F) + carry) *psw |= PSW_AC;
+    if (c6 ^ c7) *psw |= PSW_OV;
+    *psw |= alu_ref_parity((uint8_t)result);
+    return (uint8_t)result;
+}
+
+// CY is only ever set by DA, never cleared
+static inline uint8_t alu_ref_da(uint8_t a, uint8_t *psw) {
+    uint16_t result = a;
+    if ((result & 0x0F) > 0x09 || (*psw & PSW_AC)) result += 0x06;
+    if ((result & 0xF0) > 0x90 || (*psw & PSW_CY)) {
+        result += 0x60;
+        if (result > 0xFF) *psw |= PSW_CY;
+    }
+    *psw = (*psw & ~PSW_P) | alu_ref_parity((uint8_t)result);
+    return (uint8_t)result;
+}
+
+#endif
@@ -0,0 +1,74 @@
+// Build-time generator for alu_tables.h: the parity, carry-flag and DA
+// tables behind alu.h, built from the reference formulas in alu_ref.h.
+// opcheck tests the lookups in alu.h against the same formulas.
+//
+//   alugen alu_tables.h
+#include <stdio.h>
+#include <stdint.h>
+#include "alu_ref.h"
+
+// TABLES
+static uint8_t parity_table[256];
+static uint8_t carry_table[512];        // By a ^ b ^ result: the carries (or borrows) into bits 1-8
+static uint16_t da_table[1024];         // By CY:AC:A; result in the low byte, CY set and P above
+
+static void build(void) {
+    for (int a = 0; a < 256; a++) parity_table[a] = alu_ref_parity(a);
+
+    // CY is the carry out of bit 7, AC the carry into bit 4, OV the carry
+    // into bit 7 differing from the one out of it
+    for (int k = 0; k < 512; k++) {
+        uint8_t flags = 0;
+        if (k & 0x100) flags |= PSW_CY;
+        if (k & 0x010) flags |= PSW_AC;
+        if (((k >> 7) ^ (k >> 8)) & 1) flags |= PSW_OV;
+        carry_table[k] = flags;
+    }
+
+    for (int i = 0; i < 1024; i++) {
+        uint8_t psw = ((i & 0x200) ? PSW_CY : 0) | ((i & 0x100) ? PSW_AC : 0);
+        uint8_t result = alu_ref_da(i & 0xFF, &psw);
+        da_table[i] = result | (uint16_t)(psw & (PSW_CY | PSW_P)) << 8;
+    }
+}
+
+static void write_table(FILE *out, const char *decl, const void *table, int count, int wide) {
+    fprintf(out, "%s = {", decl);
+    for (int i = 0; i < count; i++) {
+        if (i % 16 == 0) fprintf(out, "\n   ");
+        if (wide) fprintf(out, " 0x%04X,", ((const uint16_t *)table)[i]);
+        else fprintf(out, " 0x%02X,", ((const uint8_t *)table)[i]);
+    }
+    fprintf(out, "\n};\n\n");
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s alu_tables.h\n", argv[0]);
+        return 1;
+    }
+
+    build();
+
+    FILE *out = fopen(argv[1], "w");
+    if (out == NULL) {
+        fprintf(stderr, "alugen: Could not open %s for writing\n", argv[1]);
+        return 1;
+    }
+    fprintf(out, "// Generated by alugen from the reference formulas in alu_ref.h; do not edit.\n");
+    fprintf(out, "#ifndef ALU_TABLES_H\n#define ALU_TABLES_H\n\n#include <stdint.h>\n\n");
+    fprintf(out, "// PSW_P for every accumulator value\n");
+    write_table(out, "static const uint8_t alu_parity[256]", parity_table, 256, 0);
+    fprintf(out, "// CY, AC and OV by the carries (or borrows) a ^ b ^ result of ADD/ADDC/SUBB\n");
+    write_table(out, "static const uint8_t alu_carry_flags[512]", carry_table, 512, 0);
+    fprintf(out, "// DA A by CY:AC:A: corrected A in the low byte, PSW bits to set (CY, P) above\n");
+    write_table(out, "static const uint16_t alu_da[1024]", da_table, 1024, 1);
+    fprintf(out, "#endif\n");
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "alugen: Could not write %s\n", argv[1]);
+        remove(argv[1]);
+        return 1;
+    }
+    return 0;
+}
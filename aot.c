@@ -0,0 +1,197 @@
+// Ahead-of-time translation of the loaded ROM into C, and loading the result
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+#include "aot.h"
+#include "cfg.h"
+#include "opcodes.h"
+
+uint32_t aot_rom_hash(system_8051_t *sys) {
+    uint32_t hash = 2166136261u;
+    for (uint32_t addr = 0; addr < 65536; addr++) {
+        hash ^= system_read_code(sys, addr);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// The ROM snapshot, trailing zeros left to the initializer
+static void emit_rom(system_8051_t *sys, FILE *out) {
+    int32_t last = -1;
+    for (uint32_t addr = 0; addr < 65536; addr++) {
+        if (system_read_code(sys, addr)) last = addr;
+    }
+
+    fprintf(out, "static const uint8_t aot_rom[65536] = {");
+    for (int32_t addr = 0; addr <= last; addr++) {
+        if (addr % 16 == 0) fprintf(out, "\n   ");
+        fprintf(out, " 0x%02X,", system_read_code(sys, addr));
+    }
+    fprintf(out, "\n};\n\n");
+}
+
+// When the peripherals must be caught up for an instruction (aot.h): SFRs
+// other than the core registers and ports 0-2 (no timer or interrupt
+// state), MOVX to a device page, and RETI
+static int sfr_needs_sync(uint8_t address) {
+    switch (address) {
+        case 0xE0: case 0xF0: case 0x81: case 0x82: case 0x83:
+        case 0x80: case 0x90: case 0xA0:
+            return 0;
+        default:
+            return address >= 0x80;
+    }
+}
+
+static const char *needs_sync(const uint8_t *code) {
+    const opcode_info_t *info = &opcode_table[code[0]];
+    if (info->flags & (OPF_RD_XRAM | OPF_WR_XRAM)) {
+        if (!(code[0] & 0x02)) return "AOT_SYNC_DPTR";
+        return code[0] & 0x01 ? "AOT_SYNC_R1" : "AOT_SYNC_R0";
+    }
+    if (info->flags & OPF_RETI) return "AOT_SYNC";
+    if (!(info->flags & (OPF_RD_DIRECT | OPF_WR_DIRECT))) return "0";
+
+    int byte = 1;
+    for (int o = 0; o < 3; o++) {
+        switch (info->operands[o]) {
+            case OPK_DIRECT:
+                if (sfr_needs_sync(code[byte])) return "AOT_SYNC";
+                byte++;
+                break;
+            case OPK_BIT:
+            case OPK_NBIT:
+                if (code[byte] >= 0x80 && sfr_needs_sync(code[byte] & 0xF8)) return "AOT_SYNC";
+                byte++;
+                break;
+            case OPK_IMM8:
+            case OPK_REL:
+            case OPK_ADDR11:
+                byte++;
+                break;
+            case OPK_IMM16:
+            case OPK_ADDR16:
+                byte += 2;
+                break;
+            default:
+                break;
+        }
+    }
+    return "0";
+}
+
+static void emit_block(const cfg_block_t *block, system_8051_t *sys, FILE *out) {
+    // Polling loops (DJNZ, JNB on a flag) stay inside the block; SJMP $ is
+    // left to the run loop, which treats it as a halt
+    int self_loop = block->end == CFG_END_BRANCH && block->succ[0] == block->start;
+
+    fprintf(out, "static uint64_t block_%04X(system_8051_t *sys, uint64_t budget, uint64_t cycle_limit) {\n", block->start);
+    fprintf(out, "    AOT_BEGIN\n");
+    if (self_loop) fprintf(out, "top:\n");
+
+    uint16_t pc = block->start;
+    for (uint32_t i = 0; i < block->insns; i++) {
+        uint8_t code[3];
+        char text[32];
+        for (int b = 0; b < 3; b++) code[b] = system_read_code(sys, pc + b);
+        int len = opcode_disasm(code, pc, text, sizeof(text));
+
+        // Direct writes naming 0x87 (conservatively, any operand byte)
+        int pcon = (opcode_table[code[0]].flags & OPF_WR_DIRECT) && (code[1] == 0x87 || (len == 3 && code[2] == 0x87));
+        const char *sync = needs_sync(code);
+        if (i + 1 < block->insns && pcon) fprintf(out, "    AOT_INSN_PCON(0x%04X, 0x%04X)  // %s\n", pc, (uint16_t)(pc + len), text);
+        else if (i + 1 < block->insns) fprintf(out, "    AOT_INSN(0x%04X, 0x%04X, %s)  // %s\n", pc, (uint16_t)(pc + len), sync, text);
+        else fprintf(out, "    AOT_EXEC(0x%04X, %s)  // %s\n", pc, sync, text);
+        pc += len;
+    }
+    if (self_loop) fprintf(out, "    if (sys->cpu.PC == 0x%04X) goto top;\n", block->start);
+    fprintf(out, "    AOT_RETURN;\n}\n\n");
+}
+
+int aot_emit(system_8051_t *sys, const char *path, const char *source) {
+    cfg_t *cfg = cfg_build(sys);
+    if (cfg == NULL) return 1;
+
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        printf("Error: Could not open %s\n", path);
+        cfg_free(cfg);
+        return 1;
+    }
+
+    fprintf(out, "// Translated from %s for the %s core by --aot-emit; do not edit.\n", source, sys->variant->name);
+    fprintf(out, "// Build with the emulator sources on the include path:\n");
+    fprintf(out, "//   cc -O2 -shared -fPIC -I<emulator> this.c -o this.so\n");
+    fprintf(out, "#define CPU_AOT 1\n");
+    fprintf(out, "#include \"system.h\"\n\n");
+    emit_rom(sys, out);
+    fprintf(out, "#include \"cpu.c\"\n\n");
+    fprintf(out, "#define AOT_MODE CPU_MODE_VARIANT(%d)\n", (int)(sys->variant - cpu_variant_get(CPU_8051)));
+    fprintf(out, "#include \"aot.h\"\n\n");
+
+    for (uint32_t b = 0; b < cfg->block_count; b++) emit_block(&cfg->blocks[b], sys, out);
+
+    fprintf(out, "static const aot_block_t blocks[] = {\n");
+    for (uint32_t b = 0; b < cfg->block_count; b++) {
+        fprintf(out, "    { 0x%04X, %u, block_%04X },\n", cfg->blocks[b].start, cfg->blocks[b].size, cfg->blocks[b].start);
+    }
+    fprintf(out, "};\n\n");
+    fprintf(out, "const aot_image_t aot_image = { %d, \"%s\", 0x%08Xu, %u, blocks };\n",
+            AOT_ABI_VERSION, sys->variant->name, aot_rom_hash(sys), cfg->block_count);
+
+    printf("Translated %u blocks (%u instructions) to %s\n", cfg->block_count, cfg->insn_count, path);
+    fclose(out);
+    cfg_free(cfg);
+    return 0;
+}
+
+aot_map_t *aot_load(system_8051_t *sys, const char *path) {
+    // dlopen() looks a bare name up in the library path, not here
+    char local[4096];
+    const char *open_path = path;
+    if (strchr(path, '/') == NULL) {
+        snprintf(local, sizeof(local), "./%s", path);
+        open_path = local;
+    }
+
+    void *handle = dlopen(open_path, RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL) {
+        printf("Error: Could not load %s: %s\n", path, dlerror());
+        return NULL;
+    }
+
+    const aot_image_t *image = dlsym(handle, "aot_image");
+    const char *problem = NULL;
+    if (image == NULL) problem = "no aot_image symbol";
+    else if (image->abi != AOT_ABI_VERSION) problem = "built for another emulator version";
+    else if (strcmp(image->variant, sys->variant->name) != 0) problem = "built for another core variant";
+    else if (image->rom_hash != aot_rom_hash(sys)) problem = "built from a different ROM image";
+
+    aot_map_t *map = problem ? NULL : calloc(1, sizeof(aot_map_t));
+    if (map == NULL) {
+        printf("Error: Not using %s: %s\n", path, problem ? problem : "out of memory");
+        dlclose(handle);
+        return NULL;
+    }
+
+    map->handle = handle;
+    map->image = image;
+    for (uint32_t b = 0; b < image->block_count; b++) {
+        map->table[image->blocks[b].start] = image->blocks[b].fn;
+    }
+    return map;
+}
+
+void aot_close(aot_map_t *map) {
+    if (map == NULL) return;
+    dlclose(map->handle);
+    free(map);
+}
+
+void aot_invalidate(aot_map_t *map, uint16_t address) {
+    for (uint32_t b = 0; b < map->image->block_count; b++) {
+        const aot_block_t *block = &map->image->blocks[b];
+        if ((uint16_t)(address - block->start) < block->size) map->table[block->start] = NULL;
+    }
+}
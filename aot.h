@@ -0,0 +1,144 @@
+#ifndef AOT_H
+#define AOT_H
+
+#include <stdint.h>
+#include "system.h"
+
+// Ahead-of-time translated ROM images. `--aot-emit` writes one C function per
+// basic block of the control-flow graph (cfg.h); the host compiler builds it
+// into a shared object that `--aot` loads with dlopen. The run loop calls a
+// block whenever PC sits on the start of one and interprets everything else.
+//
+//   ./emulator --aot-emit fw.c fw.hex && make fw.so && ./emulator --aot fw.so fw.hex
+
+#define AOT_ABI_VERSION 3
+
+// Runs the block at its start address: at most `budget` instructions, none
+// started at or after `cycle_limit`. Returns the number executed; stops early
+// when control leaves the straight line (interrupts included).
+typedef uint64_t (*aot_block_fn)(system_8051_t *sys, uint64_t budget, uint64_t cycle_limit);
+
+typedef struct {
+    uint16_t start;
+    uint16_t size;          // Bytes of code covered
+    aot_block_fn fn;
+} aot_block_t;
+
+// Exported by every translated image as `aot_image`
+typedef struct {
+    uint32_t abi;           // AOT_ABI_VERSION
+    const char *variant;    // Core it was translated for
+    uint32_t rom_hash;      // aot_rom_hash() of the code it was translated from
+    uint32_t block_count;
+    const aot_block_t *blocks;
+} aot_image_t;
+
+typedef struct aot_map {
+    void *handle;
+    const aot_image_t *image;
+    aot_block_fn table[65536];  // By start address, NULL = interpret
+} aot_map_t;
+
+// FNV-1a over the 64K code view seen by the CPU
+uint32_t aot_rom_hash(system_8051_t *sys);
+
+// Writes the translation of the current code view to `path`. Returns 0 on
+// success.
+int aot_emit(system_8051_t *sys, const char *path, const char *source);
+
+// Loads a translated image and checks it against the variant and the code.
+// NULL (with a message) on any mismatch.
+aot_map_t *aot_load(system_8051_t *sys, const char *path);
+void aot_close(aot_map_t *map);
+
+// Drops the blocks covering a code address that has been written
+void aot_invalidate(aot_map_t *map, uint16_t address);
+
+#ifdef CPU_AOT
+// One instruction with the same results as the interpreter's run loop.
+// Only used by translated images, after cpu.c has been included.
+//
+// The peripherals are not stepped after every instruction. Inside a block
+// the clocks add up in `lag` and are handed to peripherals_step() in one go
+// (which is exact for any number of clocks) when they reach `horizon`: the
+// next point at which a timer or the serial port could raise a request that
+// would be taken, or finish a frame (peripherals_next_event()). Flags that
+// cannot interrupt are set late, when nothing has looked at them yet.
+// The peripherals also catch up before and after any instruction that
+// could tell the difference (`sync`, decided by the translator), before an
+// interrupt is taken, and on leaving the block.
+#define AOT_SYNC        1   // Always
+#define AOT_SYNC_DPTR   2   // MOVX @DPTR, if it goes to a device page
+#define AOT_SYNC_R0     3   // MOVX @R0, same
+#define AOT_SYNC_R1     4   // MOVX @R1, same
+
+#define AOT_BEGIN \
+    uint64_t n = 0; \
+    uint64_t lag = 0; \
+    uint64_t horizon = aot_horizon(sys);
+
+#define AOT_RETURN \
+    do { \
+        if (lag) peripherals_step(sys, lag); \
+        return n; \
+    } while (0)
+
+#define AOT_EXEC(pc, sync) \
+    if (n == budget || sys->cpu.cycles >= cycle_limit) AOT_RETURN; \
+    sys->cpu.PC = (pc); \
+    aot_step(sys, &lag, &horizon, sync); \
+    n++;
+
+// Every instruction but the last must fall through to the next one
+#define AOT_INSN(pc, next, sync) \
+    AOT_EXEC(pc, sync) \
+    if (sys->cpu.PC != (uint16_t)(next)) AOT_RETURN;
+
+// Same, for an instruction that may write PCON: idle and power-down are
+// left to the run loop
+#define AOT_INSN_PCON(pc, next) \
+    AOT_EXEC(pc, AOT_SYNC) \
+    if (sys->cpu.PC != (uint16_t)(next) || (sys->sfr.PCON & PCON_SLEEP)) AOT_RETURN;
+
+// Clocks the peripherals can be left behind by
+CPU_INLINE uint64_t aot_horizon(system_8051_t *sys) {
+    // A byte already waiting on the serial input starts in at the next step
+    const uart_state_t *uart = &sys->uart;
+    if (uart->rxq && !uart->rx_busy && (sys->sfr.SCON & (SCON_REN | SCON_RI)) == SCON_REN && spsc_count(uart->rxq)) return 0;
+
+    // Enabled sources, blocked or not, so that latency stamps stay exact
+    uint8_t enabled = (sys->sfr.IE & IE_EA) ? sys->sfr.IE & (sys->variant->has_timer2 ? 0x3F : 0x1F) : 0;
+    return peripherals_next_event(sys, enabled);
+}
+
+CPU_INLINE void aot_catch_up(system_8051_t *sys, uint64_t *lag, uint64_t *horizon) {
+    if (*lag) peripherals_step(sys, *lag);
+    *lag = 0;
+    *horizon = aot_horizon(sys);
+}
+
+// Devices may look at anything, timers included
+CPU_INLINE int aot_needs_sync(system_8051_t *sys, const int sync) {
+    if (sync <= AOT_SYNC) return sync;
+    uint16_t address = sync == AOT_SYNC_DPTR ? sys->cpu.DPTR
+                     : (uint16_t)(sys->sfr.P2 << 8 | sys->iram[(sys->cpu.PSW & 0x18) | (sync - AOT_SYNC_R0)]);
+    return sys->xdata[address >> XDATA_PAGE_SHIFT].mem == NULL;
+}
+
+CPU_INLINE void aot_step(system_8051_t *sys, uint64_t *lag, uint64_t *horizon, const int sync) {
+    int catch_up = aot_needs_sync(sys, sync);
+    if (catch_up && *lag) {
+        peripherals_step(sys, *lag);
+        *lag = 0;
+    }
+    uint64_t prev_cycles = sys->cpu.cycles;
+    cpu_exec(sys, AOT_MODE);
+    sys->cpu.instructions++;
+    *lag += sys->cpu.cycles - prev_cycles;
+    if (catch_up || *lag >= *horizon || sys->irq.pending) aot_catch_up(sys, lag, horizon);
+    if (sys->irq.pending) interrupt_dispatch(sys);
+    else sys->irq.hold = 0;
+}
+#endif
+
+#endif
@@ -0,0 +1,215 @@
+// Host performance counters around emulation batches
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "bench.h"
+#include "opcodes.h"
+
+static const char *class_names[BENCH_CLASSES] = { "ALU", "bit ops", "MOVX", "branches", "SFR access", "other" };
+static const char *counter_names[BENCH_COUNTERS] = { "ns", "cycles", "instructions", "branch misses", "L1d misses" };
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} counter_events[BENCH_COUNTERS] = {
+    [BENCH_CYCLES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    [BENCH_INSTRUCTIONS] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    [BENCH_BRANCH_MISSES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    [BENCH_L1D_MISSES] = { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                           (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+};
+
+static const char *alu_mnemonics[] = {
+    "ADD", "ADDC", "SUBB", "INC", "DEC", "MUL", "DIV", "DA", "ANL", "ORL", "XRL",
+    "CLR", "CPL", "RL", "RLC", "RR", "RRC", "SWAP"
+};
+
+// User-space only, so perf_event_paranoid up to 2 still allows it
+static int counter_open(bench_counter_t counter) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = counter_events[counter].type;
+    attr.config = counter_events[counter].config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void read_counters(const int *fds, double *values) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    values[BENCH_NS] = ts.tv_sec * 1e9 + ts.tv_nsec;
+
+    for (int c = BENCH_CYCLES; c < BENCH_COUNTERS; c++) {
+        uint64_t value = 0;
+        if (fds[c] >= 0 && read(fds[c], &value, sizeof(value)) != sizeof(value)) value = 0;
+        values[c] = value;
+    }
+}
+
+// Class of the instruction at PC. Branches win over everything else, then
+// MOVX, then a direct or bit operand above 0x7F.
+static bench_class_t classify(system_8051_t *sys, uint16_t pc) {
+    uint8_t opcode = system_read_code(sys, pc);
+    const opcode_info_t *info = &opcode_table[opcode];
+
+    if (info->flags & (OPF_CONTROL | OPF_INDIRECT_JUMP)) return BENCH_BRANCH;
+    if (info->flags & (OPF_RD_XRAM | OPF_WR_XRAM)) return BENCH_MOVX;
+
+    // A direct or bit address is always the first operand byte (MOV dir,dir
+    // has a second one)
+    int bit = 0, addressed = info->flags & (OPF_RD_DIRECT | OPF_WR_DIRECT);
+    for (int i = 0; i < 3; i++) {
+        if (info->operands[i] == OPK_BIT || info->operands[i] == OPK_NBIT) addressed = bit = 1;
+        if (info->operands[i] == OPK_C) bit = 1;
+    }
+    if (addressed && (system_read_code(sys, pc + 1) >= 0x80 || (opcode == 0x85 && system_read_code(sys, pc + 2) >= 0x80))) {
+        return BENCH_SFR;
+    }
+    if (bit) return BENCH_BIT;
+
+    for (size_t i = 0; i < sizeof(alu_mnemonics) / sizeof(alu_mnemonics[0]); i++) {
+        if (strcmp(info->mnemonic, alu_mnemonics[i]) == 0) return BENCH_ALU;
+    }
+    return BENCH_OTHER;
+}
+
+// Solves the normal equations A x = b for every counter column of b, shrunk
+// towards the mean cost `prior`: classes that barely vary between batches
+// would otherwise soak up the timing noise
+static void solve(double a[BENCH_CLASSES][BENCH_CLASSES], double b[BENCH_CLASSES][BENCH_COUNTERS], const double *prior) {
+    double trace = 0;
+    for (int i = 0; i < BENCH_CLASSES; i++) trace += a[i][i];
+    double ridge = trace * 1e-3 / BENCH_CLASSES + 1e-9;
+    for (int i = 0; i < BENCH_CLASSES; i++) {
+        a[i][i] += ridge;
+        for (int k = 0; k < BENCH_COUNTERS; k++) b[i][k] += ridge * prior[k];
+    }
+
+    for (int col = 0; col < BENCH_CLASSES; col++) {
+        int pivot = col;
+        for (int r = col + 1; r < BENCH_CLASSES; r++) {
+            if (a[r][col] * a[r][col] > a[pivot][col] * a[pivot][col]) pivot = r;
+        }
+        for (int k = 0; k < BENCH_CLASSES; k++) {
+            double t = a[col][k]; a[col][k] = a[pivot][k]; a[pivot][k] = t;
+        }
+        for (int k = 0; k < BENCH_COUNTERS; k++) {
+            double t = b[col][k]; b[col][k] = b[pivot][k]; b[pivot][k] = t;
+        }
+
+        for (int r = 0; r < BENCH_CLASSES; r++) {
+            if (r == col) continue;
+            double f = a[r][col] / a[col][col];
+            for (int k = 0; k < BENCH_CLASSES; k++) a[r][k] -= f * a[col][k];
+            for (int k = 0; k < BENCH_COUNTERS; k++) b[r][k] -= f * b[col][k];
+        }
+    }
+    for (int r = 0; r < BENCH_CLASSES; r++) {
+        for (int k = 0; k < BENCH_COUNTERS; k++) b[r][k] /= a[r][r];
+    }
+}
+
+void bench_run(system_8051_t *sys, uint64_t max_insns, uint64_t batch, bench_result_t *result) {
+    int fds[BENCH_COUNTERS];
+    double ata[BENCH_CLASSES][BENCH_CLASSES] = { { 0 } };
+    double aty[BENCH_CLASSES][BENCH_COUNTERS] = { { 0 } };
+
+    memset(result, 0, sizeof(*result));
+    result->available[BENCH_NS] = 1;
+    fds[BENCH_NS] = -1;
+    for (int c = BENCH_CYCLES; c < BENCH_COUNTERS; c++) {
+        fds[c] = counter_open(c);
+        result->available[c] = fds[c] >= 0;
+        if (fds[c] >= 0) {
+            ioctl(fds[c], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fds[c], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    if (batch == 0) batch = BENCH_DEFAULT_BATCH;
+
+    int halted = 0;
+    while (result->instructions < max_insns && !halted) {
+        uint64_t counts[BENCH_CLASSES] = { 0 };
+        double before[BENCH_COUNTERS], after[BENCH_COUNTERS];
+        uint64_t n = 0;
+
+        read_counters(fds, before);
+        while (n < batch && result->instructions + n < max_insns) {
+            if (system_halted(sys)) {
+                halted = 1;
+                break;
+            }
+            counts[classify(sys, sys->cpu.PC)]++;
+            system_step(sys);
+            n++;
+        }
+        read_counters(fds, after);
+        if (n == 0) break;
+
+        result->batches++;
+        result->instructions += n;
+        for (int i = 0; i < BENCH_CLASSES; i++) {
+            result->class_count[i] += counts[i];
+            for (int j = 0; j < BENCH_CLASSES; j++) ata[i][j] += (double)counts[i] * counts[j];
+        }
+        for (int c = 0; c < BENCH_COUNTERS; c++) {
+            double delta = after[c] - before[c];
+            result->total[c] += delta;
+            for (int i = 0; i < BENCH_CLASSES; i++) aty[i][c] += counts[i] * delta;
+        }
+    }
+
+    for (int c = BENCH_CYCLES; c < BENCH_COUNTERS; c++) {
+        if (fds[c] >= 0) close(fds[c]);
+    }
+
+    double prior[BENCH_COUNTERS];
+    for (int c = 0; c < BENCH_COUNTERS; c++) prior[c] = result->instructions ? result->total[c] / result->instructions : 0;
+    if (result->batches >= BENCH_MIN_BATCHES) solve(ata, aty, prior);
+    for (int i = 0; i < BENCH_CLASSES; i++) {
+        for (int c = 0; c < BENCH_COUNTERS; c++) {
+            if (result->class_count[i] == 0) result->per_class[i][c] = 0;
+            else result->per_class[i][c] = result->batches >= BENCH_MIN_BATCHES ? aty[i][c] : prior[c];
+        }
+    }
+}
+
+void bench_print(const bench_result_t *result) {
+    double insns = result->instructions ? (double)result->instructions : 1;
+
+    printf("\n| HOST COST           | %lu instructions in %lu batches\n", result->instructions, result->batches);
+    printf("|---------------------+--------------------------------------------\n");
+    for (int c = 0; c < BENCH_COUNTERS; c++) {
+        if (!result->available[c]) {
+            printf("| %-19s : unavailable\n", counter_names[c]);
+            continue;
+        }
+        printf("| %-19s : %.0f total, %.2f per instruction\n", counter_names[c], result->total[c], result->total[c] / insns);
+    }
+
+    printf("|---------------------+--------------------------------------------\n");
+    printf("| Per instruction     :  share");
+    for (int c = 0; c < BENCH_COUNTERS; c++) {
+        if (result->available[c]) printf(" %14s", counter_names[c]);
+    }
+    printf("\n");
+    for (int i = 0; i < BENCH_CLASSES; i++) {
+        printf("| %-19s : %5.1f%%", class_names[i], 100.0 * result->class_count[i] / insns);
+        for (int c = 0; c < BENCH_COUNTERS; c++) {
+            if (!result->available[c]) continue;
+            if (result->class_count[i]) printf(" %14.2f", result->per_class[i][c]);
+            else printf(" %14s", "-");
+        }
+        printf("\n");
+    }
+    if (result->batches < BENCH_MIN_BATCHES) printf("| (too few batches for a fit: every class shows the mean)\n");
+    else printf("| (least-squares fit over batches; classification is included in every class)\n");
+}
@@ -0,0 +1,50 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include "system.h"
+
+// Host cost of the interpreter. Emulation runs in batches; around each batch
+// the host counters (perf_event_open) and wall-clock time are read, and the
+// executed instructions are counted by class. A least-squares fit over the
+// batches then gives the host cost per emulated instruction of each class.
+// Counters the kernel refuses (unprivileged containers) are skipped; wall
+// clock is always there.
+
+#define BENCH_DEFAULT_BATCH 4096    // Emulated instructions per batch
+#define BENCH_MIN_BATCHES   64      // Fewer and only the averages are reported
+
+typedef enum {
+    BENCH_ALU,          // Arithmetic and logic on A, registers and RAM
+    BENCH_BIT,          // Bit operands and C
+    BENCH_MOVX,
+    BENCH_BRANCH,       // Jumps, calls, returns, conditional branches
+    BENCH_SFR,          // Direct or bit access in the SFR space
+    BENCH_OTHER,        // Moves, stack, MOVC, NOP
+    BENCH_CLASSES
+} bench_class_t;
+
+typedef enum {
+    BENCH_NS,
+    BENCH_CYCLES,
+    BENCH_INSTRUCTIONS,
+    BENCH_BRANCH_MISSES,
+    BENCH_L1D_MISSES,
+    BENCH_COUNTERS
+} bench_counter_t;
+
+typedef struct {
+    uint64_t batches;
+    uint64_t instructions;
+    uint64_t class_count[BENCH_CLASSES];
+    uint8_t available[BENCH_COUNTERS];
+    double total[BENCH_COUNTERS];
+    double per_class[BENCH_CLASSES][BENCH_COUNTERS];   // Fitted cost per instruction
+} bench_result_t;
+
+// Runs up to `max_insns` instructions (stopping at SJMP $) in batches of
+// `batch` and fills `result`
+void bench_run(system_8051_t *sys, uint64_t max_insns, uint64_t batch, bench_result_t *result);
+void bench_print(const bench_result_t *result);
+
+#endif
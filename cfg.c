@@ -0,0 +1,488 @@
+// Static ROM analysis: recursive descent from the vectors, then basic blocks,
+// functions and data-in-code regions. Everything is derived from opcodes.def.
+#include <stdlib.h>
+#include <string.h>
+#include "cfg.h"
+#include "opcodes.h"
+
+#define JUMP_TABLE_MAX 128      // Entries followed after a JMP @A+DPTR
+
+static const struct {
+    uint16_t addr;
+    const char *name;
+} vectors[] = {
+    { VECTOR_RESET, "reset" },
+    { VECTOR_INT0, "int0" },
+    { VECTOR_TIMER0, "timer0" },
+    { VECTOR_INT1, "int1" },
+    { VECTOR_TIMER1, "timer1" },
+    { VECTOR_SERIAL, "serial" },
+    { VECTOR_TIMER2, "timer2" },
+};
+
+#define VECTOR_COUNT (sizeof(vectors) / sizeof(vectors[0]))
+
+// Growable array of 16/32-bit values, for worklists and the result tables
+typedef struct {
+    void *items;
+    uint32_t count;
+    uint32_t capacity;
+} list_t;
+
+static void *list_push(list_t *list, size_t item_size) {
+    if (list->count == list->capacity) {
+        uint32_t capacity = list->capacity ? list->capacity * 2 : 64;
+        void *items = realloc(list->items, capacity * item_size);
+        if (items == NULL) return NULL;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    return (char *)list->items + (size_t)list->count++ * item_size;
+}
+
+static int push_addr(list_t *list, uint16_t addr) {
+    uint16_t *slot = list_push(list, sizeof(uint16_t));
+    if (slot == NULL) return 1;
+    *slot = addr;
+    return 0;
+}
+
+static void fetch(system_8051_t *sys, uint16_t pc, uint8_t *code) {
+    for (int i = 0; i < 3; i++) code[i] = system_read_code(sys, pc + i);
+}
+
+// Erased or zero-filled vector slots are not treated as handlers
+static int vector_used(system_8051_t *sys, uint16_t addr) {
+    if (addr == VECTOR_RESET) return 1;
+    if (addr == VECTOR_TIMER2 && !sys->variant->has_timer2) return 0;
+
+    uint8_t first = system_read_code(sys, addr);
+    if (first != 0x00 && first != 0xFF) return 1;
+    for (int i = 1; i < 8; i++) {
+        if (system_read_code(sys, addr + i) != first) return 1;
+    }
+    return 0;
+}
+
+// Existing region with the same start and kind, or a new one; NULL when out
+// of memory
+static cfg_data_t *add_data(list_t *data, uint16_t start, uint8_t kind, uint16_t ref) {
+    cfg_data_t *d = data->items;
+    for (uint32_t i = 0; i < data->count; i++) {
+        if (d[i].start == start && d[i].kind == kind) return &d[i];
+    }
+    cfg_data_t *slot = list_push(data, sizeof(cfg_data_t));
+    if (slot == NULL) return NULL;
+    slot->start = start;
+    slot->size = 0;
+    slot->kind = kind;
+    slot->ref = ref;
+    return slot;
+}
+
+// Marks the leaders of the entries in a jump table: consecutive AJMP, LJMP or
+// SJMP instructions starting at `table`. Returns the table size in bytes, or
+// -1 when out of memory.
+static int follow_jump_table(cfg_t *cfg, system_8051_t *sys, list_t *work, uint16_t table) {
+    uint16_t pc = table;
+    for (int i = 0; i < JUMP_TABLE_MAX; i++) {
+        uint8_t opcode = system_read_code(sys, pc);
+        if ((opcode & 0x1F) != 0x01 && opcode != 0x02 && opcode != 0x80) break;
+        cfg->flags[pc] |= CFG_LEADER;
+        if (push_addr(work, pc)) return -1;
+        pc += opcode_table[opcode].length;
+    }
+    return (uint16_t)(pc - table);
+}
+
+// Pass 1: recursive descent. Marks instructions, leaders and entries, and
+// collects computed jumps and table hints.
+static int discover(cfg_t *cfg, system_8051_t *sys, list_t *work, list_t *computed, list_t *data) {
+    while (work->count) {
+        uint16_t pc = ((uint16_t *)work->items)[--work->count];
+        int dptr = -1;  // Last MOV DPTR,#imm in this straight-line run
+
+        while (!(cfg->flags[pc] & CFG_INSN)) {
+            uint8_t code[3];
+            fetch(sys, pc, code);
+            const opcode_info_t *info = &opcode_table[code[0]];
+
+            if (cfg->flags[pc] & CFG_CODE) cfg->flags[pc] |= CFG_CONFLICT;
+            for (int i = 1; i < info->length; i++) {
+                uint16_t a = pc + i;
+                if (cfg->flags[a] & CFG_INSN) cfg->flags[a] |= CFG_CONFLICT;
+                cfg->flags[a] |= CFG_CODE;
+            }
+            cfg->flags[pc] |= CFG_CODE | CFG_INSN;
+            cfg->insn_count++;
+
+            if (info->flags & OPF_INVALID) break;
+
+            uint16_t next = pc + info->length;
+            uint16_t target;
+            if (info->flags & OPF_INDIRECT_JUMP) {
+                if (push_addr(computed, pc)) return 1;
+                if (dptr >= 0) {
+                    cfg_data_t *table = add_data(data, dptr, CFG_DATA_JUMP_TABLE, pc);
+                    int size = table ? follow_jump_table(cfg, sys, work, dptr) : -1;
+                    if (size < 0) return 1;
+                    table->size = size;
+                }
+                break;
+            }
+            if (info->flags & OPF_RETURN) break;
+            if (opcode_target(code, pc, &target)) {
+                cfg->flags[target] |= CFG_LEADER;
+                if (info->flags & OPF_CALL) cfg->flags[target] |= CFG_ENTRY;
+                if (push_addr(work, target)) return 1;
+                if (info->flags & OPF_JUMP) break;
+
+                // Branch or call: the next instruction starts a block too
+                cfg->flags[next] |= CFG_LEADER;
+                if (push_addr(work, next)) return 1;
+                break;
+            }
+
+            if (code[0] == 0x90) dptr = code[1] << 8 | code[2];
+            else if (code[0] == 0xA3) dptr = -1;
+            else if (code[0] == 0x93 && dptr >= 0) {
+                if (add_data(data, dptr, CFG_DATA_MOVC, pc) == NULL) return 1;
+            }
+            pc = next;
+        }
+    }
+    return 0;
+}
+
+// Pass 2: cuts the instruction stream into basic blocks
+static int build_blocks(cfg_t *cfg, system_8051_t *sys, int32_t *block_start) {
+    list_t blocks = { 0 };
+    uint8_t *placed = calloc(65536, 1);
+    if (placed == NULL) return 1;
+
+    for (uint32_t addr = 0; addr < 65536; addr++) {
+        if (!(cfg->flags[addr] & CFG_INSN) || (placed[addr] && !(cfg->flags[addr] & CFG_LEADER))) continue;
+        if (block_start[addr] >= 0) continue;
+
+        cfg_block_t *block = list_push(&blocks, sizeof(cfg_block_t));
+        if (block == NULL) {
+            free(placed);
+            free(blocks.items);
+            return 1;
+        }
+        int32_t index = blocks.count - 1;
+        memset(block, 0, sizeof(*block));
+        block->start = addr;
+        block->func = -1;
+        block_start[addr] = index;
+
+        uint16_t pc = addr;
+        while (1) {
+            uint8_t code[3];
+            fetch(sys, pc, code);
+            const opcode_info_t *info = &opcode_table[code[0]];
+
+            placed[pc] = 1;
+            for (int i = 0; i < info->length; i++) {
+                if (cfg->block_of[(uint16_t)(pc + i)] < 0) cfg->block_of[(uint16_t)(pc + i)] = index;
+            }
+            block->last = pc;
+            block->size += info->length;
+            block->insns++;
+            block->clocks += sys->variant->cycles[code[0]] * sys->variant->cycle_clocks;
+
+            uint16_t next = pc + info->length;
+            uint16_t target;
+            if (info->flags & OPF_INVALID) {
+                block->end = CFG_END_INVALID;
+                break;
+            }
+            if (info->flags & OPF_INDIRECT_JUMP) {
+                block->end = CFG_END_COMPUTED;
+                break;
+            }
+            if (info->flags & OPF_RETURN) {
+                block->end = CFG_END_RETURN;
+                break;
+            }
+            if (opcode_target(code, pc, &target)) {
+                if (info->flags & OPF_CALL) {
+                    block->end = CFG_END_CALL;
+                    block->call = target;
+                    block->succ[block->succ_count++] = next;
+                }
+                else {
+                    block->end = info->flags & OPF_JUMP ? CFG_END_JUMP : CFG_END_BRANCH;
+                    block->succ[block->succ_count++] = target;
+                    if (info->flags & OPF_BRANCH) block->succ[block->succ_count++] = next;
+                }
+                break;
+            }
+            if (!(cfg->flags[next] & CFG_INSN)) {
+                block->end = CFG_END_INVALID;
+                break;
+            }
+            if (cfg->flags[next] & CFG_LEADER) {
+                block->end = CFG_END_FALLTHROUGH;
+                block->succ[block->succ_count++] = next;
+                break;
+            }
+            pc = next;
+        }
+    }
+
+    free(placed);
+    cfg->blocks = blocks.items;
+    cfg->block_count = blocks.count;
+    return 0;
+}
+
+// Gives `func` every unowned block reachable from `first` without following
+// calls
+static int claim(cfg_t *cfg, const int32_t *block_start, list_t *stack, int32_t first, int32_t func) {
+    stack->count = 0;
+    int32_t *slot = list_push(stack, sizeof(int32_t));
+    if (slot == NULL) return 1;
+    *slot = first;
+
+    while (stack->count) {
+        cfg_block_t *block = &cfg->blocks[((int32_t *)stack->items)[--stack->count]];
+        if (block->func >= 0) continue;
+        block->func = func;
+        cfg->funcs[func].blocks++;
+        cfg->funcs[func].insns += block->insns;
+        cfg->funcs[func].size += block->size;
+
+        for (int s = 0; s < block->succ_count; s++) {
+            int32_t succ = block_start[block->succ[s]];
+            if (succ < 0 || cfg->blocks[succ].func >= 0) continue;
+            slot = list_push(stack, sizeof(int32_t));
+            if (slot == NULL) return 1;
+            *slot = succ;
+        }
+    }
+    return 0;
+}
+
+// Pass 3: one function per entry, owning every block reachable from it.
+// Lower entries win shared blocks; jump table targets belong to the function
+// holding the JMP @A+DPTR.
+static int build_functions(cfg_t *cfg, system_8051_t *sys, const int32_t *block_start, const list_t *data) {
+    list_t funcs = { 0 };
+    list_t stack = { 0 };
+    int err = 0;
+
+    for (uint32_t addr = 0; addr < 65536; addr++) {
+        if (!(cfg->flags[addr] & CFG_ENTRY) || block_start[addr] < 0) continue;
+
+        cfg_func_t *func = list_push(&funcs, sizeof(cfg_func_t));
+        if (func == NULL) {
+            free(funcs.items);
+            return 1;
+        }
+        memset(func, 0, sizeof(*func));
+        func->entry = addr;
+        for (size_t v = 0; v < VECTOR_COUNT; v++) {
+            if (vectors[v].addr == addr && vector_used(sys, addr)) func->name = vectors[v].name;
+        }
+    }
+    cfg->funcs = funcs.items;
+    cfg->func_count = funcs.count;
+
+    for (uint32_t f = 0; f < cfg->func_count && !err; f++) {
+        err = claim(cfg, block_start, &stack, block_start[cfg->funcs[f].entry], f);
+    }
+
+    // Tables are found in address order of the jumps, so repeat until nested
+    // tables have settled
+    int changed = 1;
+    while (changed && !err) {
+        changed = 0;
+        const cfg_data_t *d = data->items;
+        for (uint32_t i = 0; i < data->count && !err; i++) {
+            if (d[i].kind != CFG_DATA_JUMP_TABLE) continue;
+            int32_t owner = cfg->blocks[cfg->block_of[d[i].ref]].func;
+            if (owner < 0) continue;
+
+            uint16_t pc = d[i].start;
+            while ((uint16_t)(pc - d[i].start) < d[i].size && !err) {
+                int32_t entry = block_start[pc];
+                if (entry >= 0 && cfg->blocks[entry].func < 0) {
+                    err = claim(cfg, block_start, &stack, entry, owner);
+                    changed = 1;
+                }
+                pc += opcode_table[system_read_code(sys, pc)].length;
+            }
+        }
+    }
+
+    free(stack.items);
+    return err;
+}
+
+// Pass 4: unreached bytes between reached code, and the extent of MOVC
+// tables. Uniform 0x00/0xFF runs are padding, not data.
+static int find_data(cfg_t *cfg, system_8051_t *sys, list_t *data) {
+    cfg_data_t *d = data->items;
+    for (uint32_t i = 0; i < data->count; i++) {
+        if (d[i].kind != CFG_DATA_MOVC) continue;
+        uint16_t a = d[i].start;
+        while (d[i].size < 256 && !(cfg->flags[a] & CFG_CODE)) {
+            cfg->flags[a++] |= CFG_DATA;
+            d[i].size++;
+        }
+    }
+
+    int32_t first = -1, last = -1;
+    for (uint32_t addr = 0; addr < 65536; addr++) {
+        if (!(cfg->flags[addr] & CFG_CODE)) continue;
+        if (first < 0) first = addr;
+        last = addr;
+    }
+
+    for (int32_t addr = first; addr >= 0 && addr < last; addr++) {
+        if (cfg->flags[addr] & (CFG_CODE | CFG_DATA)) continue;
+
+        int32_t end = addr;
+        int uniform = 1;
+        uint8_t fill = system_read_code(sys, addr);
+        while (end < last && !(cfg->flags[end] & (CFG_CODE | CFG_DATA))) {
+            if (system_read_code(sys, end) != fill) uniform = 0;
+            end++;
+        }
+
+        if (!uniform || (fill != 0x00 && fill != 0xFF)) {
+            cfg_data_t *gap = add_data(data, addr, CFG_DATA_GAP, 0);
+            if (gap == NULL) return 1;
+            gap->size = end - addr;
+            for (int32_t a = addr; a < end; a++) cfg->flags[a] |= CFG_DATA;
+        }
+        addr = end - 1;
+    }
+    return 0;
+}
+
+static int compare_data(const void *a, const void *b) {
+    const cfg_data_t *x = a, *y = b;
+    return (int)x->start - (int)y->start;
+}
+
+cfg_t *cfg_build(system_8051_t *sys) {
+    cfg_t *cfg = calloc(1, sizeof(cfg_t));
+    int32_t *block_start = malloc(65536 * sizeof(int32_t));
+    list_t work = { 0 }, computed = { 0 }, data = { 0 };
+    if (cfg == NULL || block_start == NULL) goto fail;
+
+    for (uint32_t i = 0; i < 65536; i++) {
+        cfg->block_of[i] = -1;
+        block_start[i] = -1;
+    }
+
+    // Reset first: a vector that lands inside one of its instructions is
+    // not a handler, the program just does not use that interrupt
+    for (size_t v = 0; v < VECTOR_COUNT; v++) {
+        uint16_t addr = vectors[v].addr;
+        if (!vector_used(sys, addr) || (cfg->flags[addr] & (CFG_CODE | CFG_INSN)) == CFG_CODE) continue;
+        cfg->flags[addr] |= CFG_LEADER | CFG_ENTRY;
+        if (push_addr(&work, addr)) goto fail;
+        if (discover(cfg, sys, &work, &computed, &data)) goto fail;
+    }
+
+    if (build_blocks(cfg, sys, block_start)) goto fail;
+    if (build_functions(cfg, sys, block_start, &data)) goto fail;
+    if (find_data(cfg, sys, &data)) goto fail;
+
+    qsort(data.items, data.count, sizeof(cfg_data_t), compare_data);
+    cfg->data = data.items;
+    cfg->data_count = data.count;
+    cfg->computed = computed.items;
+    cfg->computed_count = computed.count;
+
+    free(work.items);
+    free(block_start);
+    return cfg;
+
+fail:
+    printf("Out of memory building the control-flow graph\n");
+    free(work.items);
+    free(computed.items);
+    free(data.items);
+    free(block_start);
+    cfg_free(cfg);
+    return NULL;
+}
+
+void cfg_free(cfg_t *cfg) {
+    if (cfg == NULL) return;
+    free(cfg->blocks);
+    free(cfg->funcs);
+    free(cfg->data);
+    free(cfg->computed);
+    free(cfg);
+}
+
+const cfg_block_t *cfg_block_at(const cfg_t *cfg, uint16_t pc) {
+    int32_t index = cfg->block_of[pc];
+    return index < 0 ? NULL : &cfg->blocks[index];
+}
+
+static void dump_block(const cfg_block_t *block, system_8051_t *sys, FILE *out) {
+    static const char *ends[] = { "->", "branch", "jump", "call", "ret", "jmp @A+DPTR", "invalid" };
+
+    fprintf(out, "  block 0x%04X: %u bytes, %u insns, %u clocks, %s",
+            block->start, block->size, block->insns, block->clocks, ends[block->end]);
+    if (block->end == CFG_END_CALL) fprintf(out, " 0x%04X ->", block->call);
+    for (int s = 0; s < block->succ_count; s++) fprintf(out, "%s 0x%04X", s ? "," : "", block->succ[s]);
+    fprintf(out, "\n");
+
+    uint16_t pc = block->start;
+    for (uint32_t i = 0; i < block->insns; i++) {
+        uint8_t code[3];
+        char text[32];
+        fetch(sys, pc, code);
+        int len = opcode_disasm(code, pc, text, sizeof(text));
+
+        fprintf(out, "    0x%04X ", pc);
+        for (int b = 0; b < 3; b++) {
+            if (b < len) fprintf(out, " %02X", code[b]);
+            else fprintf(out, "   ");
+        }
+        fprintf(out, "  %s\n", text);
+        pc += len;
+    }
+}
+
+void cfg_dump(const cfg_t *cfg, system_8051_t *sys, FILE *out) {
+    static const char *data_kinds[] = { "unreached", "movc table", "jump table" };
+
+    uint32_t conflicts = 0;
+    for (uint32_t addr = 0; addr < 65536; addr++) {
+        if (cfg->flags[addr] & CFG_CONFLICT) conflicts++;
+    }
+
+    fprintf(out, "; %s: %u functions, %u blocks, %u instructions, %u data regions, %u computed jumps, %u overlapping bytes\n",
+            sys->variant->name, cfg->func_count, cfg->block_count, cfg->insn_count,
+            cfg->data_count, cfg->computed_count, conflicts);
+
+    for (uint32_t f = 0; f < cfg->func_count; f++) {
+        const cfg_func_t *func = &cfg->funcs[f];
+        fprintf(out, "\nfunction 0x%04X", func->entry);
+        if (func->name) fprintf(out, " (%s)", func->name);
+        fprintf(out, ": %u blocks, %u instructions, %u bytes\n", func->blocks, func->insns, func->size);
+
+        for (uint32_t b = 0; b < cfg->block_count; b++) {
+            if (cfg->blocks[b].func == (int32_t)f) dump_block(&cfg->blocks[b], sys, out);
+        }
+    }
+
+    if (cfg->data_count) fprintf(out, "\n");
+    for (uint32_t i = 0; i < cfg->data_count; i++) {
+        const cfg_data_t *d = &cfg->data[i];
+        fprintf(out, "data 0x%04X: %u bytes, %s", d->start, d->size, data_kinds[d->kind]);
+        if (d->kind != CFG_DATA_GAP) fprintf(out, " used at 0x%04X", d->ref);
+        fprintf(out, "\n");
+    }
+    for (uint32_t i = 0; i < cfg->computed_count; i++) {
+        fprintf(out, "computed jump at 0x%04X\n", cfg->computed[i]);
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef CFG_H
+#define CFG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "system.h"
+
+// Static analysis of the loaded code: recursive disassembly from the reset
+// and interrupt vectors, basic blocks, functions and data-in-code.
+
+// Per-address flags
+#define CFG_CODE        0x01    // Byte belongs to a reached instruction
+#define CFG_INSN        0x02    // First byte of a reached instruction
+#define CFG_LEADER      0x04    // First instruction of a basic block
+#define CFG_ENTRY       0x08    // Function entry (vector or call target)
+#define CFG_DATA        0x10    // Inside a data-in-code region
+#define CFG_CONFLICT    0x20    // Reached both as an opcode and as an operand
+
+// How a basic block ends
+typedef enum {
+    CFG_END_FALLTHROUGH,    // Next instruction is a leader
+    CFG_END_BRANCH,         // Conditional: target + fallthrough
+    CFG_END_JUMP,
+    CFG_END_CALL,           // Call edge + fallthrough (return site)
+    CFG_END_RETURN,
+    CFG_END_COMPUTED,       // JMP @A+DPTR
+    CFG_END_INVALID         // Reserved opcode or fell off the end
+} cfg_end_t;
+
+typedef struct {
+    uint16_t start;
+    uint16_t last;          // Address of the last instruction
+    uint32_t size;          // Bytes
+    uint32_t insns;
+    uint32_t clocks;        // Straight-line cost on sys->variant, branches not taken
+    uint8_t end;            // cfg_end_t
+    uint8_t succ_count;
+    uint16_t succ[2];       // Taken/jump target first, then fallthrough
+    uint16_t call;          // Call target (CFG_END_CALL)
+    int32_t func;           // Owning function, -1 if only reached from another function's code
+} cfg_block_t;
+
+typedef struct {
+    uint16_t entry;
+    const char *name;       // Vector name, or NULL for call targets
+    uint32_t blocks;
+    uint32_t insns;
+    uint32_t size;
+} cfg_func_t;
+
+typedef enum {
+    CFG_DATA_GAP,           // Unreached bytes between reached code
+    CFG_DATA_MOVC,          // MOV DPTR,#x ... MOVC A,@A+DPTR
+    CFG_DATA_JUMP_TABLE     // MOV DPTR,#x ... JMP @A+DPTR
+} cfg_data_kind_t;
+
+typedef struct {
+    uint16_t start;
+    uint32_t size;          // 0 when only the start is known (table hints)
+    uint8_t kind;           // cfg_data_kind_t
+    uint16_t ref;           // Instruction that referenced it (table hints)
+} cfg_data_t;
+
+typedef struct {
+    uint8_t flags[65536];
+    int32_t block_of[65536];    // Block containing each reached byte, -1 otherwise
+
+    cfg_block_t *blocks;
+    uint32_t block_count;
+    cfg_func_t *funcs;
+    uint32_t func_count;
+    cfg_data_t *data;
+    uint32_t data_count;
+    uint16_t *computed;         // Addresses of JMP @A+DPTR
+    uint32_t computed_count;
+    uint32_t insn_count;
+} cfg_t;
+
+// Analyses the code currently visible through system_read_code(). NULL on
+// allocation failure.
+cfg_t *cfg_build(system_8051_t *sys);
+void cfg_free(cfg_t *cfg);
+
+// Block containing `pc`, or NULL if it was not reached
+const cfg_block_t *cfg_block_at(const cfg_t *cfg, uint16_t pc);
+
+// Functions, blocks with their disassembly, data regions and computed jumps
+void cfg_dump(const cfg_t *cfg, system_8051_t *sys, FILE *out);
+
+#endif
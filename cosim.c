@@ -0,0 +1,435 @@
+// Multi-node co-simulation: one thread per node, conservative quantum sync
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "cosim.h"
+#include "hexfile.h"
+
+#define COSIM_RX_SIZE 65536     // Serial bytes delivered but not yet read by the UART
+
+typedef enum {
+    LINK_UART,
+    LINK_PIN
+} link_kind_t;
+
+typedef struct {
+    uint64_t time;          // Delivery time in clocks
+    uint8_t value;          // Serial byte or pin level
+} cosim_event_t;
+
+typedef struct {
+    link_kind_t kind;
+    int from, to;
+    uint8_t from_port, from_bit;
+    uint8_t to_port, to_bit;
+    uint64_t latency;
+    uint64_t sent;
+
+    // Sender thread -> receiver thread
+    spsc_t queue;
+
+    // Receiver side: events taken off the queue, oldest first
+    cosim_event_t *inbox;
+    size_t inbox_head, inbox_len, inbox_cap;
+} cosim_link_t;
+
+typedef struct cosim_node {
+    char name[32];
+    cosim_t *sim;
+    system_8051_t *sys;
+    spsc_t rxq;             // UART input, filled by delivered events
+    int out[COSIM_MAX_LINKS];
+    int out_count;
+    int in[COSIM_MAX_LINKS];    // Ascending link order breaks ties in delivery
+    int in_count;
+    uint64_t received;
+    uint64_t rx_dropped;
+    pthread_t thread;
+} cosim_node_t;
+
+struct cosim {
+    cosim_node_t nodes[COSIM_MAX_NODES];
+    int node_count;
+    cosim_link_t links[COSIM_MAX_LINKS];
+    int link_count;
+
+    uint64_t quantum;       // Smallest link latency
+    uint64_t end;
+    uint64_t quanta;
+    double seconds;
+
+    atomic_int go;          // 1 = run, -1 = a thread failed to start
+    atomic_uint arrived;
+    atomic_uint generation;
+};
+
+// EVENT QUEUES
+static void inbox_push(cosim_link_t *link, const cosim_event_t *ev) {
+    if (link->inbox_len == link->inbox_cap) {
+        if (link->inbox_head > 0) {
+            link->inbox_len -= link->inbox_head;
+            memmove(link->inbox, link->inbox + link->inbox_head, link->inbox_len * sizeof(cosim_event_t));
+            link->inbox_head = 0;
+        }
+        else {
+            size_t cap = link->inbox_cap ? link->inbox_cap * 2 : 256;
+            cosim_event_t *grown = realloc(link->inbox, cap * sizeof(cosim_event_t));
+            if (grown == NULL) {
+                printf("Error: Out of memory for co-simulation events\n");
+                exit(1);
+            }
+            link->inbox = grown;
+            link->inbox_cap = cap;
+        }
+    }
+    link->inbox[link->inbox_len++] = *ev;
+}
+
+// Moves everything the senders have queued into the node's inboxes, so
+// that a sender waiting on a full queue always makes progress
+static void node_drain(cosim_node_t *node) {
+    cosim_t *sim = node->sim;
+    cosim_event_t ev;
+    for (int i = 0; i < node->in_count; i++) {
+        cosim_link_t *link = &sim->links[node->in[i]];
+        while (spsc_pop(&link->queue, &ev)) inbox_push(link, &ev);
+    }
+}
+
+static void link_send(cosim_node_t *node, cosim_link_t *link, uint8_t value) {
+    cosim_event_t ev = { node->sys->cpu.cycles + link->latency, value };
+    link->sent++;
+    while (!spsc_push(&link->queue, &ev)) {
+        node_drain(node);
+        sched_yield();
+    }
+}
+
+void cosim_port_write(system_8051_t *sys, uint8_t port, uint8_t old_value, uint8_t new_value) {
+    cosim_node_t *node = sys->cosim;
+    for (int i = 0; i < node->out_count; i++) {
+        cosim_link_t *link = &node->sim->links[node->out[i]];
+        if (link->kind != LINK_PIN || link->from_port != port) continue;
+        if (((old_value ^ new_value) >> link->from_bit) & 1) link_send(node, link, (new_value >> link->from_bit) & 1);
+    }
+}
+
+void cosim_uart_tx(system_8051_t *sys, uint8_t byte) {
+    cosim_node_t *node = sys->cosim;
+    for (int i = 0; i < node->out_count; i++) {
+        cosim_link_t *link = &node->sim->links[node->out[i]];
+        if (link->kind == LINK_UART) link_send(node, link, byte);
+    }
+}
+
+static void deliver(cosim_node_t *node, cosim_link_t *link, const cosim_event_t *ev) {
+    system_8051_t *sys = node->sys;
+    node->received++;
+
+    if (link->kind == LINK_UART) {
+        if (!spsc_push(&node->rxq, &ev->value)) node->rx_dropped++;
+        return;
+    }
+
+    uint8_t addr = 0x80 + link->to_port * 0x10;
+    uint8_t mask = 1 << link->to_bit;
+    uint8_t latch = sfr_read(sys, addr);
+    uint8_t value = ev->value ? latch | mask : latch & ~mask;
+    if (value != latch) sfr_write(sys, addr, value);
+}
+
+// NODE THREADS
+// Applies every event due by now, then returns the time of the next one
+static uint64_t deliver_due(cosim_node_t *node, uint64_t until) {
+    cosim_t *sim = node->sim;
+    system_8051_t *sys = node->sys;
+
+    while (1) {
+        cosim_link_t *first = NULL;
+        for (int i = 0; i < node->in_count; i++) {
+            cosim_link_t *link = &sim->links[node->in[i]];
+            if (link->inbox_head == link->inbox_len) continue;
+            if (first == NULL || link->inbox[link->inbox_head].time < first->inbox[first->inbox_head].time) first = link;
+        }
+        if (first == NULL) return until;
+
+        const cosim_event_t *ev = &first->inbox[first->inbox_head];
+        if (ev->time > sys->cpu.cycles) return ev->time < until ? ev->time : until;
+        deliver(node, first, ev);
+        if (++first->inbox_head == first->inbox_len) first->inbox_head = first->inbox_len = 0;
+    }
+}
+
+static void run_quantum(cosim_node_t *node, uint64_t until) {
+    system_8051_t *sys = node->sys;
+    while (sys->cpu.cycles < until) {
+        uint64_t next = deliver_due(node, until);
+        // A halted node keeps spinning: its timers and interrupts still run
+        if (system_run(sys, RUN_NO_LIMIT, next) == RUN_HALT) system_step(sys);
+    }
+}
+
+static void quantum_barrier(cosim_node_t *node) {
+    cosim_t *sim = node->sim;
+    unsigned gen = atomic_load(&sim->generation);
+    if (atomic_fetch_add(&sim->arrived, 1) + 1 == (unsigned)sim->node_count) {
+        atomic_store(&sim->arrived, 0);
+        atomic_store(&sim->generation, gen + 1);
+        return;
+    }
+    while (atomic_load(&sim->generation) == gen) {
+        node_drain(node);
+        sched_yield();
+    }
+}
+
+static void *node_thread(void *arg) {
+    cosim_node_t *node = arg;
+    cosim_t *sim = node->sim;
+
+    while (atomic_load(&sim->go) == 0) sched_yield();
+    if (atomic_load(&sim->go) < 0) return NULL;
+
+    for (uint64_t start = 0; start < sim->end; start += sim->quantum) {
+        uint64_t until = sim->end - start > sim->quantum ? start + sim->quantum : sim->end;
+        node_drain(node);
+        run_quantum(node, until);
+        quantum_barrier(node);
+    }
+    return NULL;
+}
+
+int cosim_run(cosim_t *sim, uint64_t cycles) {
+    sim->end = cycles;
+    sim->quantum = cycles ? cycles : 1;
+    for (int i = 0; i < sim->link_count; i++) {
+        if (sim->links[i].latency < sim->quantum) sim->quantum = sim->links[i].latency;
+    }
+    sim->quanta = (cycles + sim->quantum - 1) / sim->quantum;
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    int started = 0;
+    for (; started < sim->node_count; started++) {
+        if (pthread_create(&sim->nodes[started].thread, NULL, node_thread, &sim->nodes[started]) != 0) break;
+    }
+    atomic_store(&sim->go, started == sim->node_count ? 1 : -1);
+    for (int i = 0; i < started; i++) pthread_join(sim->nodes[i].thread, NULL);
+    if (started != sim->node_count) {
+        printf("Error: Could not start the node threads\n");
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    sim->seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    return 0;
+}
+
+// TOPOLOGY
+static int find_node(cosim_t *sim, const char *name) {
+    for (int i = 0; i < sim->node_count; i++) {
+        if (strcmp(sim->nodes[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+static int parse_pin(const char *text, uint8_t *port, uint8_t *bit) {
+    unsigned p, b;
+    char tail;
+    if (sscanf(text, "P%u.%u%c", &p, &b, &tail) != 2 || p > 3 || b > 7) return 1;
+    *port = p;
+    *bit = b;
+    return 0;
+}
+
+static int add_node(cosim_t *sim, const char *name, const char *core, const char *image) {
+    const cpu_variant_t *variant = cpu_variant_find(core);
+    if (variant == NULL) {
+        printf("unknown CPU variant %s\n", core);
+        return 1;
+    }
+    if (find_node(sim, name) >= 0 || sim->node_count == COSIM_MAX_NODES) {
+        printf("duplicate node or more than %d nodes\n", COSIM_MAX_NODES);
+        return 1;
+    }
+
+    cosim_node_t *node = &sim->nodes[sim->node_count];
+    node->sys = malloc(sizeof(system_8051_t));
+    if (node->sys == NULL || spsc_init(&node->rxq, 1, COSIM_RX_SIZE)) {
+        printf("out of memory\n");
+        free(node->sys);
+        node->sys = NULL;
+        return 1;
+    }
+    sim->node_count++;
+    snprintf(node->name, sizeof(node->name), "%.31s", name);
+    node->sim = sim;
+
+    system_reset(node->sys);
+    system_set_variant(node->sys, variant);
+    if (load_hex(node->sys, image)) return 1;
+    node->sys->cosim = node;
+    uart_bind(node->sys, NULL, &node->rxq);
+    return 0;
+}
+
+static int add_link(cosim_t *sim, cosim_link_t *proto) {
+    if (sim->link_count == COSIM_MAX_LINKS) {
+        printf("more than %d links\n", COSIM_MAX_LINKS);
+        return 1;
+    }
+    if (proto->latency == 0) {
+        printf("link latency must be at least one clock\n");
+        return 1;
+    }
+
+    int index = sim->link_count;
+    cosim_link_t *link = &sim->links[index];
+    *link = *proto;
+    if (spsc_init(&link->queue, sizeof(cosim_event_t), COSIM_QUEUE_SIZE)) {
+        printf("out of memory\n");
+        return 1;
+    }
+    sim->link_count++;
+
+    cosim_node_t *from = &sim->nodes[link->from];
+    cosim_node_t *to = &sim->nodes[link->to];
+    from->out[from->out_count++] = index;
+    to->in[to->in_count++] = index;
+    return 0;
+}
+
+// Images are looked up next to the topology file unless the path is absolute
+static void image_path(const char *topology, const char *image, char *out, size_t size) {
+    const char *slash = strrchr(topology, '/');
+    if (image[0] == '/' || slash == NULL) snprintf(out, size, "%s", image);
+    else snprintf(out, size, "%.*s/%s", (int)(slash - topology), topology, image);
+}
+
+static int parse_line(cosim_t *sim, const char *topology, char *line) {
+    char *hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+
+    char kind[16], a[256], b[256], c[256], d[256], e[256];
+    uint64_t latency;
+    int n = sscanf(line, "%15s %255s %255s %255s %255s %255s", kind, a, b, c, d, e);
+    if (n <= 0) return 0;
+
+    if (strcmp(kind, "node") == 0 && n == 4) {
+        char path[512];
+        image_path(topology, c, path, sizeof(path));
+        return add_node(sim, a, b, path);
+    }
+
+    cosim_link_t link;
+    memset(&link, 0, sizeof(link));
+    if (strcmp(kind, "uart") == 0 && n == 4) {
+        link.kind = LINK_UART;
+        link.from = find_node(sim, a);
+        link.to = find_node(sim, b);
+        latency = strtoull(c, NULL, 0);
+    }
+    else if (strcmp(kind, "pin") == 0 && n == 6) {
+        link.kind = LINK_PIN;
+        link.from = find_node(sim, a);
+        link.to = find_node(sim, c);
+        latency = strtoull(e, NULL, 0);
+        if (parse_pin(b, &link.from_port, &link.from_bit) || parse_pin(d, &link.to_port, &link.to_bit)) {
+            printf("pins are written Pp.b, e.g. P3.2\n");
+            return 1;
+        }
+    }
+    else {
+        printf("expected 'node NAME CORE IMAGE', 'uart FROM TO LATENCY' or 'pin FROM Pp.b TO Pp.b LATENCY'\n");
+        return 1;
+    }
+
+    if (link.from < 0 || link.to < 0) {
+        printf("links must name nodes declared above\n");
+        return 1;
+    }
+    link.latency = latency;
+    return add_link(sim, &link);
+}
+
+cosim_t *cosim_load(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        printf("Could not open topology %s\n", path);
+        return NULL;
+    }
+
+    cosim_t *sim = calloc(1, sizeof(cosim_t));
+    if (sim == NULL) {
+        fclose(file);
+        return NULL;
+    }
+
+    char line[512];
+    int line_num = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_num++;
+        char copy[512];
+        snprintf(copy, sizeof(copy), "%s", line);
+        if (parse_line(sim, path, line)) {
+            printf("  at %s:%d: %s", path, line_num, copy);
+            fclose(file);
+            cosim_free(sim);
+            return NULL;
+        }
+    }
+    fclose(file);
+
+    if (sim->node_count == 0) {
+        printf("Topology %s declares no nodes\n", path);
+        cosim_free(sim);
+        return NULL;
+    }
+    return sim;
+}
+
+void cosim_print(cosim_t *sim) {
+    printf("\n| CO-SIMULATION       | %d nodes, %d links, quantum %lu clocks, %lu quanta in %.3f s\n",
+           sim->node_count, sim->link_count, sim->quantum, sim->quanta, sim->seconds);
+    printf("|---------------------+--------------------------------------------\n");
+    for (int i = 0; i < sim->node_count; i++) {
+        cosim_node_t *node = &sim->nodes[i];
+        system_8051_t *sys = node->sys;
+        printf("| %-19s : %-6s PC 0x%04X, %lu instructions, %lu clocks, %lu events in",
+               node->name, sys->variant->name, sys->cpu.PC, sys->cpu.instructions, sys->cpu.cycles, node->received);
+        if (node->rx_dropped) printf(" (%lu serial bytes dropped)", node->rx_dropped);
+        printf("\n");
+    }
+    printf("|---------------------+--------------------------------------------\n");
+    for (int i = 0; i < sim->link_count; i++) {
+        cosim_link_t *link = &sim->links[i];
+        char from[48], to[48];
+        if (link->kind == LINK_UART) {
+            snprintf(from, sizeof(from), "%s", sim->nodes[link->from].name);
+            snprintf(to, sizeof(to), "%s", sim->nodes[link->to].name);
+        }
+        else {
+            snprintf(from, sizeof(from), "%s.P%u.%u", sim->nodes[link->from].name, link->from_port, link->from_bit);
+            snprintf(to, sizeof(to), "%s.P%u.%u", sim->nodes[link->to].name, link->to_port, link->to_bit);
+        }
+        printf("| %-4s %s -> %s : latency %lu, %lu events\n", link->kind == LINK_UART ? "uart" : "pin", from, to, link->latency, link->sent);
+    }
+}
+
+void cosim_free(cosim_t *sim) {
+    if (sim == NULL) return;
+    for (int i = 0; i < sim->node_count; i++) {
+        free(sim->nodes[i].sys);
+        spsc_free(&sim->nodes[i].rxq);
+    }
+    for (int i = 0; i < sim->link_count; i++) {
+        spsc_free(&sim->links[i].queue);
+        free(sim->links[i].inbox);
+    }
+    free(sim);
+}
@@ -0,0 +1,47 @@
+#ifndef COSIM_H
+#define COSIM_H
+
+#include <stdint.h>
+#include "system.h"
+
+// Co-simulation of several 8051 nodes wired together by UART and GPIO links.
+// Every node runs on its own thread. Time advances in quanta no longer than
+// the smallest link latency, so nothing a node does during a quantum can
+// reach another node before the next one: nodes only meet at the quantum
+// barrier. Cross-node events travel through one SPSC queue per link and are
+// applied in (time, link) order, which makes a run deterministic however the
+// threads are scheduled.
+//
+// All nodes share one clock: link latencies and the run length are in
+// oscillator clocks. The topology file has one statement per line:
+//   node NAME CORE IMAGE.hex
+//   uart FROM TO LATENCY                   FROM's TXD drives TO's RXD
+//   pin  FROM Pp.b TO Pp.b LATENCY         a port pin drives another node's pin
+// A driven pin is written into the receiving port latch (the emulator keeps
+// no separate pin state), so falling edges on P3.2/P3.3 raise INT0/INT1.
+// Serial bytes reach the receiver LATENCY clocks after the sender's stop bit
+// and are then clocked in at the receiver's own baud rate.
+
+#define COSIM_MAX_NODES 32
+#define COSIM_MAX_LINKS 128
+#define COSIM_QUEUE_SIZE 4096       // Events per link queue; a full queue waits for the receiver
+
+typedef struct cosim cosim_t;
+
+// Parses the topology and loads every node's image. NULL (after printing
+// why) on failure.
+cosim_t *cosim_load(const char *path);
+
+// Runs all nodes until `cycles` clocks. 1 if the threads could not start.
+int cosim_run(cosim_t *sim, uint64_t cycles);
+
+// One row per node
+void cosim_print(cosim_t *sim);
+
+void cosim_free(cosim_t *sim);
+
+// Hooks for the node's own thread (sys->cosim is set)
+void cosim_port_write(system_8051_t *sys, uint8_t port, uint8_t old_value, uint8_t new_value);
+void cosim_uart_tx(system_8051_t *sys, uint8_t byte);
+
+#endif
@@ -0,0 +1,375 @@
+// Coverage files, the coverage summary and lcov export
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cover.h"
+#include "aot.h"
+#include "cfg.h"
+#include "opcodes.h"
+#include "sym.h"
+
+#define COVER_WORDS (65536 / 64)
+
+// On-disk layout, mapped shared by every process merging into the file
+typedef struct {
+    uint32_t magic;             // COVER_MAGIC; 0 while the file is new
+    uint32_t version;
+    uint32_t rom_hash;          // aot_rom_hash() of the code it covers
+    uint32_t reserved;
+    _Atomic uint64_t runs;
+    _Atomic uint64_t exec[COVER_WORDS];
+    _Atomic uint64_t taken[COVER_WORDS];
+    _Atomic uint64_t not_taken[COVER_WORDS];
+} cover_file_t;
+
+// Maps the coverage file, creating and stamping it if `create` is set.
+// Only the header is checked under the file lock; the maps themselves are
+// merged lock-free.
+static cover_file_t *cover_map(system_8051_t *sys, const char *path, int create) {
+    int fd = open(path, create ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (fd < 0) {
+        printf("Error: Could not open %s\n", path);
+        return NULL;
+    }
+
+    const char *problem = NULL;
+    struct stat st;
+    flock(fd, create ? LOCK_EX : LOCK_SH);
+    if (fstat(fd, &st) != 0) problem = "cannot stat";
+    else if (st.st_size == 0 && create && ftruncate(fd, sizeof(cover_file_t)) != 0) problem = "cannot resize";
+    else if (st.st_size != 0 && st.st_size != sizeof(cover_file_t)) problem = "not a coverage file";
+    else if (st.st_size == 0 && !create) problem = "empty";
+
+    cover_file_t *file = NULL;
+    if (problem == NULL) {
+        file = mmap(NULL, sizeof(cover_file_t), create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if (file == MAP_FAILED) {
+            file = NULL;
+            problem = "cannot map";
+        }
+    }
+
+    uint32_t hash = aot_rom_hash(sys);
+    if (file && file->magic == 0 && create) {
+        file->version = COVER_VERSION;
+        file->rom_hash = hash;
+        file->magic = COVER_MAGIC;
+    }
+    if (file && problem == NULL) {
+        if (file->magic != COVER_MAGIC || file->version != COVER_VERSION) problem = "not a coverage file";
+        else if (file->rom_hash != hash) problem = "recorded on different code";
+    }
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    if (problem) {
+        printf("Error: Not using %s: %s\n", path, problem);
+        if (file) munmap(file, sizeof(cover_file_t));
+        return NULL;
+    }
+    return file;
+}
+
+// Packs a byte map into bits and ORs the nonzero words into `dst`
+static void merge_map(_Atomic uint64_t *dst, const uint8_t *map) {
+    for (int w = 0; w < COVER_WORDS; w++) {
+        uint64_t bits = 0;
+        for (int b = 0; b < 64; b++) bits |= (uint64_t)(map[w * 64 + b] != 0) << b;
+        if (bits) atomic_fetch_or(&dst[w], bits);
+    }
+}
+
+static void unpack_map(uint8_t *map, const _Atomic uint64_t *src) {
+    for (int w = 0; w < COVER_WORDS; w++) {
+        uint64_t bits = atomic_load(&src[w]);
+        for (int b = 0; b < 64; b++) map[w * 64 + b] = (bits >> b) & 1;
+    }
+}
+
+int cover_merge(system_8051_t *sys, const coverage_t *cov, const char *path) {
+    cover_file_t *file = cover_map(sys, path, 1);
+    if (file == NULL) return 1;
+
+    merge_map(file->exec, cov->exec);
+    merge_map(file->taken, cov->taken);
+    merge_map(file->not_taken, cov->not_taken);
+    atomic_fetch_add(&file->runs, 1);
+    munmap(file, sizeof(cover_file_t));
+    return 0;
+}
+
+int cover_load(system_8051_t *sys, coverage_t *cov, const char *path, uint64_t *runs) {
+    cover_file_t *file = cover_map(sys, path, 0);
+    if (file == NULL) return 1;
+
+    unpack_map(cov->exec, file->exec);
+    unpack_map(cov->taken, file->taken);
+    unpack_map(cov->not_taken, file->not_taken);
+    *runs = atomic_load(&file->runs);
+    munmap(file, sizeof(cover_file_t));
+    return 0;
+}
+
+static int is_branch(system_8051_t *sys, uint16_t pc) {
+    return (opcode_table[system_read_code(sys, pc)].flags & OPF_BRANCH) != 0;
+}
+
+typedef struct {
+    uint32_t insns, insns_hit;
+    uint32_t outcomes, outcomes_hit;    // Two per conditional branch
+} cover_count_t;
+
+static void count_insn(system_8051_t *sys, const coverage_t *cov, uint16_t pc, cover_count_t *count) {
+    count->insns++;
+    count->insns_hit += cov->exec[pc] != 0;
+    if (!is_branch(sys, pc)) return;
+    count->outcomes += 2;
+    count->outcomes_hit += (cov->taken[pc] != 0) + (cov->not_taken[pc] != 0);
+}
+
+static double percent(uint32_t part, uint32_t whole) {
+    return whole ? 100.0 * part / whole : 100.0;
+}
+
+void cover_print(system_8051_t *sys, const coverage_t *cov, uint64_t runs) {
+    cfg_t *cfg = cfg_build(sys);
+    if (cfg == NULL) return;
+
+    cover_count_t total = { 0 };
+    uint32_t outside = 0;       // Executed, but not found by the static analysis
+    for (uint32_t pc = 0; pc < 65536; pc++) {
+        if (cfg->flags[pc] & CFG_INSN) count_insn(sys, cov, pc, &total);
+        else if (cov->exec[pc]) outside++;
+    }
+
+    printf("\n| COVERAGE            | %lu runs, %u instructions, %u branches\n", runs, total.insns, total.outcomes / 2);
+    printf("|---------------------+--------------------------------------------\n");
+    printf("| Instructions        : %u executed (%.1f%%)\n", total.insns_hit, percent(total.insns_hit, total.insns));
+    printf("| Branch outcomes     : %u of %u (%.1f%%)\n", total.outcomes_hit, total.outcomes, percent(total.outcomes_hit, total.outcomes));
+    if (outside) printf("| Outside the CFG     : %u executed addresses\n", outside);
+
+    printf("|---------------------+--------------------------------------------\n");
+    for (uint32_t f = 0; f < cfg->func_count; f++) {
+        const cfg_func_t *func = &cfg->funcs[f];
+        cover_count_t count = { 0 };
+        for (uint32_t b = 0; b < cfg->block_count; b++) {
+            const cfg_block_t *block = &cfg->blocks[b];
+            if (block->func != (int32_t)f) continue;
+            for (uint32_t pc = block->start; pc <= block->last; pc++) {
+                if (cfg->flags[pc] & CFG_INSN) count_insn(sys, cov, pc, &count);
+            }
+        }
+
+        char name[32];
+        const sym_t *sym = sym_lookup(sys->syms, SYM_CODE, func->entry);
+        if (sym && sym->start == func->entry) snprintf(name, sizeof(name), "%.31s", sym->name);
+        else if (func->name) snprintf(name, sizeof(name), "%s", func->name);
+        else snprintf(name, sizeof(name), "fn_%04X", func->entry);
+        printf("| %-19s : %5.1f%% of %u instructions", name, percent(count.insns_hit, count.insns), count.insns);
+        if (count.outcomes) printf(", %u of %u branch outcomes", count.outcomes_hit, count.outcomes);
+        printf("\n");
+    }
+    cfg_free(cfg);
+}
+
+// One instruction or function entry from a listing
+typedef struct {
+    uint32_t file;
+    uint32_t line;
+    uint16_t address;
+    char *func;             // Function entry when set
+} rst_entry_t;
+
+typedef struct {
+    rst_entry_t *entries;
+    size_t count, capacity;
+    char **files;
+    uint32_t file_count;
+} rst_t;
+
+static int rst_add(rst_t *rst, uint32_t file, uint32_t line, uint16_t address, const char *func) {
+    if (rst->count == rst->capacity) {
+        size_t capacity = rst->capacity ? rst->capacity * 2 : 1024;
+        rst_entry_t *entries = realloc(rst->entries, capacity * sizeof(rst_entry_t));
+        if (entries == NULL) return 1;
+        rst->entries = entries;
+        rst->capacity = capacity;
+    }
+    rst_entry_t *e = &rst->entries[rst->count++];
+    e->file = file;
+    e->line = line;
+    e->address = address;
+    e->func = func ? strdup(func) : NULL;
+    return 0;
+}
+
+static int rst_file(rst_t *rst, const char *name) {
+    for (uint32_t i = 0; i < rst->file_count; i++) {
+        if (strcmp(rst->files[i], name) == 0) return i;
+    }
+    char **files = realloc(rst->files, (rst->file_count + 1) * sizeof(char *));
+    if (files == NULL) return -1;
+    rst->files = files;
+    rst->files[rst->file_count] = strdup(name);
+    return rst->file_count++;
+}
+
+// SDCC listing lines look like
+//       000012 E5 82         [12]  101 	mov	a,dpl      (instruction)
+//       000010                      99 _main:            (label)
+//                                   97 ;	main.c:8: ... (source line marker)
+//                                   98 ;	 function main
+// The address field (4 or 6 hex digits) is near the left margin; lines
+// without one start with the listing line number much further right.
+static int rst_parse(system_8051_t *sys, const cfg_t *cfg, const coverage_t *cov, const char *path, rst_t *rst) {
+    FILE *in = fopen(path, "r");
+    if (in == NULL) {
+        printf("Error: Could not open %s\n", path);
+        return 1;
+    }
+
+    char buf[1024];
+    int file = -1;
+    uint32_t line = 0;
+    char func[128] = "";
+    int err = 0;
+    while (!err && fgets(buf, sizeof(buf), in)) {
+        char *p = buf;
+        while (*p == ' ') p++;
+        int digits = 0;
+        while (isxdigit((unsigned char)p[digits])) digits++;
+
+        if (p - buf < 16 && (digits == 4 || digits == 6) && isspace((unsigned char)p[digits])) {
+            uint16_t address = strtoul(p, NULL, 16) & 0xFFFF;
+            if (func[0] && file >= 0) {
+                err = rst_add(rst, file, line, address, func);
+                func[0] = '\0';
+            }
+            p += digits;
+            int has_bytes = p[0] == ' ' && isxdigit((unsigned char)p[1]) && isxdigit((unsigned char)p[2]) && p[3] == ' ';
+            if (!err && has_bytes && file >= 0 && ((cfg->flags[address] & CFG_INSN) || cov->exec[address])) {
+                err = rst_add(rst, file, line, address, NULL);
+            }
+            continue;
+        }
+
+        // Comment lines: skip the listing line number
+        while (isdigit((unsigned char)*p)) p++;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p++ != ';') continue;
+        while (isspace((unsigned char)*p)) p++;
+
+        char name[256];
+        unsigned number;
+        if (sscanf(p, "%255[^: \t]:%u:", name, &number) == 2 && strchr(name, '.')) {
+            file = rst_file(rst, name);
+            line = number;
+            err = file < 0;
+        }
+        else if (strncmp(p, "function", 8) == 0 && isspace((unsigned char)p[8])) {
+            sscanf(p + 8, "%127s", func);
+        }
+    }
+    fclose(in);
+    if (err) printf("Error: Out of memory reading %s\n", path);
+    return err;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const rst_entry_t *x = a, *y = b;
+    if (x->file != y->file) return x->file < y->file ? -1 : 1;
+    if (x->line != y->line) return x->line < y->line ? -1 : 1;
+    return (int)x->address - (int)y->address;
+}
+
+// One record per source file; branch outcomes are hit or not (the file
+// keeps no counts), and unexecuted branches report '-'
+static void lcov_file(system_8051_t *sys, const coverage_t *cov, const rst_t *rst, size_t first, size_t end, FILE *out) {
+    fprintf(out, "TN:\nSF:%s\n", rst->files[rst->entries[first].file]);
+
+    uint32_t fn_found = 0, fn_hit = 0;
+    for (size_t i = first; i < end; i++) {
+        const rst_entry_t *e = &rst->entries[i];
+        if (e->func) fprintf(out, "FN:%u,%s\n", e->line, e->func);
+    }
+    for (size_t i = first; i < end; i++) {
+        const rst_entry_t *e = &rst->entries[i];
+        if (e->func == NULL) continue;
+        fprintf(out, "FNDA:%d,%s\n", cov->exec[e->address] != 0, e->func);
+        fn_found++;
+        fn_hit += cov->exec[e->address] != 0;
+    }
+    fprintf(out, "FNF:%u\nFNH:%u\n", fn_found, fn_hit);
+
+    uint32_t br_found = 0, br_hit = 0;
+    for (size_t i = first; i < end; i++) {
+        const rst_entry_t *e = &rst->entries[i];
+        if (e->func || !is_branch(sys, e->address)) continue;
+        uint32_t block = 0;
+        for (size_t j = first; j < i; j++) block += rst->entries[j].line == e->line && !rst->entries[j].func && is_branch(sys, rst->entries[j].address);
+        for (int outcome = 0; outcome < 2; outcome++) {
+            int hit = (outcome ? cov->not_taken : cov->taken)[e->address] != 0;
+            if (cov->exec[e->address]) fprintf(out, "BRDA:%u,%u,%d,%d\n", e->line, block, outcome, hit);
+            else fprintf(out, "BRDA:%u,%u,%d,-\n", e->line, block, outcome);
+            br_found++;
+            br_hit += hit;
+        }
+    }
+    fprintf(out, "BRF:%u\nBRH:%u\n", br_found, br_hit);
+
+    uint32_t lines_found = 0, lines_hit = 0;
+    for (size_t i = first; i < end; ) {
+        uint32_t line = rst->entries[i].line;
+        int has_code = 0, hit = 0;
+        for (; i < end && rst->entries[i].line == line; i++) {
+            if (rst->entries[i].func) continue;
+            has_code = 1;
+            hit |= cov->exec[rst->entries[i].address] != 0;
+        }
+        if (!has_code) continue;
+        fprintf(out, "DA:%u,%d\n", line, hit);
+        lines_found++;
+        lines_hit += hit;
+    }
+    fprintf(out, "LF:%u\nLH:%u\nend_of_record\n", lines_found, lines_hit);
+}
+
+int cover_lcov(system_8051_t *sys, const coverage_t *cov, const char *const *rst_paths, int rst_count, const char *path) {
+    cfg_t *cfg = cfg_build(sys);
+    if (cfg == NULL) return 1;
+
+    rst_t rst = { 0 };
+    int err = 0;
+    for (int i = 0; !err && i < rst_count; i++) err = rst_parse(sys, cfg, cov, rst_paths[i], &rst);
+    cfg_free(cfg);
+
+    FILE *out = err ? NULL : fopen(path, "w");
+    if (!err && out == NULL) {
+        printf("Error: Could not open %s\n", path);
+        err = 1;
+    }
+    if (out) {
+        qsort(rst.entries, rst.count, sizeof(rst_entry_t), compare_entries);
+        for (size_t first = 0; first < rst.count; ) {
+            size_t end = first;
+            while (end < rst.count && rst.entries[end].file == rst.entries[first].file) end++;
+            lcov_file(sys, cov, &rst, first, end, out);
+            first = end;
+        }
+        fclose(out);
+        printf("Wrote %u source files to %s\n", rst.file_count, path);
+    }
+
+    for (size_t i = 0; i < rst.count; i++) free(rst.entries[i].func);
+    for (uint32_t i = 0; i < rst.file_count; i++) free(rst.files[i]);
+    free(rst.entries);
+    free(rst.files);
+    return err;
+}
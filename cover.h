@@ -0,0 +1,43 @@
+#ifndef COVER_H
+#define COVER_H
+
+#include <stdint.h>
+#include "system.h"
+
+// Code coverage. While sys->cover is set, the interpreter marks the address
+// of every instruction it executes and, for conditional branches, whether
+// the branch was taken or fell through. Each mark is a single byte store;
+// coverage runs skip translated (--aot) blocks and interpret everything.
+//
+// A coverage file accumulates the maps of many runs: one bit per address
+// and map, merged with an atomic OR into a shared mapping, so concurrent
+// processes can write to the same file. The file is tied to the code image
+// it was recorded on. It can be exported as an lcov tracefile through the
+// SDCC .rst listings of the program.
+
+#define COVER_MAGIC   0x31355643    // "CV51"
+#define COVER_VERSION 1
+#define COVER_MAX_RST 64            // Listings per export
+
+typedef struct coverage {
+    uint8_t exec[65536];        // Nonzero: an instruction started here
+    uint8_t taken[65536];       // Conditional branch at this address went to its target
+    uint8_t not_taken[65536];   // ... or fell through
+} coverage_t;
+
+// ORs `cov` into the coverage file at `path`, creating it if needed, and
+// counts one more run. Returns 0 on success.
+int cover_merge(system_8051_t *sys, const coverage_t *cov, const char *path);
+
+// Reads the coverage file at `path` into `cov`. Returns 0 on success.
+int cover_load(system_8051_t *sys, coverage_t *cov, const char *path, uint64_t *runs);
+
+// Instruction and branch-outcome coverage against the static CFG, in total
+// and per function
+void cover_print(system_8051_t *sys, const coverage_t *cov, uint64_t runs);
+
+// Writes an lcov tracefile for the source lines named in the SDCC .rst
+// listings. Returns 0 on success.
+int cover_lcov(system_8051_t *sys, const coverage_t *cov, const char *const *rst, int rst_count, const char *path);
+
+#endif
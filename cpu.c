@@ -1,172 +1,373 @@
 #include "system.h"
+#include "alu.h"
+#include "cosim.h"
+#include "cover.h"
+#include "journal.h"
+#include "opcodes.h"
 #include <stdio.h>
+#include <string.h>
+
+// Every helper taking `mode` is force-inlined so each entry point below gets
+// its own copy with the unused features compiled out
+#define CPU_INLINE static inline __attribute__((always_inline))
+
+#define CPU_MODE_WATCH 0x01     // Check watchpoints on every data access
+#define CPU_MODE_COVER 0x02     // Record executed addresses and branch outcomes
+
+// The variant id sits above the feature bits, so it is a compile-time
+// constant inside each entry point too
+#define CPU_MODE_VARIANT_SHIFT 4
+#define CPU_MODE_VARIANT(id) ((id) << CPU_MODE_VARIANT_SHIFT)
+#define CPU_VAR(mode) (&cpu_variants[(mode) >> CPU_MODE_VARIANT_SHIFT])
+
+// CORE VARIANTS
+// Cycle tables from the shared opcode metadata; kept as local constants so
+// the variant lookups below still fold
+static const uint8_t cycles_12t[256] = {    // Machine cycles, 12 or 6 clocks each
+#define OP(code, mn, len, cyc, cyc1t, a, b, c, fl) [code] = cyc,
+#include "opcodes.def"
+#undef OP
+};
+
+static const uint8_t cycles_1t[256] = {     // Clocks, conditional branches not taken
+#define OP(code, mn, len, cyc, cyc1t, a, b, c, fl) [code] = cyc1t,
+#include "opcodes.def"
+#undef OP
+};
+
+static const uint8_t branch_len[256] = {    // Length of conditional branches, 0 otherwise
+#define OP(code, mn, len, cyc, cyc1t, a, b, c, fl) [code] = ((fl) & OPF_BRANCH) ? len : 0,
+#include "opcodes.def"
+#undef OP
+};
+
+// Translated ROM images (aot.h) include this file with CPU_AOT defined to
+// inline cpu_exec() into every block. They only need the constants and the
+// instruction core; everything with external linkage comes from the emulator.
+#ifdef CPU_AOT
+#define CPU_STEP(fn) NULL
+#else
+#define CPU_STEP(fn) fn
+
+static void cpu_step_8051(system_8051_t *sys);
+static void cpu_step_watch_8051(system_8051_t *sys);
+static void cpu_step_cover_8051(system_8051_t *sys);
+static void cpu_step_8052(system_8051_t *sys);
+static void cpu_step_watch_8052(system_8051_t *sys);
+static void cpu_step_cover_8052(system_8051_t *sys);
+static void cpu_step_8052_x2(system_8051_t *sys);
+static void cpu_step_watch_8052_x2(system_8051_t *sys);
+static void cpu_step_cover_8052_x2(system_8051_t *sys);
+static void cpu_step_1t(system_8051_t *sys);
+static void cpu_step_watch_1t(system_8051_t *sys);
+static void cpu_step_cover_1t(system_8051_t *sys);
+#endif
+
+static const cpu_variant_t cpu_variants[CPU_VARIANT_COUNT] = {
+    [CPU_8051] = { "8051", 4096, 128, 0, 0, 12, 12, 0, cycles_12t, CPU_STEP(cpu_step_8051), CPU_STEP(cpu_step_watch_8051), CPU_STEP(cpu_step_cover_8051) },
+    [CPU_8052] = { "8052", 8192, 256, 1, 0, 12, 12, 0, cycles_12t, CPU_STEP(cpu_step_8052), CPU_STEP(cpu_step_watch_8052), CPU_STEP(cpu_step_cover_8052) },
+    [CPU_8052_X2] = { "8052x2", 65536, 256, 1, 1, 6, 6, 0, cycles_12t, CPU_STEP(cpu_step_8052_x2), CPU_STEP(cpu_step_watch_8052_x2), CPU_STEP(cpu_step_cover_8052_x2) },
+    [CPU_1T] = { "1t", 65536, 256, 1, 1, 1, 12, 1, cycles_1t, CPU_STEP(cpu_step_1t), CPU_STEP(cpu_step_watch_1t), CPU_STEP(cpu_step_cover_1t) },
+};
+
+#ifndef CPU_AOT
+const cpu_variant_t *cpu_variant_get(cpu_variant_id_t id) {
+    return &cpu_variants[id];
+}
 
-// Count the 1s in Accumulator
-static void update_parity(system_8051_t *sys) {
-    
-    uint8_t count = 0;
-    uint8_t a = sys->cpu.A;
-    
-    for (int i = 0; i < 8; i++) {
-        if (a & (1 << i)) {
-            count++;
-        }
+const cpu_variant_t *cpu_variant_find(const char *name) {
+    for (int i = 0; i < CPU_VARIANT_COUNT; i++) {
+        if (strcmp(cpu_variants[i].name, name) == 0) return &cpu_variants[i];
     }
-    
-    if (count % 2 != 0) sys->cpu.PSW |= PSW_P;
-    else sys->cpu.PSW &= ~PSW_P;
+    return NULL;
+}
+#endif
+
+// Flags by table lookup (alu.h)
+static void update_parity(system_8051_t *sys) {
+    sys->cpu.PSW = (sys->cpu.PSW & ~PSW_P) | alu_parity[sys->cpu.A];
 }
 
 static void alu_add(system_8051_t *sys, uint8_t val) {
-    uint8_t old_A = sys->cpu.A;
-    uint16_t result = old_A + val;
+    sys->cpu.PSW = alu_addc_psw(sys->cpu.A, val, 0, sys->cpu.PSW, &sys->cpu.A);
+}
 
-    //CY
-    uint8_t c7 = (result > 0xFF);
-    if (c7) sys->cpu.PSW |= PSW_CY;
-    else sys->cpu.PSW &= ~PSW_CY;
+static void alu_addc(system_8051_t *sys, uint8_t val) {
+    uint8_t carryin = (sys->cpu.PSW & PSW_CY) ? 0x01 : 0x00;
+    sys->cpu.PSW = alu_addc_psw(sys->cpu.A, val, carryin, sys->cpu.PSW, &sys->cpu.A);
+}
 
-    //Overflow calc
-    uint8_t c6 = ((old_A & 0x7F) + (val & 0x7F)) > 0x7F;
-    if (c6 ^ c7) sys->cpu.PSW |= PSW_OV;
-    else sys->cpu.PSW &= ~PSW_OV;
+static void alu_subb(system_8051_t *sys, uint8_t val) {
+    uint8_t carry = (sys->cpu.PSW & PSW_CY) ? 1 : 0;
+    sys->cpu.PSW = alu_subb_psw(sys->cpu.A, val, carry, sys->cpu.PSW, &sys->cpu.A);
+}
 
-    //AC
-    if ((old_A & 0x0F) + (val & 0x0F) > 0x0F) sys->cpu.PSW |= PSW_AC;
-    else sys->cpu.PSW &= ~PSW_AC;
+// Memory accessors. `mode` is always a compile-time constant: with
+// CPU_MODE_WATCH clear the watchpoint tests fold away entirely, and so do
+// the variant limits that do not apply.
+// MOVC tables are read from the live code view: writes to code memory only
+// drop the translated blocks whose own bytes changed
+CPU_INLINE uint8_t movc_rd(system_8051_t *sys, uint16_t address, const int mode) {
+    if (sys->EA != 0 && address < CPU_VAR(mode)->rom_size) return sys->irom[address];
+    return sys->xrom[address];
+}
 
-    sys->cpu.A = (uint8_t)result;
-    update_parity(sys);
+// Instruction bytes
+CPU_INLINE uint8_t code_rd(system_8051_t *sys, uint16_t address, const int mode) {
+#ifdef CPU_AOT
+    return aot_rom[address];    // Snapshot of the code view, folds to a constant
+#endif
+    return movc_rd(sys, address, mode);
 }
 
-static void alu_addc(system_8051_t *sys, uint8_t val) {
-    uint8_t old_A = sys->cpu.A;
-    uint8_t carryin = (sys->cpu.PSW & PSW_CY) ? 0x01 : 0x00;
-    uint16_t result = old_A + val + carryin;
+CPU_INLINE uint8_t ram_rd(system_8051_t *sys, uint8_t address, const int mode) {
+    if (CPU_VAR(mode)->iram_size == 128 && address >= 0x80) { // Nothing there
+        SANITIZE(sanitize_report(sys, SAN_NO_UPPER_IRAM, address));
+        return 0xFF;
+    }
+    SANITIZE(if (!sanitize_bit(sys->san.iram_written, address)) sanitize_report(sys, SAN_UNINIT_IRAM, address));
+    uint8_t value = sys->iram[address];
+    if ((mode & CPU_MODE_WATCH) && (sys->dbg.iram_page[address >> WATCH_IRAM_SHIFT] & WATCH_READ)) {
+        debug_watch_check(sys, SPACE_IRAM, address, WATCH_READ, value);
+    }
+    return value;
+}
 
-    //CY
-    uint8_t c7 = (result > 0xFF);
-    if (c7) sys->cpu.PSW |= PSW_CY;
-    else sys->cpu.PSW &= ~PSW_CY;
+CPU_INLINE void ram_wr(system_8051_t *sys, uint8_t address, uint8_t value, const int mode) {
+    if ((mode & CPU_MODE_WATCH) && (sys->dbg.iram_page[address >> WATCH_IRAM_SHIFT] & WATCH_WRITE)) {
+        debug_watch_check(sys, SPACE_IRAM, address, WATCH_WRITE, value);
+    }
+    if (CPU_VAR(mode)->iram_size == 128 && address >= 0x80) {
+        SANITIZE(sanitize_report(sys, SAN_NO_UPPER_IRAM, address));
+        return;
+    }
+    SANITIZE(sanitize_set_bit(sys->san.iram_written, address));
+    if ((mode & CPU_MODE_WATCH) && sys->journal) journal_note(sys->journal, SPACE_IRAM, address, sys->iram[address], value);
+    sys->iram[address] = value;
+}
 
-    //Overflow calc
-    uint8_t c6 = ((old_A & 0x7F) + (val & 0x7F) + carryin) > 0x7F;
-    if (c6 ^ c7) sys->cpu.PSW |= PSW_OV;
-    else sys->cpu.PSW &= ~PSW_OV;
+CPU_INLINE uint8_t xram_rd(system_8051_t *sys, uint16_t address, const int mode) {
+    // Device pages are not memory
+    SANITIZE(if (sys->xdata[address >> XDATA_PAGE_SHIFT].mem && !sanitize_bit(sys->san.xram_written, address)) {
+        sanitize_report(sys, SAN_UNINIT_XRAM, address);
+    });
+    uint8_t value = system_read_xram(sys, address);
+    if ((mode & CPU_MODE_WATCH) && (sys->dbg.xram_page[address >> WATCH_XRAM_SHIFT] & WATCH_READ)) {
+        debug_watch_check(sys, SPACE_XRAM, address, WATCH_READ, value);
+    }
+    return value;
+}
 
-    //AC
-    if ((old_A & 0x0F) + (val & 0x0F) + carryin > 0x0F) sys->cpu.PSW |= PSW_AC;
-    else sys->cpu.PSW &= ~PSW_AC;
+CPU_INLINE void xram_wr(system_8051_t *sys, uint16_t address, uint8_t value, const int mode) {
+    if ((mode & CPU_MODE_WATCH) && (sys->dbg.xram_page[address >> WATCH_XRAM_SHIFT] & WATCH_WRITE)) {
+        debug_watch_check(sys, SPACE_XRAM, address, WATCH_WRITE, value);
+    }
+    SANITIZE(sanitize_set_bit(sys->san.xram_written, address));
+    if ((mode & CPU_MODE_WATCH) && sys->journal) {
+        // Device pages cannot be read back: their writes always count as changes
+        const uint8_t *mem = sys->xdata[address >> XDATA_PAGE_SHIFT].mem;
+        journal_note(sys->journal, SPACE_XRAM, address, mem ? mem[address & 0xFF] : (uint8_t)~value, value);
+    }
+    system_write_xram(sys, address, value);
+}
 
-    sys->cpu.A = (uint8_t)result;
-    update_parity(sys);
+// Pushes and pops (SP already moved for a push)
+CPU_INLINE void stack_wr(system_8051_t *sys, uint8_t value, const int mode) {
+    SANITIZE(sanitize_stack_write(sys));
+    ram_wr(sys, sys->cpu.SP, value, mode);
 }
 
-static void alu_subb(system_8051_t *sys, uint8_t val) {
-    uint8_t carry = (sys->cpu.PSW & PSW_CY) ? 1 : 0;
-    uint16_t result = sys->cpu.A - val - carry;
-
-    //CY (Borrow)
-    // If result > 255, it means we wrapped around (underflowed)
-    // e.g. 5 - 6 = -1 (0xFFFF in uint16). 0xFFFF > 0xFF.
-    if (result > 0xFF) sys->cpu.PSW |= PSW_CY;
-    else sys->cpu.PSW &= ~PSW_CY;
-
-    //AC (Aux Borrow)
-    if ((sys->cpu.A & 0x0F) < (val & 0x0F) + carry) sys->cpu.PSW |= PSW_AC;
-    else sys->cpu.PSW &= ~PSW_AC;
-
-    //OV
-    uint8_t c7 = (result > 0xFF);
-    uint8_t c6 = ((sys->cpu.A & 0x7F) < ((val & 0x7F) + carry));
-    if (c6 ^ c7) sys->cpu.PSW |= PSW_OV;
-    else sys->cpu.PSW &= ~PSW_OV;
-
-    sys->cpu.A = (uint8_t)result;
-    update_parity(sys);
+CPU_INLINE uint8_t stack_rd(system_8051_t *sys, const int mode) {
+    SANITIZE(sanitize_stack_read(sys));
+    return ram_rd(sys, sys->cpu.SP, mode);
 }
 
-//handling direct addressing for SFRs
-static uint8_t iram_read(system_8051_t *sys, uint8_t address) {
-    if(address < 0x80) return sys->iram[address];
-    else {
+#ifndef CPU_AOT
+// SFRs that only some variants have. Return 1 if the address was handled.
+static int variant_sfr_read(system_8051_t *sys, uint8_t address, uint8_t *value) {
+    if (sys->variant->has_timer2) {
         switch (address) {
-            case 0xE0: return sys->cpu.A;
-            case 0xF0: return sys->cpu.B;
-            case 0x81: return sys->cpu.SP;
-            case 0xD0: return sys->cpu.PSW;
-            case 0x88: return sys->sfr.TCON;
-            case 0x89: return sys->sfr.TMOD;
-            case 0x8A: return sys->sfr.TL0;
-            case 0x8B: return sys->sfr.TL1;
-            case 0x8C: return sys->sfr.TH0;
-            case 0x8D: return sys->sfr.TH1;
-            case 0x80: return sys->sfr.P0;
-            case 0x90: return sys->sfr.P1;
-            case 0xA0: return sys->sfr.P2;
-            case 0xB0: return sys->sfr.P3;
-            case 0x82: return (uint8_t)(sys->cpu.DPTR & 0x00FF); // DPL
-            case 0x83: return (uint8_t)(sys->cpu.DPTR >> 8);     // DPH
-            case 0x98: return sys->sfr.SCON;
-            case 0x99: return sys->sfr.SBUF;
-            case 0xA8: return sys->sfr.IE;
-            case 0xB8: return sys->sfr.IP;
-            case 0x87: return sys->sfr.PCON;
-            
-            default:
-                printf("Unknown SFR address: 0x%02X\n", address);
-                return 0;
+            case 0xC8: *value = sys->sfr.T2CON; return 1;
+            case 0xC9: *value = sys->sfr.T2MOD; return 1;
+            case 0xCA: *value = sys->sfr.RCAP2L; return 1;
+            case 0xCB: *value = sys->sfr.RCAP2H; return 1;
+            case 0xCC: *value = sys->sfr.TL2; return 1;
+            case 0xCD: *value = sys->sfr.TH2; return 1;
         }
     }
+    if (sys->variant->dual_dptr && address == 0xA2) {
+        *value = sys->sfr.AUXR1;
+        return 1;
+    }
+    return 0;
 }
 
-static void iram_write(system_8051_t *sys, uint8_t address, uint8_t value) {
-    if(address < 0x80) sys->iram[address] = value;
-    else {
+static int variant_sfr_write(system_8051_t *sys, uint8_t address, uint8_t value) {
+    if (sys->variant->has_timer2) {
         switch (address) {
-            case 0xE0:
-                sys->cpu.A = value;
-                update_parity(sys);
-                break;
-            
-            case 0xF0: sys->cpu.B = value; break;
-            case 0x81: sys->cpu.SP = value; break;
-            
-            case 0xD0: 
-                sys->cpu.PSW = value; 
-                update_parity(sys);
-                break;
+            case 0xC8:
+                sys->sfr.T2CON = value;
+                interrupt_update(sys);
+                return 1;
+            case 0xC9: sys->sfr.T2MOD = value; return 1;
+            case 0xCA: sys->sfr.RCAP2L = value; return 1;
+            case 0xCB: sys->sfr.RCAP2H = value; return 1;
+            case 0xCC: sys->sfr.TL2 = value; return 1;
+            case 0xCD: sys->sfr.TH2 = value; return 1;
+        }
+    }
+    if (sys->variant->dual_dptr && address == 0xA2) {
+        // The active pointer always lives in cpu.DPTR, so switching is a swap
+        if ((value ^ sys->sfr.AUXR1) & AUXR1_DPS) {
+            uint16_t tmp = sys->cpu.DPTR;
+            sys->cpu.DPTR = sys->cpu.DPTR_alt;
+            sys->cpu.DPTR_alt = tmp;
+        }
+        sys->sfr.AUXR1 = value;
+        return 1;
+    }
+    return 0;
+}
 
-            case 0x88: sys->sfr.TCON = value; break; 
-            case 0x89: sys->sfr.TMOD = value; break; 
-            case 0x8A: sys->sfr.TL0 = value; break;
-            case 0x8B: sys->sfr.TL1 = value; break;
-            case 0x8C: sys->sfr.TH0 = value; break;
-            case 0x8D: sys->sfr.TH1 = value; break;
-            case 0x80: sys->sfr.P0 = value; break;
-            case 0x90: sys->sfr.P1 = value; break;
-            case 0xA0: sys->sfr.P2 = value; break;
-            case 0xB0: sys->sfr.P3 = value; break;
-
-            case 0x82: //DPL
-                sys->cpu.DPTR = (sys->cpu.DPTR & 0xFF00) | value; 
-                break;
+//handling direct addressing for SFRs
+uint8_t sfr_read(system_8051_t *sys, uint8_t address) {
+    switch (address) {
+        case 0xE0: return sys->cpu.A;
+        case 0xF0: return sys->cpu.B;
+        case 0x81: return sys->cpu.SP;
+        case 0xD0: return sys->cpu.PSW;
+        case 0x88: return sys->sfr.TCON;
+        case 0x89: return sys->sfr.TMOD;
+        case 0x8A: return sys->sfr.TL0;
+        case 0x8B: return sys->sfr.TL1;
+        case 0x8C: return sys->sfr.TH0;
+        case 0x8D: return sys->sfr.TH1;
+        case 0x80: return sys->sfr.P0;
+        case 0x90: return sys->sfr.P1;
+        case 0xA0: return sys->sfr.P2;
+        case 0xB0: return sys->sfr.P3;
+        case 0x82: return (uint8_t)(sys->cpu.DPTR & 0x00FF); // DPL
+        case 0x83: return (uint8_t)(sys->cpu.DPTR >> 8);     // DPH
+        case 0x98: return sys->sfr.SCON;
+        case 0x99: return sys->sfr.SBUF;
+        case 0xA8: return sys->sfr.IE;
+        case 0xB8: return sys->sfr.IP;
+        case 0x87: return sys->sfr.PCON;
+        
+        default: {
+            uint8_t value;
+            if (variant_sfr_read(sys, address, &value)) return value;
+            printf("Unknown SFR address: 0x%02X\n", address);
+            return 0;
+        }
+    }
+}
 
-            case 0x83: //DPH
-                sys->cpu.DPTR = (sys->cpu.DPTR & 0x00FF) | ((uint16_t)value << 8); 
-                break;
+// Port latch writes; edges are reported to the port log when one is attached
+static void port_write(system_8051_t *sys, uint8_t port, uint8_t *latch, uint8_t value) {
+    uint8_t old = *latch;
+    *latch = value;
+    if (sys->portlog && old != value) portlog_emit(sys->portlog, sys->cpu.cycles, port, old, value);
+    if (sys->cosim && old != value) cosim_port_write(sys, port, old, value);
+}
 
-            case 0x98: sys->sfr.SCON = value; break;
-            case 0x99: sys->sfr.SBUF = value; break;
-            case 0xA8: sys->sfr.IE = value; break;
-            case 0xB8: sys->sfr.IP = value; break;
-            case 0x87: sys->sfr.PCON = value; break;
-            
-            default:
-                printf("Unknown SFR address: 0x%02X\n", address);
-                break;
+void sfr_write(system_8051_t *sys, uint8_t address, uint8_t value) {
+    switch (address) {
+        case 0xE0:
+            sys->cpu.A = value;
+            update_parity(sys);
+            break;
+        
+        case 0xF0: sys->cpu.B = value; break;
+        case 0x81:
+            sys->cpu.SP = value;
+            SANITIZE(sanitize_set_sp(sys, value));
+            break;
+        
+        case 0xD0: 
+            sys->cpu.PSW = value; 
+            SANITIZE(sanitize_set_psw(sys, value));
+            update_parity(sys);
+            interrupt_update(sys);
+            break;
+
+        case 0x88:
+            sys->sfr.TCON = value;
+            interrupt_update(sys);
+            break;
+
+        case 0x89: sys->sfr.TMOD = value; break; 
+        case 0x8A: sys->sfr.TL0 = value; break;
+        case 0x8B: sys->sfr.TL1 = value; break;
+        case 0x8C: sys->sfr.TH0 = value; break;
+        case 0x8D: sys->sfr.TH1 = value; break;
+        case 0x80: port_write(sys, 0, &sys->sfr.P0, value); break;
+        case 0x90: port_write(sys, 1, &sys->sfr.P1, value); break;
+        case 0xA0: port_write(sys, 2, &sys->sfr.P2, value); break;
+        case 0xB0: {
+            uint8_t old_p3 = sys->sfr.P3;
+            port_write(sys, 3, &sys->sfr.P3, value);
+            interrupt_pins(sys, old_p3);
+            break;
         }
+
+        case 0x82: //DPL
+            sys->cpu.DPTR = (sys->cpu.DPTR & 0xFF00) | value; 
+            break;
+
+        case 0x83: //DPH
+            sys->cpu.DPTR = (sys->cpu.DPTR & 0x00FF) | ((uint16_t)value << 8); 
+            break;
+
+        case 0x98:
+            sys->sfr.SCON = value;
+            interrupt_update(sys);
+            break;
+
+        case 0x99: uart_write_sbuf(sys, value); break;
+
+        case 0xA8:
+            sys->sfr.IE = value;
+            sys->irq.hold = 1;
+            interrupt_update(sys);
+            break;
+
+        case 0xB8:
+            sys->sfr.IP = value;
+            sys->irq.hold = 1;
+            interrupt_update(sys);
+            break;
+
+        case 0x87: sys->sfr.PCON = value; break;
+        
+        default:
+            if (variant_sfr_write(sys, address, value)) break;
+            printf("Unknown SFR address: 0x%02X\n", address);
+            break;
+    }
+}
+#endif
+
+CPU_INLINE uint8_t iram_read(system_8051_t *sys, uint8_t address, const int mode) {
+    if(address < 0x80) return ram_rd(sys, address, mode);
+
+    uint8_t value = sfr_read(sys, address);
+    if ((mode & CPU_MODE_WATCH) && (sys->dbg.sfr_page[address >> WATCH_IRAM_SHIFT] & WATCH_READ)) {
+        debug_watch_check(sys, SPACE_SFR, address, WATCH_READ, value);
+    }
+    return value;
+}
+
+CPU_INLINE void iram_write(system_8051_t *sys, uint8_t address, uint8_t value, const int mode) {
+    if(address < 0x80) {
+        ram_wr(sys, address, value, mode);
+        return;
+    }
+
+    if ((mode & CPU_MODE_WATCH) && (sys->dbg.sfr_page[address >> WATCH_IRAM_SHIFT] & WATCH_WRITE)) {
+        debug_watch_check(sys, SPACE_SFR, address, WATCH_WRITE, value);
     }
+    sfr_write(sys, address, value);
 }
 
 static uint8_t get_rx_addr(system_8051_t *sys, uint8_t reg_index) {
@@ -191,53 +392,68 @@ static uint8_t get_rx_addr(system_8051_t *sys, uint8_t reg_index) {
 
 }
 
-static uint8_t get_indirect_addr(system_8051_t *sys, uint8_t reg_index) {
+CPU_INLINE uint8_t get_indirect_addr(system_8051_t *sys, uint8_t reg_index, const int mode) {
     if(reg_index != 0 && reg_index != 1) {
         printf("Invalid register pointer\n");
         return 0x00;
     }
 
-    return sys->iram[get_rx_addr(sys, reg_index)];
+    return ram_rd(sys, get_rx_addr(sys, reg_index), mode);
 }
 
-static uint8_t bit_read(system_8051_t * sys, uint8_t bit_addr) {
+CPU_INLINE uint8_t bit_read(system_8051_t * sys, uint8_t bit_addr, const int mode) {
     if(bit_addr < 0x80) { //iram
         uint8_t byte_addr = 0x20 + (bit_addr >> 3);
         uint8_t bit_index = bit_addr & 0x07;
-        if(iram_read(sys, byte_addr) & (0x01 << bit_index)) return 0x01;
+        if(iram_read(sys, byte_addr, mode) & (0x01 << bit_index)) return 0x01;
         else return 0x00;
     }
     //SFRs
     uint8_t byte_addr = bit_addr & 0xF8;
     uint8_t bit_index = bit_addr & 0x07;
-    if(iram_read(sys, byte_addr) & (0x01 << bit_index)) return 0x01;
+    if(iram_read(sys, byte_addr, mode) & (0x01 << bit_index)) return 0x01;
     else return 0x00;
 }
 
-static void bit_write(system_8051_t *sys, uint8_t bit_addr, uint8_t val) {
+CPU_INLINE void bit_write(system_8051_t *sys, uint8_t bit_addr, uint8_t val, const int mode) {
     if(bit_addr < 0x80) { //iram
         uint8_t byte_addr = 0x20 + (bit_addr >> 3);
         uint8_t bit_index = bit_addr & 0x07;
-        if(val) sys->iram[byte_addr] |= (0x01 << bit_index);
-        else sys->iram[byte_addr] &= ~(0x01 << bit_index);
+        SANITIZE(sanitize_set_bit(sys->san.iram_written, byte_addr)); // Not a read of the other bits
+        if(val) ram_wr(sys, byte_addr, ram_rd(sys, byte_addr, mode) | (0x01 << bit_index), mode);
+        else ram_wr(sys, byte_addr, ram_rd(sys, byte_addr, mode) & ~(0x01 << bit_index), mode);
         return;
     }
     //SFRs
     uint8_t byte_addr = bit_addr & 0xF8;
     uint8_t bit_index = bit_addr & 0x07;
     if(val) {
-        uint8_t send = iram_read(sys, byte_addr) | (0x01 << bit_index);
-        iram_write(sys, byte_addr, send);
+        uint8_t send = iram_read(sys, byte_addr, mode) | (0x01 << bit_index);
+        iram_write(sys, byte_addr, send, mode);
     }
     else {
-        uint8_t send = iram_read(sys, byte_addr) & ~(0x01 << bit_index);
-        iram_write(sys, byte_addr, send);
+        uint8_t send = iram_read(sys, byte_addr, mode) & ~(0x01 << bit_index);
+        iram_write(sys, byte_addr, send, mode);
     }
 }
 
-void cpu_step(system_8051_t *sys) {
+// Conditional branch taken; single-cycle cores pay for the refetch
+CPU_INLINE void take_branch(system_8051_t *sys, int8_t offset, const int mode) {
+    sys->cpu.PC += offset;
+    sys->cpu.cycles += CPU_VAR(mode)->taken_extra * CPU_VAR(mode)->cycle_clocks;
+}
+
+CPU_INLINE void cpu_exec(system_8051_t *sys, const int mode) {
+    if (mode & CPU_MODE_WATCH) sys->dbg.insn_pc = sys->cpu.PC;
+    SANITIZE(sys->san.insn_pc = sys->cpu.PC);
+
+    // The watch entry point stands in for the cover one while watchpoints are set
+    const int covering = (mode & CPU_MODE_COVER) || ((mode & CPU_MODE_WATCH) && sys->cover);
+    const uint16_t insn_pc = sys->cpu.PC;
+    if (covering) sys->cover->exec[insn_pc] = 1;
+
     // 1. FETCH
-    uint8_t opcode = system_read_code(sys, sys->cpu.PC);
+    uint8_t opcode = code_rd(sys, sys->cpu.PC, mode);
     
     // 2. INCREMENT
     sys->cpu.PC++;
@@ -246,42 +462,36 @@ void cpu_step(system_8051_t *sys) {
     switch (opcode) {
         
         case 0x00: //NOP
-            sys->cpu.cycles += 12;
             break;
         
         case 0x74: //MOV A, #value
-            sys->cpu.A = system_read_code(sys, sys->cpu.PC);
+            sys->cpu.A = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            sys->cpu.cycles += 12;
             break;
 
         case 0x04: //INC A
             sys->cpu.A++;
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
 
         case 0x14: //DEC A
             sys->cpu.A--;
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
 
         case 0x24: { //ADD A, #value
-            uint8_t val = system_read_code(sys, sys->cpu.PC);
+            uint8_t val = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
             alu_add(sys, val);
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0x94: {//SUBB A, #value
-            uint8_t val = system_read_code(sys, sys->cpu.PC);
+            uint8_t val = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
             alu_subb(sys, val);
-            sys->cpu.cycles += 12;
             break;
         }
 
@@ -295,7 +505,6 @@ void cpu_step(system_8051_t *sys) {
             else sys->cpu.PSW &= ~PSW_OV;
 
             update_parity(sys);
-            sys->cpu.cycles += 48;
             break;
         }
 
@@ -303,7 +512,6 @@ void cpu_step(system_8051_t *sys) {
             sys->cpu.PSW &= ~PSW_CY;
             if(sys->cpu.B == 0){
                 sys->cpu.PSW |= PSW_OV;
-                sys->cpu.cycles += 48;
                 break;
             }
             else sys->cpu.PSW &= ~PSW_OV;
@@ -314,78 +522,68 @@ void cpu_step(system_8051_t *sys) {
             sys->cpu.B = r;
 
             update_parity(sys);
-            sys->cpu.cycles += 48;
             break;
         }
 
         case 0x54: { //ANL A, #value
-            uint8_t val = system_read_code(sys, sys->cpu.PC);
+            uint8_t val = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
             sys->cpu.A &= val;
 
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0x44: { //ORL A, #value
-            uint8_t val = system_read_code(sys, sys->cpu.PC);
+            uint8_t val = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
             sys->cpu.A |= val;
 
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0x64: { //XRL A, #value
-            uint8_t val = system_read_code(sys, sys->cpu.PC);
+            uint8_t val = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
             sys->cpu.A ^= val;
 
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0x60: { //JZ label
-            int8_t offset = (int8_t)system_read_code(sys, sys->cpu.PC);
+            int8_t offset = (int8_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            if(sys->cpu.A == 0) sys->cpu.PC += offset;
-
-            sys->cpu.cycles += 24;
+            if(sys->cpu.A == 0) take_branch(sys, offset, mode);
             break;
         }
 
         case 0x70: { //JNZ label
-            int8_t offset = (int8_t)system_read_code(sys, sys->cpu.PC);
+            int8_t offset = (int8_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            if(sys->cpu.A != 0) sys->cpu.PC += offset;
-
-            sys->cpu.cycles += 24;
+            if(sys->cpu.A != 0) take_branch(sys, offset, mode);
             break;
         }
 
         case 0x80: { //SJMP sadd
-            int8_t offset = (int8_t)system_read_code(sys, sys->cpu.PC);
+            int8_t offset = (int8_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
             sys->cpu.PC += offset;
-            sys->cpu.cycles += 24;
             break;
         }
 
         case 0x02: { //LJMP ladd
-            uint16_t highaddr = system_read_code(sys, sys->cpu.PC);
+            uint16_t highaddr = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            uint8_t lowaddr = system_read_code(sys, sys->cpu.PC);
+            uint8_t lowaddr = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
             sys->cpu.PC = (uint16_t)((highaddr << 8) + lowaddr);
-            sys->cpu.cycles += 24;
             break;
         }
 
@@ -394,71 +592,67 @@ void cpu_step(system_8051_t *sys) {
         case 0xDC: case 0xDD: case 0xDE: case 0xDF: {
             uint8_t reg_index = opcode & 0x07;
             uint8_t rx_addr = get_rx_addr(sys, reg_index);
-            int8_t offset = (int8_t)system_read_code(sys, sys->cpu.PC);
+            int8_t offset = (int8_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            sys->iram[rx_addr]--;
-            if(sys->iram[rx_addr] != 0) sys->cpu.PC += offset;
-            sys->cpu.cycles += 24;
+            uint8_t rx = ram_rd(sys, rx_addr, mode);
+            rx--;
+            ram_wr(sys, rx_addr, rx, mode);
+            if(rx != 0) take_branch(sys, offset, mode);
             break;
         }
 
         case 0xD5: { //DJNZ addr, label
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            int8_t offset = (int8_t)system_read_code(sys, sys->cpu.PC);
+            int8_t offset = (int8_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            uint8_t val = iram_read(sys, target);
+            uint8_t val = iram_read(sys, target, mode);
             val--;
-            iram_write(sys, target, val);
-            if(val != 0) sys->cpu.PC += offset;
-            sys->cpu.cycles += 24;
+            iram_write(sys, target, val, mode);
+            if(val != 0) take_branch(sys, offset, mode);
             break;
         }
 
         case 0xB4: { //CJNE A, #value, label
-            uint8_t val = system_read_code(sys, sys->cpu.PC);
+            uint8_t val = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            int8_t offset = (int8_t)system_read_code(sys, sys->cpu.PC);
+            int8_t offset = (int8_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
             if(sys->cpu.A < val) {
                 sys->cpu.PSW |= PSW_CY;
-                sys->cpu.PC += offset;
+                take_branch(sys, offset, mode);
             }
             else if(sys->cpu.A > val) {
                 sys->cpu.PSW &= ~PSW_CY;
-                sys->cpu.PC += offset;
+                take_branch(sys, offset, mode);
             }
             else {
                 sys->cpu.PSW &= ~PSW_CY;
             }
-
-            sys->cpu.cycles += 24;
             break;
         }
 
         case 0xB5: { //CJNE A, addr, label
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
-            uint8_t val = iram_read(sys, target);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
+            uint8_t val = iram_read(sys, target, mode);
             sys->cpu.PC++;
-            int8_t offset = (int8_t)system_read_code(sys, sys->cpu.PC);
+            int8_t offset = (int8_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
             if(sys->cpu.A < val) {
                 sys->cpu.PSW |= PSW_CY;
-                sys->cpu.PC += offset;
+                take_branch(sys, offset, mode);
             }
             else if(sys->cpu.A > val) {
                 sys->cpu.PSW &= ~PSW_CY;
-                sys->cpu.PC += offset;
+                take_branch(sys, offset, mode);
             }
             else {
                 sys->cpu.PSW &= ~PSW_CY;
             }
-
-            sys->cpu.cycles += 24;
             break;
         }
 
@@ -467,49 +661,46 @@ void cpu_step(system_8051_t *sys) {
         case 0xBC: case 0xBD: case 0xBE: case 0xBF: {
             uint8_t reg_index = opcode & 0x07;
             uint8_t rx_addr = get_rx_addr(sys, reg_index);
-            uint8_t val = system_read_code(sys, sys->cpu.PC);
+            uint8_t val = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            int8_t offset = (int8_t)system_read_code(sys, sys->cpu.PC);
+            int8_t offset = (int8_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            if(sys->iram[rx_addr] < val) {
+            uint8_t rx = ram_rd(sys, rx_addr, mode);
+            if(rx < val) {
                 sys->cpu.PSW |= PSW_CY;
-                sys->cpu.PC += offset;
+                take_branch(sys, offset, mode);
             }
-            else if(sys->iram[rx_addr] > val) {
+            else if(rx > val) {
                 sys->cpu.PSW &= ~PSW_CY;
-                sys->cpu.PC += offset;
+                take_branch(sys, offset, mode);
             }
             else {
                 sys->cpu.PSW &= ~PSW_CY;
             }
-
-            sys->cpu.cycles += 24;
             break;
         }
 
         //CJNE @Rx, #value, label
         case 0xB6: case 0xB7: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t target = get_indirect_addr(sys, reg_index);
-            uint8_t val = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = get_indirect_addr(sys, reg_index, mode);
+            uint8_t val = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            int8_t offset = (int8_t)system_read_code(sys, sys->cpu.PC);
+            int8_t offset = (int8_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            if(sys->iram[target] < val) {
+            if(ram_rd(sys, target, mode) < val) {
                 sys->cpu.PSW |= PSW_CY;
-                sys->cpu.PC += offset;
+                take_branch(sys, offset, mode);
             }
-            else if(sys->iram[target] > val) {
+            else if(ram_rd(sys, target, mode) > val) {
                 sys->cpu.PSW &= ~PSW_CY;
-                sys->cpu.PC += offset;
+                take_branch(sys, offset, mode);
             }
             else {
                 sys->cpu.PSW &= ~PSW_CY;
             }
-
-            sys->cpu.cycles += 24;
             break;
         }
 
@@ -517,50 +708,45 @@ void cpu_step(system_8051_t *sys) {
         case 0x01: case 0x21: case 0x41: case 0x61:
         case 0x81: case 0xA1: case 0xC1: case 0xE1: {
             uint16_t mid3 = (uint16_t)((opcode & 0xE0) << 3); //3 bits after top 5
-            uint16_t low8 = (uint16_t)system_read_code(sys, sys->cpu.PC);
+            uint16_t low8 = (uint16_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
             uint16_t high5 = sys->cpu.PC & 0xF800; //top 5 bits
 
             sys->cpu.PC = high5 + mid3 + low8;
-            sys->cpu.cycles += 24;
             break;
         }
 
         case 0xC0: { //PUSH addr
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
             sys->cpu.SP++;
-            uint8_t val = iram_read(sys, target);
-            sys->iram[sys->cpu.SP] = val;
-            sys->cpu.cycles += 24;
+            uint8_t val = iram_read(sys, target, mode);
+            stack_wr(sys, val, mode);
             break;
         }
 
         case 0xD0: { //POP addr
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            uint8_t val = sys->iram[sys->cpu.SP];
-            iram_write(sys, target, val);
+            uint8_t val = stack_rd(sys, mode);
+            iram_write(sys, target, val, mode);
             sys->cpu.SP--;
-            sys->cpu.cycles += 24;
             break;
         }
 
         case 0x12: { //LCALL ladd
-            uint16_t highaddr = (uint16_t)system_read_code(sys, sys->cpu.PC);
+            uint16_t highaddr = (uint16_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            uint8_t lowaddr = system_read_code(sys, sys->cpu.PC);
+            uint8_t lowaddr = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
             sys->cpu.SP++;
-            sys->iram[sys->cpu.SP] = (uint8_t)sys->cpu.PC;
+            stack_wr(sys, (uint8_t)sys->cpu.PC, mode);
             sys->cpu.SP++;
-            sys->iram[sys->cpu.SP] = (uint8_t)(sys->cpu.PC >> 8);
+            stack_wr(sys, (uint8_t)(sys->cpu.PC >> 8), mode);
             sys->cpu.PC = (uint16_t)((highaddr << 8) + lowaddr);
-
-            sys->cpu.cycles += 24;
             break;
         }
 
@@ -568,28 +754,24 @@ void cpu_step(system_8051_t *sys) {
         case 0x11: case 0x31: case 0x51: case 0x71:
         case 0x91: case 0xB1: case 0xD1: case 0xF1: {
             uint16_t mid3 = (uint16_t)((opcode & 0xE0) << 3); //3 bits after top 5
-            uint16_t low8 = (uint16_t)system_read_code(sys, sys->cpu.PC);
+            uint16_t low8 = (uint16_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
             uint16_t high5 = sys->cpu.PC & 0xF800; //top 5 bits
 
             sys->cpu.SP++;
-            sys->iram[sys->cpu.SP] = (uint8_t)sys->cpu.PC;
+            stack_wr(sys, (uint8_t)sys->cpu.PC, mode);
             sys->cpu.SP++;
-            sys->iram[sys->cpu.SP] = (uint8_t)(sys->cpu.PC >> 8);
+            stack_wr(sys, (uint8_t)(sys->cpu.PC >> 8), mode);
             sys->cpu.PC = high5 + mid3 + low8;
-
-            sys->cpu.cycles += 24;
             break;
         }
 
         case 0x22: { //RET
-            uint16_t highaddr = (uint16_t)sys->iram[sys->cpu.SP];
+            uint16_t highaddr = (uint16_t)stack_rd(sys, mode);
             sys->cpu.SP--;
-            uint8_t lowaddr = sys->iram[sys->cpu.SP];
+            uint8_t lowaddr = stack_rd(sys, mode);
             sys->cpu.SP--;
             sys->cpu.PC = (uint16_t)((highaddr << 8) + lowaddr);
-
-            sys->cpu.cycles += 24;
             break;
         }
 
@@ -599,9 +781,8 @@ void cpu_step(system_8051_t *sys) {
             uint8_t reg_index = opcode & 0x07;
             uint8_t rx_addr = get_rx_addr(sys, reg_index);
 
-            sys->cpu.A = sys->iram[rx_addr];
+            sys->cpu.A = ram_rd(sys, rx_addr, mode);
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
@@ -611,8 +792,7 @@ void cpu_step(system_8051_t *sys) {
             uint8_t reg_index = opcode & 0x07;
             uint8_t rx_addr = get_rx_addr(sys, reg_index);
 
-            sys->iram[rx_addr] = sys->cpu.A;
-            sys->cpu.cycles += 12;
+            ram_wr(sys, rx_addr, sys->cpu.A, mode);
             break;
         }
 
@@ -621,11 +801,10 @@ void cpu_step(system_8051_t *sys) {
         case 0x7C: case 0x7D: case 0x7E: case 0x7F: {
             uint8_t reg_index = opcode & 0x07;
             uint8_t rx_addr = get_rx_addr(sys, reg_index);
-            uint8_t val = system_read_code(sys, sys->cpu.PC);
+            uint8_t val = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            sys->iram[rx_addr] = val;
-            sys->cpu.cycles += 12;
+            ram_wr(sys, rx_addr, val, mode);
             break;
         }
 
@@ -634,10 +813,9 @@ void cpu_step(system_8051_t *sys) {
         case 0x2C: case 0x2D: case 0x2E: case 0x2F: {
             uint8_t reg_index = opcode & 0x07;
             uint8_t rx_addr = get_rx_addr(sys, reg_index);
-            uint8_t val = sys->iram[rx_addr];
+            uint8_t val = ram_rd(sys, rx_addr, mode);
 
             alu_add(sys, val);
-            sys->cpu.cycles += 12;
             break;
         }
 
@@ -646,10 +824,9 @@ void cpu_step(system_8051_t *sys) {
         case 0x9C: case 0x9D: case 0x9E: case 0x9F: {
             uint8_t reg_index = opcode & 0x07;
             uint8_t rx_addr = get_rx_addr(sys, reg_index);
-            uint8_t val = sys->iram[rx_addr];
+            uint8_t val = ram_rd(sys, rx_addr, mode);
 
             alu_subb(sys, val);
-            sys->cpu.cycles += 12;
             break;
         }
 
@@ -659,8 +836,7 @@ void cpu_step(system_8051_t *sys) {
             uint8_t reg_index = opcode & 0x07;
             uint8_t rx_addr = get_rx_addr(sys, reg_index);
 
-            sys->iram[rx_addr]++;
-            sys->cpu.cycles += 12;
+            ram_wr(sys, rx_addr, ram_rd(sys, rx_addr, mode) + 1, mode);
             break;
         }
 
@@ -670,8 +846,7 @@ void cpu_step(system_8051_t *sys) {
             uint8_t reg_index = opcode & 0x07;
             uint8_t rx_addr = get_rx_addr(sys, reg_index);
 
-            sys->iram[rx_addr]--;
-            sys->cpu.cycles += 12;
+            ram_wr(sys, rx_addr, ram_rd(sys, rx_addr, mode) - 1, mode);
             break;
         }
 
@@ -681,10 +856,9 @@ void cpu_step(system_8051_t *sys) {
             uint8_t reg_index = opcode & 0x07;
             uint8_t addr = get_rx_addr(sys, reg_index);
             
-            sys->cpu.A &= sys->iram[addr];
+            sys->cpu.A &= ram_rd(sys, addr, mode);
             
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
@@ -694,10 +868,9 @@ void cpu_step(system_8051_t *sys) {
             uint8_t reg_index = opcode & 0x07;
             uint8_t addr = get_rx_addr(sys, reg_index);
             
-            sys->cpu.A |= sys->iram[addr];
+            sys->cpu.A |= ram_rd(sys, addr, mode);
             
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
@@ -707,142 +880,129 @@ void cpu_step(system_8051_t *sys) {
             uint8_t reg_index = opcode & 0x07;
             uint8_t addr = get_rx_addr(sys, reg_index);
             
-            sys->cpu.A ^= sys->iram[addr];
+            sys->cpu.A ^= ram_rd(sys, addr, mode);
             
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0x75: { //MOV addr, #value
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            uint8_t val = system_read_code(sys, sys->cpu.PC);
+            uint8_t val = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            iram_write(sys, target, val);
-            sys->cpu.cycles += 24;
+            iram_write(sys, target, val, mode);
             break;
         }
 
         //MOV A, @Rx
         case 0xE6: case 0xE7: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t target = get_indirect_addr(sys, reg_index);
+            uint8_t target = get_indirect_addr(sys, reg_index, mode);
 
-            sys->cpu.A = sys->iram[target];
+            sys->cpu.A = ram_rd(sys, target, mode);
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
         //MOV @Rx, A
         case 0xF6: case 0xF7: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t target = get_indirect_addr(sys, reg_index);
+            uint8_t target = get_indirect_addr(sys, reg_index, mode);
 
-            sys->iram[target] = sys->cpu.A;
-            sys->cpu.cycles += 12;
+            ram_wr(sys, target, sys->cpu.A, mode);
             break;
         }
 
         //MOV @Rx, #value
         case 0x76: case 0x77: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t target = get_indirect_addr(sys, reg_index);
-            uint8_t val = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = get_indirect_addr(sys, reg_index, mode);
+            uint8_t val = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            sys->iram[target] = val;
-            sys->cpu.cycles += 12;
+            ram_wr(sys, target, val, mode);
             break;
         }
 
         //ADD A, @Rx
         case 0x26: case 0x27: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t target = get_indirect_addr(sys, reg_index);
-            uint8_t val = sys->iram[target];
+            uint8_t target = get_indirect_addr(sys, reg_index, mode);
+            uint8_t val = ram_rd(sys, target, mode);
 
             alu_add(sys, val);
-            sys->cpu.cycles += 12;
             break;
         }
 
         //SUBB A, @Rx
         case 0x96: case 0x97: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t target = get_indirect_addr(sys, reg_index);
-            uint8_t val = sys->iram[target];
+            uint8_t target = get_indirect_addr(sys, reg_index, mode);
+            uint8_t val = ram_rd(sys, target, mode);
 
             alu_subb(sys, val);
-            sys->cpu.cycles += 12;
             break;
         }
 
         //ANL A, @Rx
         case 0x56: case 0x57: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t target = get_indirect_addr(sys, reg_index);
+            uint8_t target = get_indirect_addr(sys, reg_index, mode);
             
-            sys->cpu.A &= sys->iram[target];
+            sys->cpu.A &= ram_rd(sys, target, mode);
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
         //ORL A, @Rx
         case 0x46: case 0x47: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t target = get_indirect_addr(sys, reg_index);
+            uint8_t target = get_indirect_addr(sys, reg_index, mode);
             
-            sys->cpu.A |= sys->iram[target];
+            sys->cpu.A |= ram_rd(sys, target, mode);
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
         //XRL A, @Rx
         case 0x66: case 0x67: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t target = get_indirect_addr(sys, reg_index);
+            uint8_t target = get_indirect_addr(sys, reg_index, mode);
             
-            sys->cpu.A ^= sys->iram[target];
+            sys->cpu.A ^= ram_rd(sys, target, mode);
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
         //INC @Rx
         case 0x06: case 0x07: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t target = get_indirect_addr(sys, reg_index);
+            uint8_t target = get_indirect_addr(sys, reg_index, mode);
 
-            sys->iram[target]++;
-            sys->cpu.cycles += 12;
+            ram_wr(sys, target, ram_rd(sys, target, mode) + 1, mode);
             break;
         }
 
         //DEC @Rx
         case 0x16: case 0x17: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t target = get_indirect_addr(sys, reg_index);
+            uint8_t target = get_indirect_addr(sys, reg_index, mode);
 
-            sys->iram[target]--;
-            sys->cpu.cycles += 12;
+            ram_wr(sys, target, ram_rd(sys, target, mode) - 1, mode);
             break;
         }
 
         //MOV addr, addr
         case 0x85: {
-            uint8_t src = system_read_code(sys, sys->cpu.PC);
+            uint8_t src = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            uint8_t dest = system_read_code(sys, sys->cpu.PC);
+            uint8_t dest = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            uint8_t val = iram_read(sys, src);
-            iram_write(sys, dest, val);
-            sys->cpu.cycles += 24;
+            uint8_t val = iram_read(sys, src, mode);
+            iram_write(sys, dest, val, mode);
             break;
         }
 
@@ -851,7 +1011,6 @@ void cpu_step(system_8051_t *sys) {
             sys->cpu.A <<= 1;
             sys->cpu.A |= temp;
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
@@ -860,14 +1019,12 @@ void cpu_step(system_8051_t *sys) {
             sys->cpu.A >>= 1;
             sys->cpu.A |= temp;
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0xC4: { //SWAP A
             sys->cpu.A = (sys->cpu.A << 4) + (sys->cpu.A >> 4);
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
@@ -879,7 +1036,6 @@ void cpu_step(system_8051_t *sys) {
             sys->cpu.PSW = (new_cy) ? sys->cpu.PSW | PSW_CY : sys->cpu.PSW & ~PSW_CY;
             
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
@@ -891,247 +1047,218 @@ void cpu_step(system_8051_t *sys) {
             sys->cpu.PSW = (new_cy) ? sys->cpu.PSW | PSW_CY : sys->cpu.PSW & ~PSW_CY;
 
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0xC3: { //CLR C
             sys->cpu.PSW &= ~PSW_CY;
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0xD3: { //SETB C
             sys->cpu.PSW |= PSW_CY;
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0xB3: { //CPL C
             sys->cpu.PSW ^= PSW_CY;
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0xC2: { //CLR bit_addr
-            uint8_t bit_addr = system_read_code(sys, sys->cpu.PC);
+            uint8_t bit_addr = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            bit_write(sys, bit_addr, 0x00);
-            sys->cpu.cycles += 12;
+            bit_write(sys, bit_addr, 0x00, mode);
             break;
         }
 
         case 0xD2: { //SETB bit_addr
-            uint8_t bit_addr = system_read_code(sys, sys->cpu.PC);
+            uint8_t bit_addr = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            bit_write(sys, bit_addr, 0x01);
-            sys->cpu.cycles += 12;
+            bit_write(sys, bit_addr, 0x01, mode);
             break;
         }
 
         case 0xB2: { //CPL bit_addr
-            uint8_t bit_addr = system_read_code(sys, sys->cpu.PC);
+            uint8_t bit_addr = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            uint8_t val = bit_read(sys, bit_addr);
-            bit_write(sys, bit_addr, !val);
-            sys->cpu.cycles += 12;
+            uint8_t val = bit_read(sys, bit_addr, mode);
+            bit_write(sys, bit_addr, !val, mode);
             break;
         }
 
         case 0xA2: { //MOV C, bit_addr
-            uint8_t bit_addr = system_read_code(sys, sys->cpu.PC);
+            uint8_t bit_addr = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            if(bit_read(sys, bit_addr)) sys->cpu.PSW |= PSW_CY;
+            if(bit_read(sys, bit_addr, mode)) sys->cpu.PSW |= PSW_CY;
             else sys->cpu.PSW &= ~PSW_CY;
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0x92: { //MOV bit_addr, C
-            uint8_t bit_addr = system_read_code(sys, sys->cpu.PC);
+            uint8_t bit_addr = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            if(sys->cpu.PSW & PSW_CY) bit_write(sys, bit_addr, 0x01);
-            else bit_write(sys, bit_addr, 0x00);
-            sys->cpu.cycles += 24;
+            if(sys->cpu.PSW & PSW_CY) bit_write(sys, bit_addr, 0x01, mode);
+            else bit_write(sys, bit_addr, 0x00, mode);
             break;
         }
 
         case 0x82: { //ANL C, bit_addr
-            uint8_t bit_addr = system_read_code(sys, sys->cpu.PC);
+            uint8_t bit_addr = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            if(bit_read(sys, bit_addr)) ;
+            if(bit_read(sys, bit_addr, mode)) ;
             else sys->cpu.PSW &= ~PSW_CY;
-            sys->cpu.cycles += 24;
             break;
         }
 
         case 0xB0: { //ANL C, /[bit_addr]
-            uint8_t bit_addr = system_read_code(sys, sys->cpu.PC);
+            uint8_t bit_addr = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            if(!(bit_read(sys, bit_addr))) ;
+            if(!(bit_read(sys, bit_addr, mode))) ;
             else sys->cpu.PSW &= ~PSW_CY;
-            sys->cpu.cycles += 24;
             break;
         }
 
         case 0x72: { //ORL C, bit_addr
-            uint8_t bit_addr = system_read_code(sys, sys->cpu.PC);
+            uint8_t bit_addr = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            if(bit_read(sys, bit_addr)) sys->cpu.PSW |= PSW_CY;
+            if(bit_read(sys, bit_addr, mode)) sys->cpu.PSW |= PSW_CY;
             else ;
-            sys->cpu.cycles += 24;
             break;
         }
 
         case 0xA0: { //ORL C, /[bit_addr]
-            uint8_t bit_addr = system_read_code(sys, sys->cpu.PC);
+            uint8_t bit_addr = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            if(!(bit_read(sys, bit_addr))) sys->cpu.PSW |= PSW_CY;
+            if(!(bit_read(sys, bit_addr, mode))) sys->cpu.PSW |= PSW_CY;
             else ;
-            sys->cpu.cycles += 24;
             break;
         }
 
         case 0x40: { //JC label 
-            int8_t offset = (int8_t)system_read_code(sys, sys->cpu.PC);
+            int8_t offset = (int8_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            if(sys->cpu.PSW & PSW_CY) sys->cpu.PC += offset;
-            sys->cpu.cycles += 24;
+            if(sys->cpu.PSW & PSW_CY) take_branch(sys, offset, mode);
             break;
         }
 
         case 0x50: { //JNC label 
-            int8_t offset = (int8_t)system_read_code(sys, sys->cpu.PC);
+            int8_t offset = (int8_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            if(!(sys->cpu.PSW & PSW_CY)) sys->cpu.PC += offset;
-            sys->cpu.cycles += 24;
+            if(!(sys->cpu.PSW & PSW_CY)) take_branch(sys, offset, mode);
             break;
         }
 
         case 0x20: { //JB bit_addr, label 
-            uint8_t bit_addr = system_read_code(sys, sys->cpu.PC);
+            uint8_t bit_addr = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            int8_t offset = (int8_t)system_read_code(sys, sys->cpu.PC);
+            int8_t offset = (int8_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            if(bit_read(sys, bit_addr)) sys->cpu.PC += offset;
-            sys->cpu.cycles += 24;
+            if(bit_read(sys, bit_addr, mode)) take_branch(sys, offset, mode);
             break;
         }
 
         case 0x30: { //JNB bit_addr, label 
-            uint8_t bit_addr = system_read_code(sys, sys->cpu.PC);
+            uint8_t bit_addr = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            int8_t offset = (int8_t)system_read_code(sys, sys->cpu.PC);
+            int8_t offset = (int8_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            if(!(bit_read(sys, bit_addr))) sys->cpu.PC += offset;
-            sys->cpu.cycles += 24;
+            if(!(bit_read(sys, bit_addr, mode))) take_branch(sys, offset, mode);
             break;
         }
 
         case 0x10: { //JBC bit_addr, label 
-            uint8_t bit_addr = system_read_code(sys, sys->cpu.PC);
+            uint8_t bit_addr = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            int8_t offset = (int8_t)system_read_code(sys, sys->cpu.PC);
+            int8_t offset = (int8_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            if(bit_read(sys, bit_addr)) {
-                sys->cpu.PC += offset;
-                bit_write(sys, bit_addr, 0x00);
+            if(bit_read(sys, bit_addr, mode)) {
+                take_branch(sys, offset, mode);
+                bit_write(sys, bit_addr, 0x00, mode);
             }
-            sys->cpu.cycles += 24;
             break;
         }
 
         case 0x90: { //MOV DPTR, #value16
-            uint16_t high = ((uint16_t)system_read_code(sys, sys->cpu.PC)) << 8;
+            uint16_t high = ((uint16_t)code_rd(sys, sys->cpu.PC, mode)) << 8;
             sys->cpu.PC++;
-            uint16_t low = (uint16_t)system_read_code(sys, sys->cpu.PC);
+            uint16_t low = (uint16_t)code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
             sys->cpu.DPTR = high + low;
-            sys->cpu.cycles += 24;
             break;
         }
 
         case 0xA3: { //INC DPTR
             sys->cpu.DPTR++;
-            sys->cpu.cycles += 24;
             break;
         }
 
         case 0x93: { //MOVC A, @A+DPTR
             uint16_t addr = sys->cpu.DPTR + sys->cpu.A;
-            sys->cpu.A = system_read_code(sys, addr);
-            sys->cpu.cycles += 24;
+            sys->cpu.A = movc_rd(sys, addr, mode);
             break;
         }
 
         case 0x83: { //MOVC A, @A+PC
             uint16_t addr = sys->cpu.PC + sys->cpu.A;
-            sys->cpu.A = system_read_code(sys, addr);
-            sys->cpu.cycles += 24;
+            sys->cpu.A = movc_rd(sys, addr, mode);
             break;
         }
 
         case 0xE0: { //MOVX A, @DPTR
-            sys->cpu.A = system_read_xram(sys, sys->cpu.DPTR);
-            sys->cpu.cycles += 24;
+            sys->cpu.A = xram_rd(sys, sys->cpu.DPTR, mode);
             break;
         }
 
         case 0xF0: { //MOVX @DPTR, A
-            system_write_xram(sys, sys->cpu.DPTR, sys->cpu.A);
-            sys->cpu.cycles += 24;
+            xram_wr(sys, sys->cpu.DPTR, sys->cpu.A, mode);
             break;
         }
 
         //MOVX A, @Rx
         case 0xE2: case 0xE3: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t low = sys->iram[get_rx_addr(sys, reg_index)];
+            uint8_t low = ram_rd(sys, get_rx_addr(sys, reg_index), mode);
             uint16_t high = (uint16_t)sys->sfr.P2; //Paging byte
             uint16_t addr = (high << 8) + low;
             
-            sys->cpu.A = system_read_xram(sys, addr);
-            sys->cpu.cycles += 24;
+            sys->cpu.A = xram_rd(sys, addr, mode);
             break;
         }
 
         // MOVX @Rx, A
         case 0xF2: case 0xF3: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t low = sys->iram[get_rx_addr(sys, reg_index)];
+            uint8_t low = ram_rd(sys, get_rx_addr(sys, reg_index), mode);
             uint16_t high = (uint16_t)sys->sfr.P2; //Paging byte
             uint16_t addr = (high << 8) + low;
             
-            system_write_xram(sys, addr, sys->cpu.A);
-            sys->cpu.cycles += 24;
+            xram_wr(sys, addr, sys->cpu.A, mode);
             break;
         }
 
         case 0x34: { //ADDC A, #value
-            uint8_t val = system_read_code(sys, sys->cpu.PC);
+            uint8_t val = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
             alu_addc(sys, val);
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0x35: { //ADDC A, addr
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            uint8_t val = iram_read(sys, target);
+            uint8_t val = iram_read(sys, target, mode);
             alu_addc(sys, val);
-            sys->cpu.cycles += 12;
             break;
         }
 
         //ADDC A, @Rx
         case 0x36: case 0x37: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t target = get_indirect_addr(sys, reg_index);
-            uint8_t val = sys->iram[target];
+            uint8_t target = get_indirect_addr(sys, reg_index, mode);
+            uint8_t val = ram_rd(sys, target, mode);
             alu_addc(sys, val);
-            sys->cpu.cycles += 12;
             break;
         }
 
@@ -1139,234 +1266,193 @@ void cpu_step(system_8051_t *sys) {
         case 0x38: case 0x39: case 0x3A: case 0x3B:
         case 0x3C: case 0x3D: case 0x3E: case 0x3F: {
             uint8_t reg_index = opcode & 0x07;
-            uint8_t val = sys->iram[get_rx_addr(sys, reg_index)];
+            uint8_t val = ram_rd(sys, get_rx_addr(sys, reg_index), mode);
             alu_addc(sys, val);
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0x73: { //JMP @A+DPTR
             sys->cpu.PC = sys->cpu.DPTR + (uint16_t)sys->cpu.A;
-            sys->cpu.cycles += 24;
             break;
         }
 
         case 0xD4: { //DA A
-            uint16_t result = (uint16_t)sys->cpu.A;
-            if((result & 0x0F) > 0x09 || (sys->cpu.PSW & PSW_AC)) {
-                result += 0x06;
-            }
-            if((result & 0xF0) > 0x90 || (sys->cpu.PSW & PSW_CY)) {
-                result += 0x60;
-                if(result > 0xFF) sys->cpu.PSW |= PSW_CY;
-            }
-
-            sys->cpu.A = (uint8_t)result;
-            update_parity(sys);
-            sys->cpu.cycles += 12;
+            sys->cpu.PSW = alu_da_psw(sys->cpu.A, sys->cpu.PSW, &sys->cpu.A);
             break;
         }
 
         case 0xE4: { //CLR A
             sys->cpu.A &= 0x00;
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0xF4: { //CPL A
             sys->cpu.A = ~(sys->cpu.A);
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0x32: { //RETI
-            uint16_t highaddr = (uint16_t)sys->iram[sys->cpu.SP];
+            uint16_t highaddr = (uint16_t)stack_rd(sys, mode);
             sys->cpu.SP--;
-            uint8_t lowaddr = sys->iram[sys->cpu.SP];
+            uint8_t lowaddr = stack_rd(sys, mode);
             sys->cpu.SP--;
             sys->cpu.PC = (uint16_t)((highaddr << 8) + lowaddr);
 
-            sys->cpu.cycles += 24;
+            interrupt_reti(sys);
             break;
         }
 
         case 0x25: { //ADD A, addr
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            uint8_t val = iram_read(sys, target);
+            uint8_t val = iram_read(sys, target, mode);
             alu_add(sys, val);
-
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0x95: { //SUBB A, addr
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            uint8_t val = iram_read(sys, target);
+            uint8_t val = iram_read(sys, target, mode);
             alu_subb(sys, val);
-
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0x55: { //ANL A, addr
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            uint8_t val = iram_read(sys, target);
+            uint8_t val = iram_read(sys, target, mode);
             sys->cpu.A &= val;
 
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0x45: { //ORL A, addr
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            uint8_t val = iram_read(sys, target);
+            uint8_t val = iram_read(sys, target, mode);
             sys->cpu.A |= val;
 
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0x65: { //XRL A, addr
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            uint8_t val = iram_read(sys, target);
+            uint8_t val = iram_read(sys, target, mode);
             sys->cpu.A ^= val;
 
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0xE5: { //MOV A, addr
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            uint8_t val = iram_read(sys, target);
+            uint8_t val = iram_read(sys, target, mode);
             sys->cpu.A = val;
 
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
         case 0xF5: { //MOV addr, A
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            iram_write(sys, target, sys->cpu.A);
-
-            sys->cpu.cycles += 12;
+            iram_write(sys, target, sys->cpu.A, mode);
             break;
         }
 
         case 0x05: { //INC addr
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            uint8_t val = iram_read(sys, target);
+            uint8_t val = iram_read(sys, target, mode);
             val++;
-            iram_write(sys, target, val);
-
-            sys->cpu.cycles += 12;
+            iram_write(sys, target, val, mode);
             break;
         }
 
         case 0x15: { //DEC addr
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            uint8_t val = iram_read(sys, target);
+            uint8_t val = iram_read(sys, target, mode);
             val--;
-            iram_write(sys, target, val);
-
-            sys->cpu.cycles += 12;
+            iram_write(sys, target, val, mode);
             break;
         }
 
         case 0x52: { //ANL addr, A
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            uint8_t val = iram_read(sys, target);
+            uint8_t val = iram_read(sys, target, mode);
             val &= sys->cpu.A;
-            iram_write(sys, target, val);
-
-            sys->cpu.cycles += 24;
+            iram_write(sys, target, val, mode);
             break;
         }
 
         case 0x42: { //ORL addr, A
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            uint8_t val = iram_read(sys, target);
+            uint8_t val = iram_read(sys, target, mode);
             val |= sys->cpu.A;
-            iram_write(sys, target, val);
-
-            sys->cpu.cycles += 24;
+            iram_write(sys, target, val, mode);
             break;
         }
 
         case 0x62: { //XRL addr, A
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            uint8_t val = iram_read(sys, target);
+            uint8_t val = iram_read(sys, target, mode);
             val ^= sys->cpu.A;
-            iram_write(sys, target, val);
-
-            sys->cpu.cycles += 24;
+            iram_write(sys, target, val, mode);
             break;
         }
 
          case 0x53: { //ANL addr, #value
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            uint8_t value = system_read_code(sys, sys->cpu.PC);
+            uint8_t value = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            uint8_t val = iram_read(sys, target);
+            uint8_t val = iram_read(sys, target, mode);
             val &= value;
-            iram_write(sys, target, val);
-
-            sys->cpu.cycles += 24;
+            iram_write(sys, target, val, mode);
             break;
         }
 
         case 0x43: { //ORL addr, #value
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            uint8_t value = system_read_code(sys, sys->cpu.PC);
+            uint8_t value = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            uint8_t val = iram_read(sys, target);
+            uint8_t val = iram_read(sys, target, mode);
             val |= value;
-            iram_write(sys, target, val);
-
-            sys->cpu.cycles += 24;
+            iram_write(sys, target, val, mode);
             break;
         }
 
         case 0x63: { //XRL addr, #value
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
-            uint8_t value = system_read_code(sys, sys->cpu.PC);
+            uint8_t value = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            uint8_t val = iram_read(sys, target);
+            uint8_t val = iram_read(sys, target, mode);
             val ^= value;
-            iram_write(sys, target, val);
-
-            sys->cpu.cycles += 24;
+            iram_write(sys, target, val, mode);
             break;
         }
 
@@ -1374,14 +1460,12 @@ void cpu_step(system_8051_t *sys) {
         case 0x88: case 0x89: case 0x8A: case 0x8B:
         case 0x8C: case 0x8D: case 0x8E: case 0x8F: {
             uint8_t reg_index = opcode & 0x07;
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
             uint8_t reg_addr = get_rx_addr(sys, reg_index);
-            uint8_t val = sys->iram[reg_addr];
-            iram_write(sys, target, val);
-
-            sys->cpu.cycles += 24;
+            uint8_t val = ram_rd(sys, reg_addr, mode);
+            iram_write(sys, target, val, mode);
             break;
         }
 
@@ -1389,87 +1473,78 @@ void cpu_step(system_8051_t *sys) {
         case 0xA8: case 0xA9: case 0xAA: case 0xAB:
         case 0xAC: case 0xAD: case 0xAE: case 0xAF: {
             uint8_t reg_index = opcode & 0x07;
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
             uint8_t reg_addr = get_rx_addr(sys, reg_index);
-            uint8_t val = iram_read(sys, target);
-            sys->iram[reg_addr] = val;
-
-            sys->cpu.cycles += 24;
+            uint8_t val = iram_read(sys, target, mode);
+            ram_wr(sys, reg_addr, val, mode);
             break;
         }
 
         //MOV addr, @Rx
         case 0x86: case 0x87: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            uint8_t in_addr = get_indirect_addr(sys, reg_index);
-            uint8_t val = sys->iram[in_addr];
-            iram_write(sys, target, val);
-
-            sys->cpu.cycles += 24;
+            uint8_t in_addr = get_indirect_addr(sys, reg_index, mode);
+            uint8_t val = ram_rd(sys, in_addr, mode);
+            iram_write(sys, target, val, mode);
             break;
         }
 
         //MOV @Rx, addr
         case 0xA6: case 0xA7: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
-            uint8_t val = iram_read(sys, target);
-            uint8_t in_addr = get_indirect_addr(sys, reg_index);
-            sys->iram[in_addr] = val;
-
-            sys->cpu.cycles += 24;
+            uint8_t val = iram_read(sys, target, mode);
+            uint8_t in_addr = get_indirect_addr(sys, reg_index, mode);
+            ram_wr(sys, in_addr, val, mode);
             break;
         }
 
         case 0xC5: { //XCH A, addr
-            uint8_t target = system_read_code(sys, sys->cpu.PC);
+            uint8_t target = code_rd(sys, sys->cpu.PC, mode);
             sys->cpu.PC++;
 
             uint8_t temp = sys->cpu.A;
-            uint8_t val = iram_read(sys, target);
+            uint8_t val = iram_read(sys, target, mode);
             sys->cpu.A = val;
-            iram_write(sys, target, temp);
+            iram_write(sys, target, temp, mode);
 
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
         //XCH A, @Rx
         case 0xC6: case 0xC7: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t in_addr = get_indirect_addr(sys, reg_index);
+            uint8_t in_addr = get_indirect_addr(sys, reg_index, mode);
 
             uint8_t temp = sys->cpu.A;
-            sys->cpu.A = sys->iram[in_addr];
-            sys->iram[in_addr] = temp;
+            sys->cpu.A = ram_rd(sys, in_addr, mode);
+            ram_wr(sys, in_addr, temp, mode);
 
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         } 
 
         //XCHD A, @Rx
         case 0xD6: case 0xD7: {
             uint8_t reg_index = opcode & 0x01;
-            uint8_t in_addr = get_indirect_addr(sys, reg_index);
+            uint8_t in_addr = get_indirect_addr(sys, reg_index, mode);
 
             uint8_t lower_A = sys->cpu.A & 0x0F;
-            uint8_t addr_n = sys->iram[in_addr] & 0x0F;
+            uint8_t addr_n = ram_rd(sys, in_addr, mode) & 0x0F;
             sys->cpu.A &= 0xF0;
             sys->cpu.A += addr_n;
-            sys->iram[in_addr] &= 0xF0;
-            sys->iram[in_addr] += lower_A;
+            ram_wr(sys, in_addr, ram_rd(sys, in_addr, mode) & 0xF0, mode);
+            ram_wr(sys, in_addr, ram_rd(sys, in_addr, mode) + lower_A, mode);
 
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
@@ -1480,11 +1555,10 @@ void cpu_step(system_8051_t *sys) {
             uint8_t reg_addr = get_rx_addr(sys, reg_index);
 
             uint8_t temp = sys->cpu.A;
-            sys->cpu.A = sys->iram[reg_addr];
-            sys->iram[reg_addr] = temp;
+            sys->cpu.A = ram_rd(sys, reg_addr, mode);
+            ram_wr(sys, reg_addr, temp, mode);
 
             update_parity(sys);
-            sys->cpu.cycles += 12;
             break;
         }
 
@@ -1493,4 +1567,25 @@ void cpu_step(system_8051_t *sys) {
             break;
             
     }
-}
\ No newline at end of file
+
+    // 4. TIME (taken branches have already added their extra)
+    sys->cpu.cycles += CPU_VAR(mode)->cycles[opcode] * CPU_VAR(mode)->cycle_clocks;
+
+    if (covering && branch_len[opcode]) {
+        uint8_t *outcome = sys->cpu.PC == (uint16_t)(insn_pc + branch_len[opcode]) ? sys->cover->not_taken : sys->cover->taken;
+        outcome[insn_pc] = 1;
+    }
+}
+
+#ifndef CPU_AOT
+// Specialised entry points, one pair per variant; the run loop picks one per batch
+#define CPU_ENTRY_POINTS(id, suffix) \
+    static void cpu_step_##suffix(system_8051_t *sys) { cpu_exec(sys, CPU_MODE_VARIANT(id)); } \
+    static void cpu_step_watch_##suffix(system_8051_t *sys) { cpu_exec(sys, CPU_MODE_VARIANT(id) | CPU_MODE_WATCH); } \
+    static void cpu_step_cover_##suffix(system_8051_t *sys) { cpu_exec(sys, CPU_MODE_VARIANT(id) | CPU_MODE_COVER); }
+
+CPU_ENTRY_POINTS(CPU_8051, 8051)
+CPU_ENTRY_POINTS(CPU_8052, 8052)
+CPU_ENTRY_POINTS(CPU_8052_X2, 8052_x2)
+CPU_ENTRY_POINTS(CPU_1T, 1t)
+#endif
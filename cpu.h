@@ -11,8 +11,10 @@ typedef struct {
     uint8_t SP;         // Stack Pointer
     uint16_t PC;        // Program Counter
     uint16_t DPTR;      // Data Pointer (16-bit)
+    uint16_t DPTR_alt;  // Inactive data pointer (dual DPTR variants)
     
     uint64_t cycles;    // Clock Cycle Counter
+    uint64_t instructions; // Instructions retired (ISR entries not counted)
 } cpu_core_t;
 
 // PSW MASKS
@@ -24,4 +26,36 @@ typedef struct {
 #define PSW_OV   0x04
 #define PSW_P    0x01
 
+// CORE VARIANTS
+// Each variant gets its own specialised copy of the interpreter, so nothing
+// below is looked up at run time inside an instruction.
+typedef struct system_8051 system_8051_t;
+
+typedef enum {
+    CPU_8051,           // 4K ROM, 128 bytes IRAM, 12 clocks per machine cycle
+    CPU_8052,           // 8K ROM, 256 bytes IRAM, Timer 2
+    CPU_8052_X2,        // 8052 in X2 mode (6 clocks per cycle), 64K ROM, dual DPTR
+    CPU_1T,             // Single-cycle core, 64K ROM, Timer 2, dual DPTR
+    CPU_VARIANT_COUNT
+} cpu_variant_id_t;
+
+typedef struct {
+    const char *name;
+    uint32_t rom_size;          // On-chip code memory
+    uint16_t iram_size;         // 128 or 256; @Ri above it reads 0xFF and drops writes
+    uint8_t has_timer2;         // T2CON/RCAP2/TL2/TH2, ET2/PT2 and vector 0x2B
+    uint8_t dual_dptr;          // AUXR1 (0xA2) bit 0 selects DPTR0/DPTR1
+    uint8_t cycle_clocks;       // Oscillator clocks per entry of `cycles`
+    uint8_t timer_clocks;       // Oscillator clocks per timer tick
+    uint8_t taken_extra;        // Extra cycles when a conditional branch is taken
+    const uint8_t *cycles;      // Cycles per opcode
+    void (*step)(system_8051_t *sys);
+    void (*step_watch)(system_8051_t *sys);
+    void (*step_cover)(system_8051_t *sys);     // Also fills sys->cover
+} cpu_variant_t;
+
+// NULL if the name is unknown
+const cpu_variant_t *cpu_variant_find(const char *name);
+const cpu_variant_t *cpu_variant_get(cpu_variant_id_t id);
+
 #endif
\ No newline at end of file
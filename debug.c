@@ -0,0 +1,111 @@
+// Breakpoints and memory watchpoints
+#include "system.h"
+#include "sym.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *space_names[] = { "CODE", "IRAM", "SFR", "XRAM" };
+
+void debug_set_breakpoint(system_8051_t *sys, uint16_t addr) {
+    if (debug_is_breakpoint(&sys->dbg, addr)) return;
+    sys->dbg.bp_bits[addr >> 6] |= 1ULL << (addr & 63);
+    sys->dbg.bp_count++;
+}
+
+void debug_clear_breakpoint(system_8051_t *sys, uint16_t addr) {
+    if (!debug_is_breakpoint(&sys->dbg, addr)) return;
+    sys->dbg.bp_bits[addr >> 6] &= ~(1ULL << (addr & 63));
+    sys->dbg.bp_count--;
+}
+
+// Rebuilds the per-page flags from the watch list
+static void debug_rebuild_pages(debug_state_t *dbg) {
+    memset(dbg->iram_page, 0, sizeof(dbg->iram_page));
+    memset(dbg->sfr_page, 0, sizeof(dbg->sfr_page));
+    memset(dbg->xram_page, 0, sizeof(dbg->xram_page));
+
+    for (uint32_t i = 0; i < dbg->watch_count; i++) {
+        watchpoint_t *w = &dbg->watch[i];
+        uint32_t last = (uint32_t)w->addr + w->len - 1;
+        for (uint32_t a = w->addr; a <= last; a++) {
+            switch (w->space) {
+                case SPACE_IRAM: dbg->iram_page[(a & 0xFF) >> WATCH_IRAM_SHIFT] |= w->type; break;
+                case SPACE_SFR: dbg->sfr_page[(a & 0xFF) >> WATCH_IRAM_SHIFT] |= w->type; break;
+                case SPACE_XRAM: dbg->xram_page[(a & 0xFFFF) >> WATCH_XRAM_SHIFT] |= w->type; break;
+            }
+        }
+    }
+}
+
+int debug_add_watch(system_8051_t *sys, uint8_t space, uint16_t addr, uint16_t len, uint8_t type) {
+    debug_state_t *dbg = &sys->dbg;
+    if (dbg->watch_count >= DEBUG_MAX_WATCH) {
+        printf("Too many watchpoints (max %d)\n", DEBUG_MAX_WATCH);
+        return 1;
+    }
+    if (space != SPACE_IRAM && space != SPACE_SFR && space != SPACE_XRAM) {
+        printf("Watchpoints are only supported on IRAM, SFR and XRAM\n");
+        return 1;
+    }
+    if (len == 0) len = 1;
+
+    dbg->watch[dbg->watch_count++] = (watchpoint_t){ space, type, addr, len };
+    debug_rebuild_pages(dbg);
+    return 0;
+}
+
+int debug_remove_watch(system_8051_t *sys, uint8_t space, uint16_t addr, uint8_t type) {
+    debug_state_t *dbg = &sys->dbg;
+    for (uint32_t i = 0; i < dbg->watch_count; i++) {
+        watchpoint_t *w = &dbg->watch[i];
+        if (w->space == space && w->addr == addr && (type == 0 || w->type == type)) {
+            dbg->watch[i] = dbg->watch[--dbg->watch_count];
+            debug_rebuild_pages(dbg);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void debug_clear_all(system_8051_t *sys) {
+    memset(sys->dbg.bp_bits, 0, sizeof(sys->dbg.bp_bits));
+    sys->dbg.bp_count = 0;
+    sys->dbg.watch_count = 0;
+    sys->dbg.stop = 0;
+    debug_rebuild_pages(&sys->dbg);
+}
+
+// Slow path from cpu.c after a page flag matched
+void debug_watch_check(system_8051_t *sys, uint8_t space, uint16_t addr, uint8_t type, uint8_t value) {
+    debug_state_t *dbg = &sys->dbg;
+    for (uint32_t i = 0; i < dbg->watch_count; i++) {
+        watchpoint_t *w = &dbg->watch[i];
+        if (w->space != space || !(w->type & type)) continue;
+        if (addr < w->addr || addr >= (uint32_t)w->addr + w->len) continue;
+
+        dbg->stop = 1;
+        dbg->hit_space = space;
+        dbg->hit_type = type;
+        dbg->hit_addr = addr;
+        dbg->hit_value = value;
+        dbg->hit_pc = dbg->insn_pc;
+        return;
+    }
+}
+
+void debug_print_hit(system_8051_t *sys) {
+    debug_state_t *dbg = &sys->dbg;
+    printf("Watchpoint hit: %s %s 0x%04X (value 0x%02X) by instruction at 0x%04X",
+           dbg->hit_type == WATCH_WRITE ? "write" : "read",
+           space_names[dbg->hit_space], dbg->hit_addr, dbg->hit_value, dbg->hit_pc);
+
+    // The watched byte and the instruction by name, when symbols are loaded
+    if (sys->syms) {
+        char data[64] = "", code[64];
+        if (dbg->hit_space == SPACE_IRAM) sym_format(sys->syms, SYM_IRAM, dbg->hit_addr, data, sizeof(data));
+        if (dbg->hit_space == SPACE_XRAM) sym_format(sys->syms, SYM_XRAM, dbg->hit_addr, data, sizeof(data));
+        sym_format(sys->syms, SYM_CODE, dbg->hit_pc, code, sizeof(code));
+        printf(" (%s%s%s)", data, data[0] ? " in " : "", code);
+    }
+    printf("\n");
+}
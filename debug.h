@@ -0,0 +1,56 @@
+#ifndef DEBUG_H
+#define DEBUG_H
+
+#include <stdint.h>
+
+// Watchpoint access types
+#define WATCH_READ   0x01
+#define WATCH_WRITE  0x02
+
+// Address spaces
+#define SPACE_CODE   0
+#define SPACE_IRAM   1  // 0x00-0xFF internal RAM (upper half via @Ri)
+#define SPACE_SFR    2  // 0x80-0xFF direct addresses
+#define SPACE_XRAM   3
+
+#define DEBUG_MAX_WATCH 32
+
+// Watch pages: 16 bytes in IRAM/SFR, 256 bytes in XRAM
+#define WATCH_IRAM_SHIFT 4
+#define WATCH_XRAM_SHIFT 8
+
+typedef struct {
+    uint8_t space;
+    uint8_t type;       // WATCH_READ | WATCH_WRITE
+    uint16_t addr;
+    uint16_t len;
+} watchpoint_t;
+
+typedef struct {
+    // Breakpoints: one bit per code address, only tested by the slow run loop
+    uint64_t bp_bits[65536 / 64];
+    uint32_t bp_count;
+
+    // Watchpoints: page flags make the common miss a single load; the
+    // exact list is only searched on a page hit
+    watchpoint_t watch[DEBUG_MAX_WATCH];
+    uint32_t watch_count;
+    uint8_t iram_page[256 >> WATCH_IRAM_SHIFT];
+    uint8_t sfr_page[256 >> WATCH_IRAM_SHIFT];
+    uint8_t xram_page[65536 >> WATCH_XRAM_SHIFT];
+
+    // Last watchpoint hit (stop is set until the run loop picks it up)
+    uint8_t stop;
+    uint8_t hit_space;
+    uint8_t hit_type;
+    uint8_t hit_value;
+    uint16_t hit_addr;
+    uint16_t hit_pc;
+    uint16_t insn_pc;   // Start of the instruction being executed (watch mode only)
+} debug_state_t;
+
+static inline int debug_is_breakpoint(const debug_state_t *dbg, uint16_t pc) {
+    return (dbg->bp_bits[pc >> 6] >> (pc & 63)) & 1;
+}
+
+#endif
@@ -0,0 +1,148 @@
+// libemu8051: the public C API over system_8051_t
+#include <stdlib.h>
+#include <string.h>
+#include "emu8051.h"
+#include "system.h"
+#include "hexfile.h"
+
+struct emu8051 {
+    system_8051_t sys;
+};
+
+_Static_assert((int)EMU8051_LIMIT == RUN_LIMIT && (int)EMU8051_HALT == RUN_HALT &&
+               (int)EMU8051_BREAKPOINT == RUN_BREAKPOINT && (int)EMU8051_WATCHPOINT == RUN_WATCHPOINT,
+               "emu8051_stop_t mirrors run_result_t");
+
+int emu8051_api_version(void) {
+    return EMU8051_API_VERSION;
+}
+
+emu8051_t *emu8051_create(const char *variant) {
+    const cpu_variant_t *v = cpu_variant_find(variant ? variant : "8051");
+    if (v == NULL) return NULL;
+
+    emu8051_t *emu = malloc(sizeof(emu8051_t));
+    if (emu == NULL) return NULL;
+    system_reset(&emu->sys);
+    system_set_variant(&emu->sys, v);
+    return emu;
+}
+
+void emu8051_destroy(emu8051_t *emu) {
+    free(emu);
+}
+
+int emu8051_reset(emu8051_t *emu) {
+    system_8051_t *sys = &emu->sys;
+    const cpu_variant_t *variant = sys->variant;
+    uint8_t *code = malloc(sizeof(sys->irom) + sizeof(sys->xrom));
+    if (code == NULL) return 1;
+
+    memcpy(code, sys->irom, sizeof(sys->irom));
+    memcpy(code + sizeof(sys->irom), sys->xrom, sizeof(sys->xrom));
+    system_reset(sys);
+    memcpy(sys->irom, code, sizeof(sys->irom));
+    memcpy(sys->xrom, code + sizeof(sys->irom), sizeof(sys->xrom));
+    system_set_variant(sys, variant);
+    free(code);
+    return 0;
+}
+
+int emu8051_load_hex(emu8051_t *emu, const char *path) {
+    return load_hex(&emu->sys, path);
+}
+
+int emu8051_load(emu8051_t *emu, uint16_t address, const uint8_t *data, size_t size) {
+    if (size > 65536 - (size_t)address) return 1;
+    for (size_t i = 0; i < size; i++) system_write_code(&emu->sys, address + i, data[i]);
+    return 0;
+}
+
+emu8051_stop_t emu8051_run(emu8051_t *emu, uint64_t max_instructions, uint64_t max_cycles) {
+    system_8051_t *sys = &emu->sys;
+    uint64_t cycle_limit = max_cycles ? sys->cpu.cycles + max_cycles : RUN_NO_LIMIT;
+    return (emu8051_stop_t)system_run(sys, max_instructions ? max_instructions : RUN_NO_LIMIT, cycle_limit);
+}
+
+uint64_t emu8051_step(emu8051_t *emu) {
+    return system_step(&emu->sys);
+}
+
+uint8_t emu8051_read(emu8051_t *emu, emu8051_space_t space, uint16_t address) {
+    system_8051_t *sys = &emu->sys;
+    switch (space) {
+        case EMU8051_CODE: return system_read_code(sys, address);
+        case EMU8051_IRAM: return address < sys->variant->iram_size ? sys->iram[address] : 0xFF;
+        case EMU8051_SFR: return address >= 0x80 && address <= 0xFF ? sfr_read(sys, address) : 0xFF;
+        case EMU8051_XRAM: return system_read_xram(sys, address);
+        default: return 0xFF;
+    }
+}
+
+int emu8051_write(emu8051_t *emu, emu8051_space_t space, uint16_t address, uint8_t value) {
+    system_8051_t *sys = &emu->sys;
+    switch (space) {
+        case EMU8051_CODE:
+            system_write_code(sys, address, value);
+            return 0;
+        case EMU8051_IRAM:
+            if (address >= sys->variant->iram_size) return 1;
+            SANITIZE(sanitize_set_bit(sys->san.iram_written, address));
+            sys->iram[address] = value;
+            return 0;
+        case EMU8051_SFR:
+            if (address < 0x80 || address > 0xFF) return 1;
+            sfr_write(sys, address, value);
+            return 0;
+        case EMU8051_XRAM:
+            SANITIZE(sanitize_set_bit(sys->san.xram_written, address));
+            system_write_xram(sys, address, value);
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+void emu8051_set_pc(emu8051_t *emu, uint16_t pc) {
+    emu->sys.cpu.PC = pc;
+}
+
+void emu8051_set_breakpoint(emu8051_t *emu, uint16_t pc) {
+    debug_set_breakpoint(&emu->sys, pc);
+}
+
+void emu8051_clear_breakpoint(emu8051_t *emu, uint16_t pc) {
+    debug_clear_breakpoint(&emu->sys, pc);
+}
+
+void emu8051_snapshot(emu8051_t *emu, emu8051_snapshot_t *out) {
+    system_8051_t *sys = &emu->sys;
+    uint8_t bank = sys->cpu.PSW & (PSW_RS1 | PSW_RS0);
+
+    memset(out, 0, sizeof(*out));
+    out->version = EMU8051_API_VERSION;
+    out->cycles = sys->cpu.cycles;
+    out->instructions = sys->cpu.instructions;
+    out->pc = sys->cpu.PC;
+    out->dptr = sys->cpu.DPTR;
+    out->a = sys->cpu.A;
+    out->b = sys->cpu.B;
+    out->psw = sys->cpu.PSW;
+    out->sp = sys->cpu.SP;
+    for (int i = 0; i < 8; i++) out->r[i] = sys->iram[bank + i];
+    out->tcon = sys->sfr.TCON;
+    out->tmod = sys->sfr.TMOD;
+    out->tl0 = sys->sfr.TL0;
+    out->th0 = sys->sfr.TH0;
+    out->tl1 = sys->sfr.TL1;
+    out->th1 = sys->sfr.TH1;
+    out->scon = sys->sfr.SCON;
+    out->sbuf = sys->sfr.SBUF;
+    out->ie = sys->sfr.IE;
+    out->ip = sys->sfr.IP;
+    out->pcon = sys->sfr.PCON;
+    out->p0 = sys->sfr.P0;
+    out->p1 = sys->sfr.P1;
+    out->p2 = sys->sfr.P2;
+    out->p3 = sys->sfr.P3;
+}
@@ -0,0 +1,83 @@
+#ifndef EMU8051_H
+#define EMU8051_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// libemu8051: the emulator as a library, for test harnesses and tools that
+// drive many systems in-process. Only this header is public; the system
+// behind a handle is opaque, so the internal structures can change without
+// breaking callers. Each handle is independent, and different handles can be
+// run from different threads.
+//
+// Build with `make lib` (libemu8051.a and libemu8051.so) and link with
+// -lemu8051 -pthread -lrt -ldl.
+
+// Bumped when a function or structure below changes incompatibly
+#define EMU8051_API_VERSION 1
+
+typedef struct emu8051 emu8051_t;
+
+typedef enum {
+    EMU8051_CODE,       // Program memory as the core sees it (on-chip ROM, then external)
+    EMU8051_IRAM,       // 256 bytes of internal RAM (0x80-0xFF = indirect RAM)
+    EMU8051_SFR,        // Direct addresses 0x80-0xFF, with their side effects
+    EMU8051_XRAM        // MOVX space, through the XDATA page map
+} emu8051_space_t;
+
+// Why emu8051_run() returned
+typedef enum {
+    EMU8051_LIMIT,      // Instruction or cycle limit reached
+    EMU8051_HALT,       // SJMP $
+    EMU8051_BREAKPOINT,
+    EMU8051_WATCHPOINT
+} emu8051_stop_t;
+
+typedef struct {
+    uint32_t version;           // EMU8051_API_VERSION of the library that filled it
+    uint64_t cycles;            // Oscillator clocks
+    uint64_t instructions;
+    uint16_t pc, dptr;
+    uint8_t a, b, psw, sp;
+    uint8_t r[8];               // Active register bank
+    uint8_t tcon, tmod, tl0, th0, tl1, th1;
+    uint8_t scon, sbuf, ie, ip, pcon;
+    uint8_t p0, p1, p2, p3;
+} emu8051_snapshot_t;
+
+// EMU8051_API_VERSION the library was built with
+int emu8051_api_version(void);
+
+// A powered-on system with the named core ("8051", "8052", "8052x2", "1t";
+// NULL = 8051). NULL for an unknown name or out of memory.
+emu8051_t *emu8051_create(const char *variant);
+void emu8051_destroy(emu8051_t *emu);
+
+// Power-on reset. Code memory and the core variant are kept; breakpoints and
+// XDATA device mappings are not. 1 when out of memory (nothing is changed).
+int emu8051_reset(emu8051_t *emu);
+
+// Intel HEX file, or raw bytes at `address` in code memory. 1 on error.
+int emu8051_load_hex(emu8051_t *emu, const char *path);
+int emu8051_load(emu8051_t *emu, uint16_t address, const uint8_t *data, size_t size);
+
+// Runs until `max_instructions` more instructions or `max_cycles` more clocks
+// (0 = no limit), or a stop condition. With no limits it runs to SJMP $.
+emu8051_stop_t emu8051_run(emu8051_t *emu, uint64_t max_instructions, uint64_t max_cycles);
+
+// One instruction; returns its clocks
+uint64_t emu8051_step(emu8051_t *emu);
+
+// 0xFF for an address outside the space (IRAM above the core's RAM size,
+// SFR below 0x80)
+uint8_t emu8051_read(emu8051_t *emu, emu8051_space_t space, uint16_t address);
+// 1 for an address outside the space
+int emu8051_write(emu8051_t *emu, emu8051_space_t space, uint16_t address, uint8_t value);
+
+void emu8051_set_pc(emu8051_t *emu, uint16_t pc);
+void emu8051_set_breakpoint(emu8051_t *emu, uint16_t pc);
+void emu8051_clear_breakpoint(emu8051_t *emu, uint16_t pc);
+
+void emu8051_snapshot(emu8051_t *emu, emu8051_snapshot_t *out);
+
+#endif
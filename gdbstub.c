@@ -0,0 +1,538 @@
+// GDB remote serial protocol stub. Continue runs the normal batched run loop
+// and only looks at the socket between batches.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "gdbstub.h"
+
+#define GDB_PACKET_MAX 4096
+
+typedef struct {
+    int fd;
+    int no_ack;
+    uint8_t buf[GDB_PACKET_MAX];
+    size_t len;
+    size_t pos;
+} gdb_conn_t;
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// SFRs implemented by sfr_read(); anything else reads as 0 without a warning
+static int sfr_implemented(system_8051_t *sys, uint8_t addr) {
+    if (sys->variant->has_timer2 && addr >= 0xC8 && addr <= 0xCD) return 1;
+    if (sys->variant->dual_dptr && addr == 0xA2) return 1;
+
+    switch (addr) {
+        case 0x80: case 0x81: case 0x82: case 0x83: case 0x87: case 0x88: case 0x89:
+        case 0x8A: case 0x8B: case 0x8C: case 0x8D: case 0x90: case 0x98: case 0x99:
+        case 0xA0: case 0xA8: case 0xB0: case 0xB8: case 0xD0: case 0xE0: case 0xF0:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// CONNECTION
+static int conn_fill(gdb_conn_t *c) {
+    ssize_t n = read(c->fd, c->buf, sizeof(c->buf));
+    if (n <= 0) return 1;
+    c->len = n;
+    c->pos = 0;
+    return 0;
+}
+
+static int conn_getc(gdb_conn_t *c) {
+    if (c->pos == c->len && conn_fill(c)) return -1;
+    return c->buf[c->pos++];
+}
+
+static int conn_write(gdb_conn_t *c, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(c->fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 1;
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int send_packet(gdb_conn_t *c, const char *payload) {
+    char out[GDB_PACKET_MAX * 2 + 8];
+    size_t len = strlen(payload);
+    uint8_t sum = 0;
+
+    out[0] = '$';
+    for (size_t i = 0; i < len; i++) {
+        out[1 + i] = payload[i];
+        sum += (uint8_t)payload[i];
+    }
+    out[1 + len] = '#';
+    out[2 + len] = hex_digits[sum >> 4];
+    out[3 + len] = hex_digits[sum & 0x0F];
+    return conn_write(c, out, len + 4);
+}
+
+// Reads one packet into `out`. Returns its length, -1 on disconnect, or
+// -2 for an out-of-band interrupt (Ctrl-C).
+static int read_packet(gdb_conn_t *c, char *out, size_t max) {
+    int ch;
+    do {
+        ch = conn_getc(c);
+        if (ch < 0) return -1;
+        if (ch == 0x03) return -2;
+    } while (ch != '$');
+
+    size_t len = 0;
+    uint8_t sum = 0;
+    while ((ch = conn_getc(c)) >= 0 && ch != '#') {
+        if (len < max - 1) out[len++] = (char)ch;
+        sum += (uint8_t)ch;
+    }
+    if (ch < 0) return -1;
+    out[len] = '\0';
+
+    int hi = conn_getc(c);
+    int lo = conn_getc(c);
+    if (hi < 0 || lo < 0) return -1;
+
+    if (!c->no_ack) {
+        int ok = (hex_value(hi) << 4 | hex_value(lo)) == sum;
+        if (conn_write(c, ok ? "+" : "-", 1)) return -1;
+        if (!ok) return read_packet(c, out, max);
+    }
+    return (int)len;
+}
+
+// Checks for Ctrl-C between batches without blocking
+static int interrupt_requested(gdb_conn_t *c) {
+    while (1) {
+        if (c->pos == c->len) {
+            struct pollfd p = { c->fd, POLLIN, 0 };
+            if (poll(&p, 1, 0) <= 0) return 0;
+            if (conn_fill(c)) return 1; // Disconnected: stop too
+        }
+        if (c->buf[c->pos++] == 0x03) return 1;
+    }
+}
+
+// TARGET ACCESS
+static int mem_read(system_8051_t *sys, uint32_t addr, uint8_t *value) {
+    uint32_t off = addr & 0xFFFF;
+    switch (addr & 0xFF0000) {
+        case GDB_SPACE_CODE: *value = system_read_code(sys, off); return 0;
+        case GDB_SPACE_XRAM: *value = sys->xram[off]; return 0;
+        case GDB_SPACE_IRAM:
+            if (off > 0xFF) return 1;
+            *value = sys->iram[off];
+            return 0;
+        case GDB_SPACE_SFR:
+            if (off < 0x80 || off > 0xFF) return 1;
+            *value = sfr_implemented(sys, off) ? sfr_read(sys, off) : 0;
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+static int mem_write(system_8051_t *sys, uint32_t addr, uint8_t value) {
+    uint32_t off = addr & 0xFFFF;
+    switch (addr & 0xFF0000) {
+        case GDB_SPACE_CODE: system_write_code(sys, off, value); return 0;
+        case GDB_SPACE_XRAM:
+            SANITIZE(sanitize_set_bit(sys->san.xram_written, off));
+            sys->xram[off] = value;
+            return 0;
+        case GDB_SPACE_IRAM:
+            if (off > 0xFF) return 1;
+            SANITIZE(sanitize_set_bit(sys->san.iram_written, off));
+            sys->iram[off] = value;
+            return 0;
+        case GDB_SPACE_SFR:
+            if (off < 0x80 || off > 0xFF || !sfr_implemented(sys, off)) return 1;
+            sfr_write(sys, off, value);
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+// Maps a flat gdb address to a watchpoint space
+static int watch_space(uint32_t addr, uint8_t *space, uint16_t *off) {
+    *off = addr & 0xFFFF;
+    switch (addr & 0xFF0000) {
+        case GDB_SPACE_XRAM: *space = SPACE_XRAM; return 0;
+        case GDB_SPACE_IRAM: *space = SPACE_IRAM; return *off > 0xFF;
+        case GDB_SPACE_SFR: *space = SPACE_SFR; return *off < 0x80 || *off > 0xFF;
+        default: return 1;
+    }
+}
+
+static uint32_t space_base(uint8_t space) {
+    switch (space) {
+        case SPACE_XRAM: return GDB_SPACE_XRAM;
+        case SPACE_IRAM: return GDB_SPACE_IRAM;
+        case SPACE_SFR: return GDB_SPACE_SFR;
+        default: return GDB_SPACE_CODE;
+    }
+}
+
+static void reg_read(system_8051_t *sys, int n, uint8_t *out, int *len) {
+    uint8_t bank = sys->cpu.PSW & (PSW_RS1 | PSW_RS0);
+    *len = 1;
+    if (n < 8) out[0] = sys->iram[bank + n];
+    else switch (n) {
+        case 8: out[0] = sys->cpu.A; break;
+        case 9: out[0] = sys->cpu.B; break;
+        case 10: out[0] = sys->cpu.PSW; break;
+        case 11: out[0] = sys->cpu.SP; break;
+        case 12: out[0] = (uint8_t)sys->cpu.DPTR; break;
+        case 13: out[0] = (uint8_t)(sys->cpu.DPTR >> 8); break;
+        default:
+            out[0] = (uint8_t)sys->cpu.PC;
+            out[1] = (uint8_t)(sys->cpu.PC >> 8);
+            *len = 2;
+            break;
+    }
+}
+
+static void reg_write(system_8051_t *sys, int n, const uint8_t *in) {
+    uint8_t bank = sys->cpu.PSW & (PSW_RS1 | PSW_RS0);
+    if (n < 8) sys->iram[bank + n] = in[0];
+    else switch (n) {
+        case 8: sfr_write(sys, 0xE0, in[0]); break;
+        case 9: sys->cpu.B = in[0]; break;
+        case 10: sfr_write(sys, 0xD0, in[0]); break;
+        case 11: sys->cpu.SP = in[0]; break;
+        case 12: sys->cpu.DPTR = (sys->cpu.DPTR & 0xFF00) | in[0]; break;
+        case 13: sys->cpu.DPTR = (sys->cpu.DPTR & 0x00FF) | ((uint16_t)in[0] << 8); break;
+        default: sys->cpu.PC = (uint16_t)(in[0] | (in[1] << 8)); break;
+    }
+}
+
+static size_t hex_encode(char *out, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        out[2 * i] = hex_digits[data[i] >> 4];
+        out[2 * i + 1] = hex_digits[data[i] & 0x0F];
+    }
+    out[2 * len] = '\0';
+    return 2 * len;
+}
+
+static int hex_decode(uint8_t *out, const char *in, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        int hi = hex_value(in[2 * i]);
+        int lo = hex_value(in[2 * i + 1]);
+        if (hi < 0 || lo < 0) return 1;
+        out[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return 0;
+}
+
+// STOP REPLIES
+static void stop_reply(system_8051_t *sys, run_result_t result, char *out) {
+    if (result != RUN_WATCHPOINT) {
+        strcpy(out, "S05");
+        return;
+    }
+
+    debug_state_t *dbg = &sys->dbg;
+    const char *kind = dbg->hit_type == WATCH_WRITE ? "watch" : "rwatch";
+    for (uint32_t i = 0; i < dbg->watch_count; i++) {
+        watchpoint_t *w = &dbg->watch[i];
+        if (w->space == dbg->hit_space && dbg->hit_addr >= w->addr && dbg->hit_addr < w->addr + w->len &&
+            w->type == (WATCH_READ | WATCH_WRITE)) {
+            kind = "awatch";
+        }
+    }
+    sprintf(out, "T05%s:%x;", kind, space_base(dbg->hit_space) + dbg->hit_addr);
+}
+
+static run_result_t gdb_continue(system_8051_t *sys, gdb_conn_t *c, int *interrupted) {
+    *interrupted = 0;
+    while (1) {
+        run_result_t result = system_run(sys, GDB_BATCH_INSNS, RUN_NO_LIMIT);
+        if (result != RUN_LIMIT) return result;
+
+        // Batch boundary: the only place the socket is looked at
+        if (interrupt_requested(c)) {
+            *interrupted = 1;
+            return RUN_LIMIT;
+        }
+    }
+}
+
+static run_result_t gdb_single_step(system_8051_t *sys) {
+    sys->dbg.stop = 0;
+    system_step(sys);
+    return sys->dbg.stop ? RUN_WATCHPOINT : RUN_BREAKPOINT;
+}
+
+// PACKET HANDLING. Returns 1 when the session is over.
+static int handle_packet(system_8051_t *sys, gdb_conn_t *c, char *pkt) {
+    char reply[GDB_PACKET_MAX * 2 + 1];
+    reply[0] = '\0';
+
+    switch (pkt[0]) {
+        case '?':
+            strcpy(reply, "S05");
+            break;
+
+        case 'g': {
+            uint8_t regs[GDB_REG_COUNT + 1];
+            int total = 0;
+            for (int n = 0; n < GDB_REG_COUNT; n++) {
+                int len;
+                reg_read(sys, n, regs + total, &len);
+                total += len;
+            }
+            hex_encode(reply, regs, total);
+            break;
+        }
+
+        case 'G': {
+            uint8_t regs[GDB_REG_COUNT + 1];
+            if (strlen(pkt + 1) != 2 * sizeof(regs) || hex_decode(regs, pkt + 1, sizeof(regs))) {
+                strcpy(reply, "E01");
+                break;
+            }
+            // Registers 10 (PSW) first so R0-R7 land in the new bank
+            reg_write(sys, 10, regs + 10);
+            for (int n = 0; n < GDB_REG_COUNT; n++) reg_write(sys, n, regs + n);
+            strcpy(reply, "OK");
+            break;
+        }
+
+        case 'p': {
+            int n = (int)strtol(pkt + 1, NULL, 16);
+            uint8_t val[2];
+            int len;
+            if (n < 0 || n >= GDB_REG_COUNT) {
+                strcpy(reply, "E01");
+                break;
+            }
+            reg_read(sys, n, val, &len);
+            hex_encode(reply, val, len);
+            break;
+        }
+
+        case 'P': {
+            char *eq = strchr(pkt, '=');
+            int n = (int)strtol(pkt + 1, NULL, 16);
+            uint8_t val[2] = {0, 0};
+            size_t len = eq ? strlen(eq + 1) / 2 : 0;
+            if (eq == NULL || n < 0 || n >= GDB_REG_COUNT || len == 0 || len > 2 || hex_decode(val, eq + 1, len)) {
+                strcpy(reply, "E01");
+                break;
+            }
+            reg_write(sys, n, val);
+            strcpy(reply, "OK");
+            break;
+        }
+
+        case 'm': {
+            char *comma;
+            uint32_t addr = strtoul(pkt + 1, &comma, 16);
+            size_t len = (*comma == ',') ? strtoul(comma + 1, NULL, 16) : 0;
+            uint8_t data[GDB_PACKET_MAX / 2];
+            if (len > sizeof(data)) len = sizeof(data);
+            size_t i;
+            for (i = 0; i < len; i++) {
+                if (mem_read(sys, addr + i, &data[i])) break;
+            }
+            if (i == 0 && len > 0) strcpy(reply, "E01");
+            else hex_encode(reply, data, i);
+            break;
+        }
+
+        case 'M': {
+            char *comma, *colon;
+            uint32_t addr = strtoul(pkt + 1, &comma, 16);
+            size_t len = strtoul(comma + 1, &colon, 16);
+            uint8_t data[GDB_PACKET_MAX / 2];
+            if (*comma != ',' || *colon != ':' || len > sizeof(data) ||
+                strlen(colon + 1) < 2 * len || hex_decode(data, colon + 1, len)) {
+                strcpy(reply, "E01");
+                break;
+            }
+            strcpy(reply, "OK");
+            for (size_t i = 0; i < len; i++) {
+                if (mem_write(sys, addr + i, data[i])) {
+                    strcpy(reply, "E02");
+                    break;
+                }
+            }
+            break;
+        }
+
+        case 'c':
+        case 's': {
+            if (pkt[1]) sys->cpu.PC = (uint16_t)strtoul(pkt + 1, NULL, 16);
+            int interrupted = 0;
+            run_result_t result = pkt[0] == 'c' ? gdb_continue(sys, c, &interrupted) : gdb_single_step(sys);
+            if (interrupted) strcpy(reply, "S02");
+            else stop_reply(sys, result, reply);
+            break;
+        }
+
+        case 'Z':
+        case 'z': {
+            int type = pkt[1] - '0';
+            char *comma;
+            uint32_t addr = strtoul(pkt + 3, &comma, 16);
+            uint16_t len = (uint16_t)strtoul(comma + 1, NULL, 16);
+            int insert = pkt[0] == 'Z';
+
+            if (type == 0 || type == 1) {
+                if (addr > 0xFFFF) {
+                    strcpy(reply, "E01");
+                    break;
+                }
+                if (insert) debug_set_breakpoint(sys, addr);
+                else debug_clear_breakpoint(sys, addr);
+                strcpy(reply, "OK");
+            }
+            else if (type >= 2 && type <= 4) {
+                static const uint8_t kinds[] = { WATCH_WRITE, WATCH_READ, WATCH_READ | WATCH_WRITE };
+                uint8_t space;
+                uint16_t off;
+                if (watch_space(addr, &space, &off)) {
+                    strcpy(reply, "E01");
+                    break;
+                }
+                int err = insert ? debug_add_watch(sys, space, off, len, kinds[type - 2])
+                                 : debug_remove_watch(sys, space, off, kinds[type - 2]);
+                strcpy(reply, err ? "E02" : "OK");
+            }
+            break; // Unsupported types get the empty reply
+        }
+
+        case 'q':
+            if (strncmp(pkt, "qSupported", 10) == 0) sprintf(reply, "PacketSize=%x;QStartNoAckMode+", GDB_PACKET_MAX);
+            else if (strcmp(pkt, "qAttached") == 0) strcpy(reply, "1");
+            else if (strcmp(pkt, "qC") == 0) strcpy(reply, "QC1");
+            else if (strcmp(pkt, "qfThreadInfo") == 0) strcpy(reply, "m1");
+            else if (strcmp(pkt, "qsThreadInfo") == 0) strcpy(reply, "l");
+            break;
+
+        case 'Q':
+            if (strcmp(pkt, "QStartNoAckMode") == 0) {
+                send_packet(c, "OK");
+                c->no_ack = 1;
+                return 0;
+            }
+            break;
+
+        case 'H':
+        case 'T':
+            strcpy(reply, "OK");
+            break;
+
+        case 'D':
+            send_packet(c, "OK");
+            return 1;
+
+        case 'k':
+            return 1;
+
+        default:
+            break; // Empty reply = not supported
+    }
+
+    return send_packet(c, reply) != 0;
+}
+
+// LISTENER
+static int open_listener(const char *endpoint) {
+    int fd;
+
+    if (strncmp(endpoint, "unix:", 5) == 0) {
+        struct sockaddr_un sun = {0};
+        sun.sun_family = AF_UNIX;
+        snprintf(sun.sun_path, sizeof(sun.sun_path), "%s", endpoint + 5);
+        unlink(sun.sun_path);
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || bind(fd, (struct sockaddr *)&sun, sizeof(sun)) != 0 || listen(fd, 1) != 0) {
+            printf("Could not listen on %s: %s\n", endpoint, strerror(errno));
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // [host:]port, loopback by default
+    char host[256] = "127.0.0.1";
+    const char *port = endpoint;
+    const char *colon = strrchr(endpoint, ':');
+    if (colon) {
+        snprintf(host, sizeof(host), "%.*s", (int)(colon - endpoint), endpoint);
+        port = colon + 1;
+    }
+
+    struct addrinfo hints = {0}, *res;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &res) != 0) {
+        printf("Invalid gdb endpoint %s\n", endpoint);
+        return -1;
+    }
+
+    fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    int one = 1;
+    if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (fd < 0 || bind(fd, res->ai_addr, res->ai_addrlen) != 0 || listen(fd, 1) != 0) {
+        printf("Could not listen on %s: %s\n", endpoint, strerror(errno));
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+int gdbstub_serve(system_8051_t *sys, const char *endpoint) {
+    int listen_fd = open_listener(endpoint);
+    if (listen_fd < 0) return 1;
+
+    printf("Waiting for gdb on %s\n", endpoint);
+    fflush(stdout);
+
+    gdb_conn_t conn = {0};
+    conn.fd = accept(listen_fd, NULL, NULL);
+    close(listen_fd);
+    if (conn.fd < 0) {
+        printf("accept failed: %s\n", strerror(errno));
+        return 1;
+    }
+    printf("gdb connected\n");
+
+    char pkt[GDB_PACKET_MAX];
+    while (1) {
+        int len = read_packet(&conn, pkt, sizeof(pkt));
+        if (len == -1) break;
+        if (len == -2) {
+            send_packet(&conn, "S02"); // Ctrl-C while already stopped
+            continue;
+        }
+        if (handle_packet(sys, &conn, pkt)) break;
+    }
+
+    close(conn.fd);
+    if (strncmp(endpoint, "unix:", 5) == 0) unlink(endpoint + 5);
+    printf("gdb session ended\n");
+    return 0;
+}
@@ -0,0 +1,27 @@
+#ifndef GDBSTUB_H
+#define GDBSTUB_H
+
+#include "system.h"
+
+// GDB remote serial protocol stub.
+//
+// Registers ('g' order, one byte each unless noted):
+//   0-7 R0-R7 (current bank), 8 A, 9 B, 10 PSW, 11 SP, 12 DPL, 13 DPH,
+//   14 PC (2 bytes, little endian)
+//
+// Memory is one flat address space split by the upper bits:
+#define GDB_SPACE_CODE 0x00000  // 0x00000-0x0FFFF code (internal/external as fetched)
+#define GDB_SPACE_XRAM 0x10000  // 0x10000-0x1FFFF external RAM
+#define GDB_SPACE_IRAM 0x20000  // 0x20000-0x200FF internal RAM, indirect view (upper 128 bytes are RAM)
+#define GDB_SPACE_SFR  0x30000  // 0x30080-0x300FF SFRs, direct view
+
+#define GDB_REG_COUNT 15
+
+// Instructions run between socket checks while continuing
+#define GDB_BATCH_INSNS (1 << 20)
+
+// endpoint: "PORT", "HOST:PORT" or "unix:/path". Serves one debugger
+// session and returns when it detaches (0) or on error (1).
+int gdbstub_serve(system_8051_t *sys, const char *endpoint);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef HEXFILE_H
+#define HEXFILE_H
+
+#include "system.h"
+
+// Loads an Intel HEX file: addresses below the variant's ROM size go to the
+// on-chip ROM, the rest to external code memory. 1 on error (printed).
+int load_hex(system_8051_t *sys, const char *filename);
+
+#endif
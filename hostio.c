@@ -0,0 +1,215 @@
+// Buffered, non-blocking host I/O thread for the serial port
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+#include <unistd.h>
+#include "hostio.h"
+
+struct hostio {
+    int tx_fd;
+    int rx_fd;
+    int own_tx;             // Close on shutdown (not stdin/stdout)
+    int own_rx;
+    int rx_eof;
+
+    spsc_t txq;             // CPU -> host
+    spsc_t rxq;             // host -> CPU
+
+    pthread_t thread;
+    atomic_int stop;
+    char pty_name[128];
+};
+
+static void set_nonblock(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags >= 0) fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+static void *hostio_thread(void *arg) {
+    hostio_t *io = (hostio_t *)arg;
+    uint8_t tx_buf[4096];
+    uint8_t rx_buf[4096];
+    size_t tx_len = 0;
+    size_t tx_off = 0;
+
+    while (1) {
+        int progress = 0;
+        int stopping = atomic_load(&io->stop);
+
+        // CPU -> host: batch everything queued into one write()
+        if (tx_off == tx_len) {
+            tx_len = spsc_pop_bytes(&io->txq, tx_buf, sizeof(tx_buf));
+            tx_off = 0;
+        }
+        if (tx_off < tx_len) {
+            if (io->tx_fd < 0) {
+                tx_off = tx_len; // Unbound: discard
+            }
+            else {
+                ssize_t n = write(io->tx_fd, tx_buf + tx_off, tx_len - tx_off);
+                if (n > 0) {
+                    tx_off += n;
+                    progress = 1;
+                }
+                else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                    printf("UART TX write failed: %s\n", strerror(errno));
+                    io->tx_fd = -1;
+                }
+            }
+        }
+
+        // host -> CPU: only read what the queue can take
+        if (io->rx_fd >= 0 && !io->rx_eof && !stopping) {
+            size_t space = (io->rxq.mask + 1) - spsc_count(&io->rxq);
+            if (space > sizeof(rx_buf)) space = sizeof(rx_buf);
+            if (space > 0) {
+                ssize_t n = read(io->rx_fd, rx_buf, space);
+                if (n > 0) {
+                    spsc_push_bytes(&io->rxq, rx_buf, n);
+                    progress = 1;
+                }
+                else if (n == 0) {
+                    io->rx_eof = 1;
+                }
+                else if (errno != EAGAIN && errno != EINTR && errno != EIO) {
+                    io->rx_eof = 1;
+                }
+            }
+        }
+
+        if (stopping && tx_off == tx_len && spsc_count(&io->txq) == 0) break;
+        if (progress) continue;
+
+        // Idle: wait for the fds, or at most HOSTIO_POLL_MS for the CPU to queue more
+        struct pollfd fds[2];
+        int nfds = 0;
+        if (tx_off < tx_len && io->tx_fd >= 0) {
+            fds[nfds].fd = io->tx_fd;
+            fds[nfds].events = POLLOUT;
+            nfds++;
+        }
+        if (io->rx_fd >= 0 && !io->rx_eof) {
+            fds[nfds].fd = io->rx_fd;
+            fds[nfds].events = POLLIN;
+            nfds++;
+        }
+        poll(fds, nfds, HOSTIO_POLL_MS);
+    }
+
+    return NULL;
+}
+
+static int open_pty(hostio_t *io) {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+        printf("Could not create pty: %s\n", strerror(errno));
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    snprintf(io->pty_name, sizeof(io->pty_name), "%s", ptsname(fd));
+    set_nonblock(fd);
+    io->tx_fd = fd;
+    io->rx_fd = fd;
+    io->own_tx = 1;
+    return 0;
+}
+
+hostio_t *hostio_open(const char *tx_path, const char *rx_path, int use_pty) {
+    hostio_t *io = calloc(1, sizeof(hostio_t));
+    if (io == NULL) return NULL;
+    io->tx_fd = -1;
+    io->rx_fd = -1;
+
+    if (spsc_init(&io->txq, 1, HOSTIO_QUEUE_SIZE) || spsc_init(&io->rxq, 1, HOSTIO_QUEUE_SIZE)) {
+        printf("Out of memory for UART queues\n");
+        goto fail;
+    }
+
+    if (use_pty) {
+        if (open_pty(io)) goto fail;
+    }
+
+    if (tx_path) {
+        if (strcmp(tx_path, "-") == 0) {
+            io->tx_fd = STDOUT_FILENO;
+        }
+        else {
+            // Open blocking first so a FIFO waits for its reader
+            io->tx_fd = open(tx_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (io->tx_fd < 0) {
+                printf("Could not open UART output %s: %s\n", tx_path, strerror(errno));
+                goto fail;
+            }
+            io->own_tx = 1;
+            set_nonblock(io->tx_fd);
+        }
+    }
+
+    if (rx_path) {
+        if (strcmp(rx_path, "-") == 0) {
+            // Only sensible when stdin is not also used for commands
+            io->rx_fd = STDIN_FILENO;
+        }
+        else {
+            io->rx_fd = open(rx_path, O_RDONLY | O_NONBLOCK);
+            if (io->rx_fd < 0) {
+                printf("Could not open UART input %s: %s\n", rx_path, strerror(errno));
+                goto fail;
+            }
+            io->own_rx = 1;
+        }
+        set_nonblock(io->rx_fd);
+    }
+
+    if (pthread_create(&io->thread, NULL, hostio_thread, io) != 0) {
+        printf("Could not start UART I/O thread\n");
+        goto fail;
+    }
+    return io;
+
+fail:
+    if (io->own_tx && io->tx_fd >= 0) close(io->tx_fd);
+    if (io->own_rx && io->rx_fd >= 0) close(io->rx_fd);
+    spsc_free(&io->txq);
+    spsc_free(&io->rxq);
+    free(io);
+    return NULL;
+}
+
+spsc_t *hostio_txq(hostio_t *io) {
+    return &io->txq;
+}
+
+spsc_t *hostio_rxq(hostio_t *io) {
+    return &io->rxq;
+}
+
+const char *hostio_pty_name(hostio_t *io) {
+    return io->pty_name[0] ? io->pty_name : NULL;
+}
+
+void hostio_close(hostio_t *io) {
+    if (io == NULL) return;
+
+    atomic_store(&io->stop, 1);
+    pthread_join(io->thread, NULL);
+
+    if (io->own_tx && io->tx_fd >= 0) close(io->tx_fd);
+    if (io->own_rx && io->rx_fd >= 0 && io->rx_fd != io->tx_fd) close(io->rx_fd);
+    spsc_free(&io->txq);
+    spsc_free(&io->rxq);
+    free(io);
+}
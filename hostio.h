@@ -0,0 +1,29 @@
+#ifndef HOSTIO_H
+#define HOSTIO_H
+
+#include "spsc.h"
+
+// Host side of the serial port: a background thread that moves bytes
+// between the SPSC queues and files, pipes or a pty, so the CPU loop never
+// makes a syscall per byte.
+
+#define HOSTIO_QUEUE_SIZE (1 << 20)
+#define HOSTIO_POLL_MS 1
+
+typedef struct hostio hostio_t;
+
+// tx_path / rx_path: file or FIFO path, "-" for stdout / stdin, NULL for none.
+// use_pty: create a pseudo terminal carrying both directions instead.
+// Returns NULL (after printing why) on failure.
+hostio_t *hostio_open(const char *tx_path, const char *rx_path, int use_pty);
+
+spsc_t *hostio_txq(hostio_t *io);
+spsc_t *hostio_rxq(hostio_t *io);
+
+// Name of the pty slave to connect a terminal to, or NULL
+const char *hostio_pty_name(hostio_t *io);
+
+// Flushes pending TX bytes, stops the thread and closes the files
+void hostio_close(hostio_t *io);
+
+#endif
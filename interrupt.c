@@ -0,0 +1,207 @@
+// Two-level priority interrupt controller (INT0, T0, INT1, T1, serial, T2)
+#include "system.h"
+#include "journal.h"
+#include <stdio.h>
+
+static const uint16_t irq_vectors[IRQ_SOURCES] = {
+    VECTOR_INT0, VECTOR_TIMER0, VECTOR_INT1, VECTOR_TIMER1, VECTOR_SERIAL, VECTOR_TIMER2
+};
+
+static const char *irq_names[IRQ_SOURCES] = {
+    "INT0", "TIMER0", "INT1", "TIMER1", "SERIAL", "TIMER2"
+};
+
+static int hist_bucket(uint64_t value) {
+    int b = 0;
+    while (value > 1 && b < IRQ_HIST_BUCKETS - 1) {
+        value >>= 1;
+        b++;
+    }
+    return b;
+}
+
+// Recomputes the request masks and the pending flag. Cheap, but only ever
+// called when one of its inputs changes, never per instruction.
+void interrupt_update(system_8051_t *sys) {
+    irq_state_t *irq = &sys->irq;
+
+    // Level-triggered external interrupts follow the (inverted) pin
+    if (!(sys->sfr.TCON & TCON_IT0)) {
+        if (sys->sfr.P3 & P3_INT0) sys->sfr.TCON &= ~TCON_IE0;
+        else sys->sfr.TCON |= TCON_IE0;
+    }
+    if (!(sys->sfr.TCON & TCON_IT1)) {
+        if (sys->sfr.P3 & P3_INT1) sys->sfr.TCON &= ~TCON_IE1;
+        else sys->sfr.TCON |= TCON_IE1;
+    }
+
+    uint8_t req = 0;
+    if (sys->sfr.TCON & TCON_IE0) req |= 1 << IRQ_INT0;
+    if (sys->sfr.TCON & TCON_TF0) req |= 1 << IRQ_TIMER0;
+    if (sys->sfr.TCON & TCON_IE1) req |= 1 << IRQ_INT1;
+    if (sys->sfr.TCON & TCON_TF1) req |= 1 << IRQ_TIMER1;
+    if (sys->sfr.SCON & (SCON_RI | SCON_TI)) req |= 1 << IRQ_SERIAL;
+    if (sys->sfr.T2CON & (T2CON_TF2 | T2CON_EXF2)) req |= 1 << IRQ_TIMER2;
+
+    // ET2 is a reserved bit without Timer 2
+    uint8_t sources = sys->variant->has_timer2 ? 0x3F : 0x1F;
+    uint8_t enabled = (sys->sfr.IE & IE_EA) ? (sys->sfr.IE & sources) : 0;
+    uint8_t live = req & enabled;
+
+    // Stamp newly live sources for latency measurement
+    uint8_t rising = live & ~irq->live;
+    for (int i = 0; rising; i++, rising >>= 1) {
+        if (rising & 1) irq->live_since[i] = sys->cpu.cycles;
+    }
+    irq->live = live;
+
+    irq->req_high = live & sys->sfr.IP;
+    irq->req_low = live & ~sys->sfr.IP;
+
+    irq->pending = (irq->req_high && !(irq->active & IRQ_LEVEL_HIGH)) ||
+                   (irq->req_low && !irq->active);
+}
+
+// Sources whose request would be taken at once: the ones that end idle mode
+uint8_t interrupt_wake_sources(system_8051_t *sys) {
+    if (!(sys->sfr.IE & IE_EA) || (sys->irq.active & IRQ_LEVEL_HIGH)) return 0;
+    uint8_t enabled = sys->sfr.IE & (sys->variant->has_timer2 ? 0x3F : 0x1F);
+    return sys->irq.active ? enabled & sys->sfr.IP : enabled;
+}
+
+// Edge detection for INT0/INT1 when P3 is written
+void interrupt_pins(system_8051_t *sys, uint8_t old_p3) {
+    uint8_t falling = old_p3 & ~sys->sfr.P3;
+
+    if ((sys->sfr.TCON & TCON_IT0) && (falling & P3_INT0)) sys->sfr.TCON |= TCON_IE0;
+    if ((sys->sfr.TCON & TCON_IT1) && (falling & P3_INT1)) sys->sfr.TCON |= TCON_IE1;
+
+    interrupt_update(sys);
+}
+
+// One byte of the hardware LCALL. Like stack_wr in cpu.c, a push past the
+// end of a 128-byte IRAM goes nowhere, so RETI pops it back as 0xFF.
+static void isr_push(system_8051_t *sys, uint8_t value) {
+    sys->cpu.SP++;
+    SANITIZE(sanitize_isr_push(sys));
+    if (sys->variant->iram_size == 128 && sys->cpu.SP >= 0x80) return;
+    if (sys->journal) journal_note(sys->journal, SPACE_IRAM, sys->cpu.SP, sys->iram[sys->cpu.SP], value);
+    sys->iram[sys->cpu.SP] = value;
+}
+
+// Slow path: vectors to the highest priority pending source
+void interrupt_dispatch(system_8051_t *sys) {
+    irq_state_t *irq = &sys->irq;
+
+    // RETI and writes to IE/IP let one more instruction through
+    if (irq->hold) {
+        irq->hold = 0;
+        return;
+    }
+
+    uint8_t mask;
+    uint8_t level;
+    if (irq->req_high && !(irq->active & IRQ_LEVEL_HIGH)) {
+        mask = irq->req_high;
+        level = IRQ_LEVEL_HIGH;
+    }
+    else if (irq->req_low && !irq->active) {
+        mask = irq->req_low;
+        level = IRQ_LEVEL_LOW;
+    }
+    else {
+        irq->pending = 0;
+        return;
+    }
+
+    int src = 0;
+    while (!(mask & (1 << src))) src++;
+
+    // Hardware clears the flags it can attribute to this vector
+    switch (src) {
+        case IRQ_INT0: if (sys->sfr.TCON & TCON_IT0) sys->sfr.TCON &= ~TCON_IE0; break;
+        case IRQ_TIMER0: sys->sfr.TCON &= ~TCON_TF0; break;
+        case IRQ_INT1: if (sys->sfr.TCON & TCON_IT1) sys->sfr.TCON &= ~TCON_IE1; break;
+        case IRQ_TIMER1: sys->sfr.TCON &= ~TCON_TF1; break;
+        default: break; // RI/TI and TF2/EXF2 are left for the ISR
+    }
+
+    uint64_t latency = sys->cpu.cycles - irq->live_since[src];
+    irq->taken[src]++;
+    irq->latency_sum[src] += latency;
+    if (latency > irq->latency_max[src]) irq->latency_max[src] = latency;
+    irq->latency_hist[src][hist_bucket(latency)]++;
+
+    // Hardware LCALL to the vector
+    isr_push(sys, (uint8_t)sys->cpu.PC);
+    isr_push(sys, (uint8_t)(sys->cpu.PC >> 8));
+    sys->cpu.PC = irq_vectors[src];
+
+    // Taking an interrupt ends idle and power-down; RETI resumes after the
+    // instruction that entered them
+    sys->sfr.PCON &= ~PCON_SLEEP;
+
+    irq->active |= level;
+    if (irq->depth < 2) {
+        irq->isr_src[irq->depth] = src;
+        irq->isr_sp[irq->depth] = sys->cpu.SP;
+        irq->isr_start[irq->depth] = sys->cpu.cycles;
+        irq->depth++;
+    }
+
+    // Costs the same as an LCALL on this core
+    uint64_t call_clocks = sys->variant->cycles[0x12] * sys->variant->cycle_clocks;
+    sys->cpu.cycles += call_clocks;
+    peripherals_step(sys, call_clocks);
+    interrupt_update(sys);
+}
+
+void interrupt_reti(system_8051_t *sys) {
+    irq_state_t *irq = &sys->irq;
+
+    if (irq->active & IRQ_LEVEL_HIGH) irq->active &= ~IRQ_LEVEL_HIGH;
+    else irq->active &= ~IRQ_LEVEL_LOW;
+
+    if (irq->depth > 0) {
+        irq->depth--;
+        int src = irq->isr_src[irq->depth];
+        uint64_t isr_cycles = sys->cpu.cycles - irq->isr_start[irq->depth];
+        irq->isr_done[src]++;
+        irq->isr_sum[src] += isr_cycles;
+        if (isr_cycles > irq->isr_max[src]) irq->isr_max[src] = isr_cycles;
+        irq->isr_hist[src][hist_bucket(isr_cycles)]++;
+    }
+
+    irq->hold = 1;
+    interrupt_update(sys);
+}
+
+static void print_hist(const uint32_t *hist) {
+    for (int b = 0; b < IRQ_HIST_BUCKETS; b++) {
+        if (hist[b] == 0) continue;
+        printf("|     %8lu..%-8lu : %u\n", b ? 1UL << b : 0, (2UL << b) - 1, hist[b]);     // The first bucket holds 0 too
+    }
+}
+
+void interrupt_print_stats(system_8051_t *sys) {
+    irq_state_t *irq = &sys->irq;
+
+    printf("\n| INTERRUPTS          | IE: 0x%02X | IP: 0x%02X | IN SERVICE: %s%s\n",
+           sys->sfr.IE, sys->sfr.IP,
+           (irq->active & IRQ_LEVEL_HIGH) ? "HIGH " : "",
+           (irq->active & IRQ_LEVEL_LOW) ? "LOW" : "");
+    printf("|---------------------+--------------------------------------------\n");
+
+    for (int i = 0; i < IRQ_SOURCES; i++) {
+        if (irq->taken[i] == 0) continue;
+        printf("| %-6s taken %lu times\n", irq_names[i], irq->taken[i]);
+        printf("|   latency (cycles)  : avg %lu, max %lu\n",
+               irq->latency_sum[i] / irq->taken[i], irq->latency_max[i]);
+        print_hist(irq->latency_hist[i]);
+        if (irq->isr_done[i]) {
+            printf("|   ISR time (cycles) : avg %lu, max %lu\n",
+                   irq->isr_sum[i] / irq->isr_done[i], irq->isr_max[i]);
+            print_hist(irq->isr_hist[i]);
+        }
+    }
+}
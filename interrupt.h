@@ -0,0 +1,54 @@
+#ifndef INTERRUPT_H
+#define INTERRUPT_H
+
+#include <stdint.h>
+
+// Interrupt sources, in natural polling priority order.
+// Bit n of IE/IP enables/prioritises source n.
+#define IRQ_INT0    0
+#define IRQ_TIMER0  1
+#define IRQ_INT1    2
+#define IRQ_TIMER1  3
+#define IRQ_SERIAL  4
+#define IRQ_TIMER2  5   // Variants with has_timer2 only
+#define IRQ_SOURCES 6
+
+// In-service priority levels
+#define IRQ_LEVEL_LOW  0x01
+#define IRQ_LEVEL_HIGH 0x02
+
+// log2 buckets: bucket n counts values in [2^n, 2^(n+1)) clocks
+#define IRQ_HIST_BUCKETS 24
+
+typedef struct {
+    // Nonzero when an interrupt can be taken. This is the only thing the
+    // run loop looks at per instruction; everything below is slow path.
+    uint8_t pending;
+
+    uint8_t req_low;    // Enabled + requested sources at low priority
+    uint8_t req_high;   // Enabled + requested sources at high priority
+    uint8_t active;     // In-service levels (IRQ_LEVEL_*)
+    uint8_t hold;       // Finish one more instruction first (after RETI / IE / IP write); cleared after it
+
+    // Nesting stack (at most one low and one high ISR)
+    uint8_t depth;
+    uint8_t isr_src[2];
+    uint8_t isr_sp[2];      // SP after the vector push: the interrupted PC is at SP-1/SP
+    uint64_t isr_start[2];
+
+    // Latency bookkeeping: cycle at which each source became enabled + requested
+    uint8_t live;
+    uint64_t live_since[IRQ_SOURCES];
+
+    // STATISTICS (clocks)
+    uint64_t taken[IRQ_SOURCES];
+    uint64_t latency_max[IRQ_SOURCES];
+    uint64_t latency_sum[IRQ_SOURCES];
+    uint64_t isr_max[IRQ_SOURCES];
+    uint64_t isr_sum[IRQ_SOURCES];
+    uint64_t isr_done[IRQ_SOURCES];
+    uint32_t latency_hist[IRQ_SOURCES][IRQ_HIST_BUCKETS];
+    uint32_t isr_hist[IRQ_SOURCES][IRQ_HIST_BUCKETS];
+} irq_state_t;
+
+#endif
@@ -0,0 +1,152 @@
+// Per-instruction state diffs from the write journal
+#include <stddef.h>
+#include <string.h>
+#include "journal.h"
+#include "opcodes.h"
+
+// Registers and SFRs compared around each step, by SFR address
+typedef struct {
+    const char *name;
+    uint8_t address;
+    uint8_t offset;
+} journal_reg_t;
+
+#define CORE(field, addr) { #field, addr, offsetof(cpu_core_t, field) }
+#define SFR(field, addr) { #field, addr, offsetof(peripherals_t, field) }
+
+static const journal_reg_t core_regs[] = {
+    CORE(A, 0xE0), CORE(B, 0xF0), CORE(PSW, 0xD0), CORE(SP, 0x81),
+};
+
+static const journal_reg_t sfr_regs[] = {
+    SFR(P0, 0x80), SFR(PCON, 0x87), SFR(TCON, 0x88), SFR(TMOD, 0x89), SFR(TL0, 0x8A), SFR(TL1, 0x8B),
+    SFR(TH0, 0x8C), SFR(TH1, 0x8D), SFR(P1, 0x90), SFR(SCON, 0x98), SFR(SBUF, 0x99), SFR(P2, 0xA0),
+    SFR(AUXR1, 0xA2), SFR(IE, 0xA8), SFR(P3, 0xB0), SFR(IP, 0xB8), SFR(T2CON, 0xC8), SFR(T2MOD, 0xC9),
+    SFR(RCAP2L, 0xCA), SFR(RCAP2H, 0xCB), SFR(TL2, 0xCC), SFR(TH2, 0xCD),
+};
+
+#define CORE_REGS (sizeof(core_regs) / sizeof(core_regs[0]))
+#define SFR_REGS (sizeof(sfr_regs) / sizeof(sfr_regs[0]))
+
+int journal_open(journal_t *j, const char *path, const char *format) {
+    memset(j, 0, sizeof(*j));
+
+    if (format == NULL || strcmp(format, "text") == 0) j->format = JOURNAL_TEXT;
+    else if (strcmp(format, "binary") == 0) j->format = JOURNAL_BINARY;
+    else {
+        printf("Unknown diff format %s (use text or binary)\n", format);
+        return 1;
+    }
+
+    if (path == NULL || strcmp(path, "-") == 0) {
+        j->out = stdout;
+    }
+    else {
+        j->out = fopen(path, j->format == JOURNAL_BINARY ? "wb" : "w");
+        if (j->out == NULL) {
+            printf("Could not open %s for writing\n", path);
+            return 1;
+        }
+    }
+    if (j->format == JOURNAL_BINARY) {
+        fwrite("SD51", 1, 4, j->out);
+        fputc(JOURNAL_VERSION, j->out);
+    }
+    return 0;
+}
+
+void journal_close(journal_t *j) {
+    if (j->out == NULL) return;
+    if (j->out == stdout) fflush(stdout);
+    else fclose(j->out);
+    j->out = NULL;
+}
+
+void journal_begin(system_8051_t *sys) {
+    journal_t *j = sys->journal;
+    j->count = 0;
+    j->cpu = sys->cpu;
+    j->sfr = sys->sfr;
+}
+
+typedef struct {
+    uint8_t space;
+    uint16_t address;
+    uint8_t value;
+    const char *name;           // Registers and SFRs
+} journal_change_t;
+
+#define JOURNAL_CHANGES (CORE_REGS + 2 + SFR_REGS + JOURNAL_MAX)
+
+static uint32_t collect(system_8051_t *sys, journal_change_t *c) {
+    journal_t *j = sys->journal;
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; i < CORE_REGS; i++) {
+        uint8_t old = ((const uint8_t *)&j->cpu)[core_regs[i].offset];
+        uint8_t now = ((const uint8_t *)&sys->cpu)[core_regs[i].offset];
+        if (old != now) c[n++] = (journal_change_t){ SPACE_SFR, core_regs[i].address, now, core_regs[i].name };
+    }
+    if ((j->cpu.DPTR & 0xFF) != (sys->cpu.DPTR & 0xFF)) c[n++] = (journal_change_t){ SPACE_SFR, 0x82, sys->cpu.DPTR & 0xFF, "DPL" };
+    if ((j->cpu.DPTR >> 8) != (sys->cpu.DPTR >> 8)) c[n++] = (journal_change_t){ SPACE_SFR, 0x83, sys->cpu.DPTR >> 8, "DPH" };
+    for (uint32_t i = 0; i < SFR_REGS; i++) {
+        uint8_t old = ((const uint8_t *)&j->sfr)[sfr_regs[i].offset];
+        uint8_t now = ((const uint8_t *)&sys->sfr)[sfr_regs[i].offset];
+        if (old != now) c[n++] = (journal_change_t){ SPACE_SFR, sfr_regs[i].address, now, sfr_regs[i].name };
+    }
+
+    // A byte written twice keeps its first old value and its last new one
+    for (uint32_t w = 0; w < j->count; w++) {
+        const journal_write_t *first = &j->writes[w];
+        int seen = 0;
+        for (uint32_t e = 0; e < w && !seen; e++) seen = j->writes[e].space == first->space && j->writes[e].address == first->address;
+        if (seen) continue;
+
+        uint8_t value = first->value;
+        for (uint32_t l = w + 1; l < j->count; l++) {
+            if (j->writes[l].space == first->space && j->writes[l].address == first->address) value = j->writes[l].value;
+        }
+        if (value != first->old) c[n++] = (journal_change_t){ first->space, first->address, value, NULL };
+    }
+    return n;
+}
+
+void journal_end(system_8051_t *sys) {
+    journal_t *j = sys->journal;
+    if (sys->cpu.cycles == j->cpu.cycles) return;     // Stopped before executing anything
+
+    journal_change_t changes[JOURNAL_CHANGES];
+    uint32_t n = collect(sys, changes);
+    uint16_t pc = j->cpu.PC;
+
+    if (j->format == JOURNAL_BINARY) {
+        uint32_t clocks = (uint32_t)(sys->cpu.cycles - j->cpu.cycles);
+        uint8_t head[9] = {
+            pc & 0xFF, pc >> 8, sys->cpu.PC & 0xFF, sys->cpu.PC >> 8,
+            clocks & 0xFF, (clocks >> 8) & 0xFF, (clocks >> 16) & 0xFF, clocks >> 24, n
+        };
+        fwrite(head, 1, sizeof(head), j->out);
+        for (uint32_t i = 0; i < n; i++) {
+            uint8_t rec[4] = { changes[i].space, changes[i].address & 0xFF, changes[i].address >> 8, changes[i].value };
+            fwrite(rec, 1, sizeof(rec), j->out);
+        }
+        return;
+    }
+
+    // Nothing executed when the step was spent asleep
+    char text[32] = "(asleep)";
+    int len = 0;
+    if (sys->cpu.instructions != j->cpu.instructions) {
+        uint8_t code[3];
+        for (int b = 0; b < 3; b++) code[b] = system_read_code(sys, pc + b);
+        len = opcode_disasm(code, pc, text, sizeof(text));
+    }
+    fprintf(j->out, "0x%04X  %-22s", pc, text);
+    for (uint32_t i = 0; i < n; i++) {
+        if (changes[i].name) fprintf(j->out, " %s=%02X", changes[i].name, changes[i].value);
+        else fprintf(j->out, " %c:%0*X=%02X", changes[i].space == SPACE_IRAM ? 'i' : 'x',
+                     changes[i].space == SPACE_IRAM ? 2 : 4, changes[i].address, changes[i].value);
+    }
+    if (sys->cpu.PC != (uint16_t)(pc + len)) fprintf(j->out, " PC=%04X", sys->cpu.PC);
+    fprintf(j->out, "\n");
+}
@@ -0,0 +1,65 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "system.h"
+
+// Per-instruction state diffs. While sys->journal is set, the instrumented
+// interpreter (step_watch) and interrupt entry note every IRAM and XRAM
+// byte they write, with its old value. The core registers and SFRs are
+// compared against a copy of those few bytes taken before the step. Nothing
+// else in system_8051_t is looked at.
+//
+// Text records, one line per step:
+//   0x0040  CJNE A, #0x0A, 0x003E  SP=09 TL0=A4 i:08=43 i:09=00 PC=000B
+// PC is only listed when it is not the next instruction (a jump, or an
+// interrupt taken at the end of the step).
+//
+// Binary streams start with the 4-byte magic "SD51" and a version byte;
+// every step is then, little-endian:
+//   uint16 pc before, uint16 pc after, uint32 clocks, uint8 n,
+//   n x { uint8 space (SPACE_SFR, SPACE_IRAM or SPACE_XRAM), uint16 address, uint8 value }
+// Core registers appear as their SFRs (A = 0xE0, DPL = 0x82, ...).
+
+#define JOURNAL_MAX 16          // Writes kept per step; an instruction and an interrupt entry make at most 4
+#define JOURNAL_VERSION 1
+
+typedef enum {
+    JOURNAL_TEXT,
+    JOURNAL_BINARY
+} journal_format_t;
+
+typedef struct {
+    uint8_t space;              // SPACE_IRAM or SPACE_XRAM
+    uint16_t address;
+    uint8_t old;
+    uint8_t value;
+} journal_write_t;
+
+typedef struct journal {
+    FILE *out;
+    journal_format_t format;
+    uint32_t count;
+    journal_write_t writes[JOURNAL_MAX];
+
+    // Before the step
+    cpu_core_t cpu;
+    peripherals_t sfr;
+} journal_t;
+
+// path NULL or "-" = stdout. format is "text" or "binary". Returns 0 on success.
+int journal_open(journal_t *j, const char *path, const char *format);
+void journal_close(journal_t *j);
+
+// Brackets one system_step() or system_run(sys, 1, ...); journal_end()
+// writes the record
+void journal_begin(system_8051_t *sys);
+void journal_end(system_8051_t *sys);
+
+// Called by the writers, before the write
+static inline void journal_note(journal_t *j, uint8_t space, uint16_t address, uint8_t old, uint8_t value) {
+    if (j->count < JOURNAL_MAX) j->writes[j->count++] = (journal_write_t){ space, address, old, value };
+}
+
+#endif
@@ -0,0 +1,463 @@
+// Lockstep differential runs and random instruction streams
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lockstep.h"
+#include "cover.h"
+#include "opcodes.h"
+#include "sym.h"
+
+static const char *engine_names[LOCKSTEP_ENGINES] = { "run", "cover", "aot" };
+
+int lockstep_engine_find(const char *name) {
+    for (int e = 0; e < LOCKSTEP_ENGINES; e++) {
+        if (strcmp(engine_names[e], name) == 0) return e;
+    }
+    return -1;
+}
+
+// A full copy whose RAM pages point into its own XRAM
+static system_8051_t *clone(const system_8051_t *src) {
+    system_8051_t *dst = malloc(sizeof(system_8051_t));
+    if (dst == NULL) return NULL;
+    memcpy(dst, src, sizeof(system_8051_t));
+    for (int p = 0; p < XDATA_PAGES; p++) {
+        if (src->xdata[p].mem) dst->xdata[p].mem = dst->xram + (src->xdata[p].mem - src->xram);
+    }
+    return dst;
+}
+
+static system_8051_t *make_reference(const system_8051_t *src) {
+    system_8051_t *ref = clone(src);
+    if (ref == NULL) return NULL;
+    ref->aot = NULL;
+    ref->cover = NULL;
+    ref->journal = NULL;
+    ref->portlog = NULL;
+    ref->cosim = NULL;
+    ref->uart.txq = NULL;
+    ref->uart.rxq = NULL;
+    debug_clear_all(ref);
+    return ref;
+}
+
+// One batch of the engine under test. Returns 0 once it is asleep with
+// nothing left to wake it.
+static int engine_batch(system_8051_t *dut, uint64_t every) {
+    run_result_t result = system_run(dut, every, RUN_NO_LIMIT);
+    if (result == RUN_HALT) {
+        if (dut->sfr.PCON & PCON_SLEEP) return 0;
+        system_step(dut);       // SJMP $: keep going, as headless runs do
+    }
+    return 1;
+}
+
+// Steps the reference to the engine's instruction count. It stops early if
+// it falls behind in time, which the comparison then reports.
+static void catch_up(system_8051_t *ref, const system_8051_t *dut) {
+    while (ref->cpu.instructions < dut->cpu.instructions && ref->cpu.cycles <= dut->cpu.cycles) {
+        system_step(ref);
+    }
+}
+
+#define MAX_BYTE_DIFFS 16   // Memory bytes listed per space
+
+#define FIELD(field, label) do { \
+        if ((uint64_t)ref->field != (uint64_t)dut->field) { \
+            if (print) printf("  %-16s reference 0x%llX, engine 0x%llX\n", label, \
+                              (unsigned long long)ref->field, (unsigned long long)dut->field); \
+            n++; \
+        } \
+    } while (0)
+
+static uint32_t diff_bytes(const char *space, const uint8_t *ref, const uint8_t *dut, uint32_t size, int print) {
+    if (memcmp(ref, dut, size) == 0) return 0;
+
+    uint32_t n = 0;
+    for (uint32_t a = 0; a < size; a++) {
+        if (ref[a] == dut[a]) continue;
+        if (print && n < MAX_BYTE_DIFFS) printf("  %s:%0*X%*s reference 0x%02X, engine 0x%02X\n",
+                                                space, size > 256 ? 4 : 2, a, size > 256 ? 9 : 11, "", ref[a], dut[a]);
+        n++;
+    }
+    if (print && n > MAX_BYTE_DIFFS) printf("  ... %u more %s bytes\n", n - MAX_BYTE_DIFFS, space);
+    return n;
+}
+
+// Number of differing fields and bytes, listed when `print` is set
+static uint32_t diff(const system_8051_t *ref, const system_8051_t *dut, int print) {
+    uint32_t n = 0;
+
+    FIELD(cpu.PC, "PC");
+    FIELD(cpu.A, "A");
+    FIELD(cpu.B, "B");
+    FIELD(cpu.PSW, "PSW");
+    FIELD(cpu.SP, "SP");
+    FIELD(cpu.DPTR, "DPTR");
+    FIELD(cpu.DPTR_alt, "DPTR (other)");
+    FIELD(cpu.cycles, "cycles");
+    FIELD(cpu.instructions, "instructions");
+    FIELD(EA, "EA");
+
+    FIELD(sfr.TCON, "TCON");
+    FIELD(sfr.TMOD, "TMOD");
+    FIELD(sfr.TL0, "TL0");
+    FIELD(sfr.TH0, "TH0");
+    FIELD(sfr.TL1, "TL1");
+    FIELD(sfr.TH1, "TH1");
+    FIELD(sfr.T2CON, "T2CON");
+    FIELD(sfr.T2MOD, "T2MOD");
+    FIELD(sfr.RCAP2L, "RCAP2L");
+    FIELD(sfr.RCAP2H, "RCAP2H");
+    FIELD(sfr.TL2, "TL2");
+    FIELD(sfr.TH2, "TH2");
+    FIELD(sfr.SCON, "SCON");
+    FIELD(sfr.SBUF, "SBUF");
+    FIELD(sfr.P0, "P0");
+    FIELD(sfr.P1, "P1");
+    FIELD(sfr.P2, "P2");
+    FIELD(sfr.P3, "P3");
+    FIELD(sfr.IE, "IE");
+    FIELD(sfr.IP, "IP");
+    FIELD(sfr.PCON, "PCON");
+    FIELD(sfr.AUXR1, "AUXR1");
+    FIELD(sfr.clock_rem, "timer clock rem");
+    FIELD(sfr.t2_clock_rem, "T2 clock rem");
+
+    FIELD(irq.pending, "irq pending");
+    FIELD(irq.req_low, "irq req low");
+    FIELD(irq.req_high, "irq req high");
+    FIELD(irq.active, "irq active");
+    FIELD(irq.hold, "irq hold");
+    FIELD(irq.depth, "irq depth");
+    for (int d = 0; d < 2 && d < ref->irq.depth; d++) {
+        FIELD(irq.isr_src[d], "irq source");
+        FIELD(irq.isr_sp[d], "irq SP");
+    }
+    for (int s = 0; s < IRQ_SOURCES; s++) FIELD(irq.taken[s], "irq taken");
+
+    FIELD(uart.tx_busy, "uart tx busy");
+    FIELD(uart.tx_data, "uart tx data");
+    FIELD(uart.tx_left, "uart tx left");
+    FIELD(uart.rx_busy, "uart rx busy");
+    FIELD(uart.rx_data, "uart rx data");
+    FIELD(uart.rx_left, "uart rx left");
+    FIELD(uart.tx_bytes, "uart tx bytes");
+
+    n += diff_bytes("i", ref->iram, dut->iram, sizeof(ref->iram), print);
+    n += diff_bytes("x", ref->xram, dut->xram, sizeof(ref->xram), print);
+    return n;
+}
+
+static void print_insn(const system_8051_t *sys, uint16_t pc) {
+    uint8_t code[3];
+    char text[32];
+    for (int b = 0; b < 3; b++) code[b] = system_read_code((system_8051_t *)sys, pc + b);
+    opcode_disasm(code, pc, text, sizeof(text));
+    printf("  at 0x%04X: opcode 0x%02X  %s", pc, code[0], text);
+    if (sys->syms) {
+        char name[64];
+        sym_format(sys->syms, SYM_CODE, pc, name, sizeof(name));
+        printf("  (%s)", name);
+    }
+    printf("\n");
+}
+
+// Replays from `origin` to `good` instructions, then single-steps to the
+// first differing instruction. Returns 1 if it was found.
+static int pinpoint(const system_8051_t *origin, uint64_t good, uint64_t bad, uint64_t every, const char *engine) {
+    system_8051_t *dut = clone(origin);
+    system_8051_t *ref = make_reference(origin);
+    int found = 0;
+
+    if (dut && ref) {
+        while (dut->cpu.instructions < good && engine_batch(dut, every)) { }
+        catch_up(ref, dut);
+
+        while (dut->cpu.instructions < bad) {
+            uint16_t pc = dut->cpu.PC;
+            uint64_t instructions = dut->cpu.instructions;
+            if (!engine_batch(dut, 1)) break;
+            catch_up(ref, dut);
+            if (diff(ref, dut, 0)) {
+                printf("Lockstep divergence (engine %s) in instruction %llu:\n", engine, (unsigned long long)instructions + 1);
+                print_insn(dut, pc);
+                diff(ref, dut, 1);
+                found = 1;
+                break;
+            }
+        }
+    }
+    free(dut);
+    free(ref);
+    return found;
+}
+
+int lockstep_run(system_8051_t *sys, lockstep_engine_t engine, uint64_t max_insns, uint64_t every) {
+    if (engine == LOCKSTEP_AOT && sys->aot == NULL) {
+        printf("Error: The aot engine needs --aot\n");
+        return 1;
+    }
+    if (engine != LOCKSTEP_AOT && sys->aot) {
+        printf("Error: --aot only goes with the aot engine\n");
+        return 1;
+    }
+    if (engine == LOCKSTEP_COVER && sys->cover == NULL) {
+        sys->cover = calloc(1, sizeof(coverage_t));
+        if (sys->cover == NULL) return 1;
+    }
+    if (every == 0) every = 1;
+
+    system_8051_t *origin = clone(sys);
+    system_8051_t *ref = make_reference(sys);
+    if (origin == NULL || ref == NULL) {
+        free(origin);
+        free(ref);
+        return 1;
+    }
+
+    const char *name = engine_names[engine];
+    uint64_t end = sys->cpu.instructions + max_insns;
+    uint64_t good = sys->cpu.instructions;
+    uint16_t batch_pc = sys->cpu.PC;
+    int diverged = 0;
+    int asleep = 0;
+
+    while (sys->cpu.instructions < end) {
+        uint64_t left = end - sys->cpu.instructions;
+        batch_pc = sys->cpu.PC;
+        asleep = !engine_batch(sys, left < every ? left : every);
+        catch_up(ref, sys);
+        if (diff(ref, sys, 0)) {
+            diverged = 1;
+            break;
+        }
+        good = sys->cpu.instructions;
+        if (asleep) break;
+    }
+
+    int single = sys->cpu.instructions - good <= 1;
+    if (diverged && (single || !pinpoint(origin, good, sys->cpu.instructions, every, name))) {
+        if (single) {
+            printf("Lockstep divergence (engine %s) in instruction %llu:\n", name, (unsigned long long)good + 1);
+            print_insn(sys, batch_pc);
+        }
+        else {
+            printf("Lockstep divergence (engine %s) in instructions %llu-%llu (not reproduced one at a time):\n",
+                   name, (unsigned long long)good + 1, (unsigned long long)sys->cpu.instructions);
+        }
+        diff(ref, sys, 1);
+    }
+    else if (!diverged) {
+        printf("Lockstep: %llu instructions, %llu clocks, engine %s in batches of %llu: no divergence%s\n",
+               (unsigned long long)(sys->cpu.instructions - origin->cpu.instructions),
+               (unsigned long long)(sys->cpu.cycles - origin->cpu.cycles), name, (unsigned long long)every,
+               asleep ? " (stopped asleep for good)" : "");
+    }
+
+    free(origin);
+    free(ref);
+    return diverged;
+}
+
+// RANDOM INSTRUCTION STREAMS
+// Code sits in the first 0xC0 bytes of every 256-byte block; the rest of
+// each block holds the pads that AJMP/ACALL land on (an AJMP can only
+// reach the block its opcode names).
+#define BLOCK_CODE  0xC0
+#define BLOCKS      ((RANDOM_END >> 8) + 1)
+#define MAX_EMIT    16              // Longest setup + instruction + padding + block exit
+
+typedef struct {
+    system_8051_t *sys;
+    uint64_t rng;
+    uint32_t pc;
+    uint32_t pad[BLOCKS];           // Next free pad byte of each block
+    uint8_t seen[256];
+} gen_t;
+
+static uint8_t gen_byte(gen_t *g) {
+    g->rng ^= g->rng << 13;
+    g->rng ^= g->rng >> 7;
+    g->rng ^= g->rng << 17;
+    return (uint8_t)(g->rng >> 24);
+}
+
+static void put(gen_t *g, uint8_t value) {
+    system_write_code(g->sys, g->pc++, value);
+}
+
+// MOV direct, #data
+static void put_mov(gen_t *g, uint8_t direct, uint8_t value) {
+    put(g, 0x75);
+    put(g, direct);
+    put(g, value);
+}
+
+// SFRs every core has, without PCON; then the Timer 2 and AUXR1 ones
+static const uint8_t common_sfrs[] = {
+    0x80, 0x81, 0x82, 0x83, 0x88, 0x89, 0x8A, 0x8B, 0x8C, 0x8D, 0x90, 0x98,
+    0x99, 0xA0, 0xA8, 0xB0, 0xB8, 0xD0, 0xE0, 0xF0
+};
+static const uint8_t timer2_sfrs[] = { 0xC8, 0xC9, 0xCA, 0xCB, 0xCC, 0xCD };
+static const uint8_t bit_sfrs[] = { 0x80, 0x88, 0x90, 0x98, 0xA0, 0xA8, 0xB0, 0xB8, 0xD0, 0xE0, 0xF0 };
+
+#define COUNT(a) (sizeof(a) / sizeof(a[0]))
+
+// Direct operand: RAM half the time, else an SFR the core has
+static uint8_t gen_direct(gen_t *g) {
+    uint8_t r = gen_byte(g);
+    if (r < 0x80) return r;
+
+    const cpu_variant_t *v = g->sys->variant;
+    uint32_t count = COUNT(common_sfrs) + (v->has_timer2 ? COUNT(timer2_sfrs) : 0) + (v->dual_dptr ? 1 : 0);
+    uint32_t pick = gen_byte(g) % count;
+    if (pick < COUNT(common_sfrs)) return common_sfrs[pick];
+    pick -= COUNT(common_sfrs);
+    if (v->has_timer2 && pick < COUNT(timer2_sfrs)) return timer2_sfrs[pick];
+    return 0xA2;
+}
+
+// Bit operand: a RAM bit half the time, else a bit of an addressable SFR
+static uint8_t gen_bit(gen_t *g) {
+    uint8_t r = gen_byte(g);
+    if (r < 0x80) return r;
+
+    uint32_t count = COUNT(bit_sfrs) + (g->sys->variant->has_timer2 ? 1 : 0);
+    uint32_t pick = gen_byte(g) % count;
+    return (pick < COUNT(bit_sfrs) ? bit_sfrs[pick] : 0xC8) | (r & 7);
+}
+
+// Emits `op` with random operands at g->pc. Returns 0 if no pad was left
+// for an AJMP/ACALL (nothing is emitted then).
+static int emit(gen_t *g, uint8_t op) {
+    const opcode_info_t *info = &opcode_table[op];
+    uint32_t start = g->pc;
+
+    // Returns come back to the next instruction, pushed just before them.
+    // Pushes keep the address below SP, where an interrupt taken in between
+    // cannot overwrite it.
+    if (info->flags & OPF_RETURN) {
+        uint16_t next = start + 12;
+        put_mov(g, 0x81, 0x20);
+        put(g, 0x74);               // MOV A, #lo; PUSH ACC
+        put(g, next & 0xFF);
+        put(g, 0xC0);
+        put(g, 0xE0);
+        put(g, 0x74);               // MOV A, #hi; PUSH ACC
+        put(g, next >> 8);
+        put(g, 0xC0);
+        put(g, 0xE0);
+        put(g, op);
+        return 1;
+    }
+    if (info->flags & OPF_INDIRECT_JUMP) {
+        uint16_t next = start + 5;
+        put(g, 0x90);
+        put(g, next >> 8);
+        put(g, next & 0xFF);
+        put(g, 0xE4);               // CLR A
+        put(g, op);
+        return 1;
+    }
+
+    uint16_t next = start + info->length;
+    uint8_t skip = 0;
+    uint8_t bytes[2];
+    int count = 0;
+    for (int o = 0; o < 3; o++) {
+        switch (info->operands[o]) {
+            case OPK_DIRECT: bytes[count++] = gen_direct(g); break;
+            case OPK_IMM8: bytes[count++] = gen_byte(g); break;
+            case OPK_BIT:
+            case OPK_NBIT: bytes[count++] = gen_bit(g); break;
+            case OPK_IMM16: bytes[count++] = gen_byte(g); bytes[count++] = gen_byte(g); break;
+            case OPK_REL: skip = gen_byte(g) & 3; bytes[count++] = skip; break;
+            case OPK_ADDR16: bytes[count++] = next >> 8; bytes[count++] = next & 0xFF; break;
+            case OPK_ADDR11: {
+                uint32_t block = ((next & 0xF800) | (op >> 5) << 8) >> 8;
+                if (block >= BLOCKS || g->pad[block] + 3 > (block + 1) << 8) return 0;
+                uint32_t pad = g->pad[block];
+                g->pad[block] = pad + 3;
+                system_write_code(g->sys, pad, 0x02);       // LJMP next
+                system_write_code(g->sys, pad + 1, next >> 8);
+                system_write_code(g->sys, pad + 2, next & 0xFF);
+                bytes[count++] = pad & 0xFF;
+                break;
+            }
+            default: break;
+        }
+    }
+
+    put(g, op);
+    for (int b = 0; b < count; b++) put(g, bytes[b]);
+    for (int b = 0; b < skip; b++) put(g, 0x00);          // NOP, whichever way the branch goes
+    return 1;
+}
+
+int lockstep_random_rom(system_8051_t *sys, uint64_t seed) {
+    static const uint16_t vectors[] = {
+        VECTOR_INT0, VECTOR_TIMER0, VECTOR_INT1, VECTOR_TIMER1, VECTOR_SERIAL, VECTOR_TIMER2
+    };
+    gen_t g;
+    memset(&g, 0, sizeof(g));
+    g.sys = sys;
+    g.rng = seed * 0x9E3779B97F4A7C15ull + 0x632BE59BD9B4E019ull;
+    if (g.rng == 0) g.rng = 1;
+    for (uint32_t b = 0; b < BLOCKS; b++) g.pad[b] = (b << 8) + BLOCK_CODE;
+
+    g.pc = VECTOR_RESET;
+    put(&g, 0x02);
+    put(&g, RANDOM_ORIGIN >> 8);
+    put(&g, RANDOM_ORIGIN & 0xFF);
+    // Each handler turns its own source off (CLR IE.n), so that a request
+    // the stream never clears cannot take every other instruction for good
+    for (size_t v = 0; v < sizeof(vectors) / sizeof(vectors[0]); v++) {
+        g.pc = vectors[v];
+        put(&g, 0xC2);
+        put(&g, 0xA8 + v);
+        put(&g, 0x32);              // RETI
+    }
+
+    uint8_t ops[256];
+    int op_count = 0;
+    for (int op = 0; op < 256; op++) {
+        if (!(opcode_table[op].flags & OPF_INVALID)) ops[op_count++] = op;
+    }
+
+    g.pc = RANDOM_ORIGIN;
+    int next = op_count;
+    while (1) {
+        // Leave the block before its pads, or loop back at the end
+        if ((g.pc & 0xFF) + MAX_EMIT > BLOCK_CODE) {
+            uint32_t to = (g.pc | 0xFF) + 1;
+            if (to >= RANDOM_END) break;
+            put(&g, 0x02);
+            put(&g, to >> 8);
+            put(&g, to & 0xFF);
+            g.pc = to;
+        }
+
+        // Rounds of every opcode in a fresh order
+        if (next == op_count) {
+            for (int i = op_count - 1; i > 0; i--) {
+                uint32_t r = gen_byte(&g) << 8;
+                r |= gen_byte(&g);
+                int j = r % (i + 1);
+                uint8_t t = ops[i];
+                ops[i] = ops[j];
+                ops[j] = t;
+            }
+            next = 0;
+        }
+        uint8_t op = ops[next++];
+        if (emit(&g, op)) g.seen[op] = 1;
+    }
+    put(&g, 0x02);
+    put(&g, RANDOM_ORIGIN >> 8);
+    put(&g, RANDOM_ORIGIN & 0xFF);
+
+    int covered = 0;
+    for (int op = 0; op < 256; op++) covered += g.seen[op];
+    return covered;
+}
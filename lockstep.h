@@ -0,0 +1,56 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <stdint.h>
+#include "system.h"
+
+// Differential runs. The system handed in is the engine under test, with
+// whatever it needs attached (sys->aot, sys->cover). A copy of it with
+// nothing attached is the reference and goes through system_step() one
+// instruction at a time on the plain interpreter. The engine runs
+// system_run() in batches of `every` instructions; after each batch the
+// reference catches up to the same instruction count and the two machines
+// are compared: core, SFRs, interrupt controller, serial port, IRAM and
+// XRAM.
+//
+// On a mismatch inside a batch of more than one instruction, both machines
+// are replayed from the start with the same batches up to the last point
+// where they agreed, then single-stepped to the first differing
+// instruction. The report names its PC and opcode and lists every field
+// that differs.
+//
+// Neither machine is bound to host I/O, so both see the same (absent)
+// serial input.
+
+typedef enum {
+    LOCKSTEP_RUN,       // system_run() fast loop, plain interpreter
+    LOCKSTEP_COVER,     // Coverage-recording interpreter
+    LOCKSTEP_AOT,       // Translated blocks (sys->aot must be loaded)
+    LOCKSTEP_ENGINES
+} lockstep_engine_t;
+
+// -1 if the name is unknown
+int lockstep_engine_find(const char *name);
+
+// Returns 0 when no divergence was found within `max_insns` instructions
+// (or before the program went to sleep for good), 1 on a divergence
+int lockstep_run(system_8051_t *sys, lockstep_engine_t engine, uint64_t max_insns, uint64_t every);
+
+// Random instruction streams for the harness. Fills code memory from
+// RANDOM_ORIGIN with rounds of every valid opcode in shuffled order and
+// random operands, arranged so that control flow always lands on an
+// instruction: branches skip forward over NOP padding, jumps and calls go
+// to the next instruction or to a pad that jumps back to it, and returns
+// and JMP @A+DPTR are preceded by the setup that makes them do the same.
+// Interrupt handlers disable their source and return, and the stream
+// loops back to its start.
+// Direct and bit operands name RAM or an SFR the core has, never PCON, so
+// the core cannot put itself to sleep.
+// The same seed always gives the same code. Returns the number of opcodes
+// that appear at least once.
+#define RANDOM_ORIGIN 0x0030
+#define RANDOM_END    0x0F00    // Fits the 4K ROM of the smallest core
+
+int lockstep_random_rom(system_8051_t *sys, uint64_t seed);
+
+#endif
@@ -1,161 +1,447 @@
-// Intel Hex format reader
+// Command line front end: interactive prompt and headless runs
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <getopt.h>
 #include "system.h"
+#include "pacing.h"
+#include "hostio.h"
+#include "gdbstub.h"
+#include "report.h"
+#include "cfg.h"
+#include "aot.h"
+#include "prof.h"
+#include "bench.h"
+#include "hexfile.h"
+#include "cosim.h"
+#include "cover.h"
+#include "sym.h"
+#include "journal.h"
+#include "savestate.h"
+#include "lockstep.h"
+
+static void report_stop(system_8051_t *sys, run_result_t result) {
+    if (result == RUN_HALT && (sys->sfr.PCON & PCON_SLEEP)) printf("Program Halted in %s mode with nothing to wake it.\n", (sys->sfr.PCON & PCON_PD) ? "power-down" : "idle");
+    else if (result == RUN_HALT) printf("Program Halted normally (SJMP $ detected).\n");
+    else if (result == RUN_BREAKPOINT) {
+        char name[64];
+        sym_format(sys->syms, SYM_CODE, sys->cpu.PC, name, sizeof(name));
+        if (sys->syms) printf("Breakpoint at 0x%04X (%s).\n", sys->cpu.PC, name);
+        else printf("Breakpoint at 0x%04X.\n", sys->cpu.PC);
+    }
+    else if (result == RUN_WATCHPOINT) debug_print_hit(sys);
+}
 
-int load_hex(system_8051_t *sys, const char *filename) {
-    FILE *file = fopen(filename, "r");
-    if(file == NULL) {
-        printf("Could not open file %s\n", filename);
-        return 1;
+// HEADLESS RUNS
+typedef struct {
+    uint64_t max_cycles;        // 0 = no limit
+    uint64_t max_insns;         // 0 = no limit
+    int until_pc;               // -1 = none
+    int stop_on_halt;
+    uint64_t report_every;      // Periodic record every N clocks (0 = final only)
+} headless_config_t;
+
+static const char *stop_event(run_result_t result) {
+    switch (result) {
+        case RUN_HALT: return "halt";
+        case RUN_BREAKPOINT: return "pc";
+        case RUN_WATCHPOINT: return "watchpoint";
+        default: return "limit";
     }
+}
 
-    char line[1024];
-    int line_num = 0;
-    while(fgets(line, sizeof(line), file)) {
-        line_num++;
+// Exit status: 0 when the run ended on its own stop condition (or only
+// limits were given), 2 when a limit cut it short
+static int run_headless(system_8051_t *sys, const headless_config_t *cfg, report_t *rep) {
+    uint64_t insn_end = sys->cpu.instructions + cfg->max_insns;
+    uint64_t cycle_stop = cfg->max_cycles ? sys->cpu.cycles + cfg->max_cycles : RUN_NO_LIMIT;
+    uint64_t next_report = cfg->report_every ? sys->cpu.cycles + cfg->report_every : RUN_NO_LIMIT;
+    run_result_t result = RUN_LIMIT;
 
-        if(line[0] != ':') {
-            if(line[0] == '\n' || line[0] == '\r' || line[0] == '\0') continue;
-            else {
-                printf("Invalid hex line %d\n", line_num);
-                return 1;
-            }
-        }
+    if (cfg->until_pc >= 0) debug_set_breakpoint(sys, cfg->until_pc);
 
-        int byte_count, address, record_type;
-        if(sscanf(line + 1, "%02X%04X%02X", &byte_count, &address, &record_type) != 3) {
-            printf("Cannot parse header of line %d\n", line_num);
-            fclose(file);
-            return 1;
-        }
+    while (1) {
+        if (cfg->max_insns && sys->cpu.instructions >= insn_end) break;
+        if (sys->cpu.cycles >= cycle_stop) break;
 
-        if(record_type == 0x00) {
-            char *ptr = line + 9;   
+        uint64_t insn_left = cfg->max_insns ? insn_end - sys->cpu.instructions : RUN_NO_LIMIT;
+        uint64_t cycle_end = next_report < cycle_stop ? next_report : cycle_stop;
 
-            for(int i = 0; i < byte_count; ++i) {
-                int data_byte;
-                if(sscanf(ptr, "%02X", &data_byte) != 1) {
-                    printf("Cannot parse data byte of line %d\n", line_num);
-                    fclose(file);
-                    return 1;
-                }
+        // With a diff stream, one instruction per call so that each gets its record
+        if (sys->journal) journal_begin(sys);
+        result = system_run(sys, sys->journal ? 1 : insn_left, cycle_end);
 
-                if(address + i < INT_ROM_SIZE) {
-                    sys->irom[address + i] = data_byte;
-                }
-                else {
-                    sys->xrom[address + i] = data_byte;
-                }
+        // A core asleep for good has nothing left to run
+        if (result == RUN_HALT && !cfg->stop_on_halt && !(sys->sfr.PCON & PCON_SLEEP)) {
+            // Keep spinning on SJMP $: timers and interrupts still run
+            system_step(sys);
+            result = RUN_LIMIT;
+        }
+        if (sys->journal) journal_end(sys);
+        if (result != RUN_LIMIT) break;
 
-                ptr += 2;
-            }
+        if (sys->cpu.cycles >= next_report) {
+            report_state(rep, sys, "periodic");
+            while (next_report <= sys->cpu.cycles) next_report += cfg->report_every;
         }
-        else if(record_type == 0x01) { //EOF record
+
+        // system_run() steps over a breakpoint on its starting PC
+        if (cfg->until_pc >= 0 && sys->cpu.PC == cfg->until_pc) {
+            result = RUN_BREAKPOINT;
             break;
         }
     }
 
-    fclose(file);
-    printf("File loaded\n");
+    report_state(rep, sys, stop_event(result));
+    if (result == RUN_LIMIT && (cfg->stop_on_halt || cfg->until_pc >= 0)) return 2;
     return 0;
 }
 
-
-void print_state(system_8051_t *sys) {
-    // 1. Decode PSW (Flags)
-    char psw_str[9] = "--------";
-    if (sys->cpu.PSW & 0x80) psw_str[0] = 'C'; // Carry
-    if (sys->cpu.PSW & 0x40) psw_str[1] = 'A'; // Aux Carry
-    if (sys->cpu.PSW & 0x20) psw_str[2] = 'F'; // Flag 0
-    if (sys->cpu.PSW & 0x04) psw_str[5] = 'V'; // Overflow
-    if (sys->cpu.PSW & 0x01) psw_str[7] = 'P'; // Parity
-
-    //Decode Register Bank (R0-R7)
-    uint8_t bank_num = (sys->cpu.PSW & 0x18) >> 3;
-    uint8_t bank_addr = bank_num * 8;
-    
-    //Decode Timers (Logic Updated for Mode 3)
-    uint8_t t0_mode = sys->sfr.TMOD & 0x03;
-    uint8_t t1_mode = (sys->sfr.TMOD >> 4) & 0x03;
-
-    char t0_val_str[20];
-    char t0_status_str[20];
-    char t1_val_str[20];
-    char t1_status_str[20];
-
-    // --- TIMER 0 HANDLING ---
-    if (t0_mode == 3) {
-        // Mode 3: Split Timer. TL0 uses TR0, TH0 uses TR1.
-        sprintf(t0_val_str, "TL:%02X TH:%02X", sys->sfr.TL0, sys->sfr.TH0);
-        sprintf(t0_status_str, "TR0:%d TR1:%d", 
-               (sys->sfr.TCON & 0x10) ? 1 : 0, 
-               (sys->sfr.TCON & 0x40) ? 1 : 0);
-    } 
-    else {
-        // Standard Modes (0, 1, 2)
-        uint16_t val = ((uint16_t)sys->sfr.TH0 << 8) | sys->sfr.TL0;
-        sprintf(t0_val_str, "0x%04X     ", val);
-        sprintf(t0_status_str, "%s       ", (sys->sfr.TCON & 0x10) ? "RUN" : "STP");
-    }
-
-    uint16_t t1_val = ((uint16_t)sys->sfr.TH1 << 8) | sys->sfr.TL1;
-    sprintf(t1_val_str, "0x%04X     ", t1_val);
-    
-    if (t0_mode == 3) {
-        sprintf(t1_status_str, "No Int(Baud)"); 
-    } else {
-        sprintf(t1_status_str, "%s       ", (sys->sfr.TCON & 0x40) ? "RUN" : "STP");
-    }
-
-
-    printf("\n");
-    printf("====================================================================\n");
-    printf(" SYSTEM TIME: %-10lu CYCLES  |  PC: 0x%04X  |  OPCODE: 0x%02X\n", 
-           sys->cpu.cycles, sys->cpu.PC, system_read_code(sys, sys->cpu.PC));
-    printf("====================================================================\n");
-
-    // --- TABLE 1: CPU CORE & REGISTERS (Removed Raw PSW Row) ---
-    printf("| CORE REGISTERS      | FLAGS: %s | ACTIVE BANK: %d (0x%02X)  |\n", psw_str, bank_num, bank_addr);
-    printf("|---------------------+------------------+-----------------------|\n");
-    printf("| A    : 0x%02X         | R0 : 0x%02X        | R4 : 0x%02X             |\n", sys->cpu.A, sys->iram[bank_addr+0], sys->iram[bank_addr+4]);
-    printf("| B    : 0x%02X         | R1 : 0x%02X        | R5 : 0x%02X             |\n", sys->cpu.B, sys->iram[bank_addr+1], sys->iram[bank_addr+5]);
-    printf("| SP   : 0x%02X         | R2 : 0x%02X        | R6 : 0x%02X             |\n", sys->cpu.SP, sys->iram[bank_addr+2], sys->iram[bank_addr+6]);
-    printf("| DPTR : 0x%04X       | R3 : 0x%02X        | R7 : 0x%02X             |\n", sys->cpu.DPTR, sys->iram[bank_addr+3], sys->iram[bank_addr+7]);
-    printf("|---------------------+------------------+-----------------------|\n");
-
-    // --- TABLE 2: TIMERS & INTERRUPTS (Dynamic Strings) ---
-    printf("\n| TIMERS & INTERRUPTS | TCON: 0x%02X       | TMOD: 0x%02X            |\n", sys->sfr.TCON, sys->sfr.TMOD);
-    printf("|---------------------+------------------+-----------------------|\n");
-    printf("| TIMER 0: %s|STATUS: %s| MODE: %d               |\n", t0_val_str, t0_status_str, t0_mode);
-    printf("| TIMER 1: %s|STATUS: %s| MODE: %d               |\n", t1_val_str, t1_status_str, t1_mode);
-    printf("| IE     : 0x%02X       | IP    : 0x%02X     |                       |\n", sys->sfr.IE, sys->sfr.IP);
-    printf("|---------------------+------------------+-----------------------|\n");
-
-    // --- TABLE 3: PORTS ---
-    printf("\n| I/O PORTS           |                                          |\n");
-    printf("|---------------------+------------------+-----------------------|\n");
-    printf("| P0: 0x%02X            | P1: 0x%02X         | P2: 0x%02X   | P3: 0x%02X |\n", 
-           sys->sfr.P0, sys->sfr.P1, sys->sfr.P2, sys->sfr.P3);
-    printf("====================================================================\n");
+static void usage(const char *prog) {
+    printf("Usage: %s [options] <filename.hex>\n", prog);
+    printf("       %s [options] --random-rom SEED\n", prog);
+    printf("  -c, --cpu NAME      core variant: 8051 (default), 8052, 8052x2 or 1t\n");
+    printf("  -f, --crystal HZ    oscillator frequency for paced runs (default 11059200)\n");
+    printf("  -w, --warp X        run paced mode X times faster than real time\n");
+    printf("  -B, --batch N       clocks per pacing batch (default ~1 ms)\n");
+    printf("      --uart-tx PATH  send serial output to a file or FIFO ('-' = stdout)\n");
+    printf("      --uart-rx PATH  feed serial input from a file or FIFO\n");
+    printf("      --uart-pty      bind the serial port to a new pseudo terminal\n");
+    printf("      --port-shm NAME stream port latch edges to shared memory /dev/shm/NAME\n");
+    printf("      --port-shm-size N  ring capacity in events (default 1M)\n");
+    printf("      --port-shm-lossless  wait for the consumer instead of dropping events\n");
+    printf("      --gdb ENDPOINT  serve a gdb remote session on PORT, HOST:PORT or unix:PATH\n");
+    printf("Headless runs (no prompt; any of these enables it):\n");
+    printf("      --headless      run without the interactive prompt\n");
+    printf("      --max-cycles N  stop after N clocks\n");
+    printf("      --max-insns N   stop after N instructions\n");
+    printf("      --until-pc ADDR stop when PC reaches ADDR (exit status 2 if a limit hits first)\n");
+    printf("      --stop-on-halt  stop on SJMP $ (exit status 2 if a limit hits first)\n");
+    printf("      --report-every N  also write the state every N clocks\n");
+    printf("      --format json|csv  state record format (default json)\n");
+    printf("      --output PATH   write state records to PATH (default stdout)\n");
+    printf("      --diff PATH     write what every instruction changed to PATH ('-' = stdout)\n");
+    printf("      --diff-format text|binary  diff record format (default text)\n");
+    printf("      --save-state PATH  save the machine state to PATH when the run stops\n");
+    printf("      --dump-cfg      print the functions, basic blocks and data regions, then exit\n");
+    printf("      --aot-emit PATH translate the ROM to C for a shared object, then exit\n");
+    printf("      --aot PATH      run the translated blocks in a shared object built from --aot-emit\n");
+    printf("      --profile PATH  write a collapsed-stack profile at exit ('%%p' = process id)\n");
+    printf("      --profile-hz N  profiler samples per second of host CPU time (default %d)\n", PROF_DEFAULT_HZ);
+    printf("      --bench N       run N instructions and report host counters per instruction class\n");
+    printf("      --bench-batch N instructions per counter reading (default %d)\n", BENCH_DEFAULT_BATCH);
+    printf("      --cosim FILE    run the nodes and links of a topology file instead (needs --max-cycles)\n");
+    printf("      --cover PATH    record executed code and branch outcomes, merged into PATH at exit\n");
+    printf("      --cover-lcov OUT  summarise the coverage in --cover PATH and write an lcov tracefile, then exit\n");
+    printf("      --cover-rst FILE  SDCC listing mapping addresses to source lines for --cover-lcov (repeatable)\n");
+    printf("      --symbols FILE  name addresses from an SDCC .map/.noi/.cdb or OMF-51 file (repeatable)\n");
+    printf("      --load-state PATH  start from a state saved with --save-state or 'v' on the same image\n");
+    printf("      --random-rom SEED  run a random stream of every valid opcode instead of a hex file\n");
+    printf("      --lockstep ENGINE  compare run, cover or aot (with --aot) against the stepped interpreter\n");
+    printf("                      for --max-insns instructions, then exit (status 1 on a divergence)\n");
+    printf("      --lockstep-every N  compare after every N instructions (default 1)\n");
 }
 
-
-
 int main(int argc, char *argv[]) {
     system_8051_t sys;
     system_reset(&sys);
 
-    if (argc < 2) {
-        printf("Usage: %s <filename.hex>\n", argv[0]);
+    pacing_config_t pacing;
+    pacing_config_default(&pacing);
+
+    const char *uart_tx = NULL;
+    const char *uart_rx = NULL;
+    int uart_pty = 0;
+    const char *port_shm = NULL;
+    uint32_t port_shm_size = PORTLOG_DEFAULT_CAPACITY;
+    int port_shm_lossless = 0;
+    const char *gdb_endpoint = NULL;
+
+    int headless = 0;
+    headless_config_t run_cfg = { 0, 0, -1, 0, 0 };
+    const char *report_format = NULL;
+    const char *report_path = NULL;
+    const char *diff_path = NULL;
+    const char *diff_format = NULL;
+    const char *save_state_path = NULL;
+    const char *load_state_path = NULL;
+    int lockstep_engine = -1;
+    uint64_t lockstep_every = 1;
+    int random_rom = 0;
+    uint64_t random_seed = 0;
+    int dump_cfg = 0;
+    const char *aot_emit_path = NULL;
+    const char *aot_path = NULL;
+    const char *profile_path = NULL;
+    unsigned profile_hz = PROF_DEFAULT_HZ;
+    uint64_t bench_insns = 0;
+    uint64_t bench_batch = BENCH_DEFAULT_BATCH;
+    const char *cosim_path = NULL;
+    const char *cover_path = NULL;
+    const char *cover_lcov_path = NULL;
+    const char *cover_rst[COVER_MAX_RST];
+    int cover_rst_count = 0;
+
+    static const struct option long_opts[] = {
+        {"cpu",     required_argument, 0, 'c'},
+        {"crystal", required_argument, 0, 'f'},
+        {"warp",    required_argument, 0, 'w'},
+        {"batch",   required_argument, 0, 'B'},
+        {"uart-tx", required_argument, 0, 1},
+        {"uart-rx", required_argument, 0, 2},
+        {"uart-pty", no_argument,      0, 3},
+        {"port-shm", required_argument, 0, 4},
+        {"port-shm-size", required_argument, 0, 5},
+        {"port-shm-lossless", no_argument, 0, 6},
+        {"gdb",     required_argument, 0, 7},
+        {"headless", no_argument,      0, 8},
+        {"max-cycles", required_argument, 0, 9},
+        {"max-insns", required_argument, 0, 10},
+        {"until-pc", required_argument, 0, 11},
+        {"stop-on-halt", no_argument,  0, 12},
+        {"report-every", required_argument, 0, 13},
+        {"format",  required_argument, 0, 14},
+        {"output",  required_argument, 0, 15},
+        {"dump-cfg", no_argument,      0, 16},
+        {"aot-emit", required_argument, 0, 17},
+        {"aot",     required_argument, 0, 18},
+        {"profile", required_argument, 0, 19},
+        {"profile-hz", required_argument, 0, 20},
+        {"bench",   required_argument, 0, 21},
+        {"bench-batch", required_argument, 0, 22},
+        {"cosim",   required_argument, 0, 23},
+        {"cover",   required_argument, 0, 24},
+        {"cover-lcov", required_argument, 0, 25},
+        {"cover-rst", required_argument, 0, 26},
+        {"symbols", required_argument, 0, 27},
+        {"diff",    required_argument, 0, 28},
+        {"diff-format", required_argument, 0, 29},
+        {"save-state", required_argument, 0, 30},
+        {"load-state", required_argument, 0, 31},
+        {"lockstep", required_argument, 0, 32},
+        {"lockstep-every", required_argument, 0, 33},
+        {"random-rom", required_argument, 0, 34},
+        {"help",    no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "c:f:w:B:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 'c': {
+                const cpu_variant_t *variant = cpu_variant_find(optarg);
+                if (variant == NULL) {
+                    printf("Unknown CPU variant %s\n", optarg);
+                    return 1;
+                }
+                system_set_variant(&sys, variant);
+                break;
+            }
+            case 'f': pacing.crystal_hz = strtod(optarg, NULL); break;
+            case 'w': pacing.warp = strtod(optarg, NULL); break;
+            case 'B': pacing.batch_cycles = strtoull(optarg, NULL, 0); break;
+            case 1: uart_tx = optarg; break;
+            case 2: uart_rx = optarg; break;
+            case 3: uart_pty = 1; break;
+            case 4: port_shm = optarg; break;
+            case 5: port_shm_size = strtoul(optarg, NULL, 0); break;
+            case 6: port_shm_lossless = 1; break;
+            case 7: gdb_endpoint = optarg; break;
+            case 8: headless = 1; break;
+            case 9: run_cfg.max_cycles = strtoull(optarg, NULL, 0); headless = 1; break;
+            case 10: run_cfg.max_insns = strtoull(optarg, NULL, 0); headless = 1; break;
+            case 11: run_cfg.until_pc = strtol(optarg, NULL, 16) & 0xFFFF; headless = 1; break;
+            case 12: run_cfg.stop_on_halt = 1; headless = 1; break;
+            case 13: run_cfg.report_every = strtoull(optarg, NULL, 0); headless = 1; break;
+            case 14: report_format = optarg; headless = 1; break;
+            case 15: report_path = optarg; headless = 1; break;
+            case 16: dump_cfg = 1; break;
+            case 17: aot_emit_path = optarg; break;
+            case 18: aot_path = optarg; break;
+            case 19: profile_path = optarg; break;
+            case 20: profile_hz = strtoul(optarg, NULL, 0); break;
+            case 21: bench_insns = strtoull(optarg, NULL, 0); break;
+            case 22: bench_batch = strtoull(optarg, NULL, 0); break;
+            case 23: cosim_path = optarg; break;
+            case 24: cover_path = optarg; break;
+            case 25: cover_lcov_path = optarg; break;
+            case 26:
+                if (cover_rst_count == COVER_MAX_RST) {
+                    printf("At most %d --cover-rst listings\n", COVER_MAX_RST);
+                    return 1;
+                }
+                cover_rst[cover_rst_count++] = optarg;
+                break;
+            case 27:
+                if (sys.syms == NULL) sys.syms = sym_create();
+                if (sys.syms == NULL || sym_load(sys.syms, optarg)) return 1;
+                break;
+            case 28: diff_path = optarg; headless = 1; break;
+            case 29: diff_format = optarg; headless = 1; break;
+            case 30: save_state_path = optarg; headless = 1; break;
+            case 31: load_state_path = optarg; break;
+            case 32:
+                lockstep_engine = lockstep_engine_find(optarg);
+                if (lockstep_engine < 0) {
+                    printf("Unknown lockstep engine %s (use run, cover or aot)\n", optarg);
+                    return 1;
+                }
+                break;
+            case 33: lockstep_every = strtoull(optarg, NULL, 0); break;
+            case 34: random_seed = strtoull(optarg, NULL, 0); random_rom = 1; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (cosim_path) {
+        if (!run_cfg.max_cycles) {
+            printf("Co-simulation needs --max-cycles\n");
+            return 1;
+        }
+        cosim_t *sim = cosim_load(cosim_path);
+        if (sim == NULL) return 1;
+        int status = cosim_run(sim, run_cfg.max_cycles);
+        if (status == 0) cosim_print(sim);
+        cosim_free(sim);
+        return status;
+    }
+
+    if ((optind >= argc) != random_rom) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *image = random_rom ? "random code" : argv[optind];
+
+    if (pacing.crystal_hz <= 0 || pacing.warp <= 0) {
+        printf("Crystal frequency and warp factor must be positive\n");
+        return 1;
+    }
+
+    if (headless && !run_cfg.max_cycles && !run_cfg.max_insns && run_cfg.until_pc < 0 && !run_cfg.stop_on_halt) {
+        printf("Headless runs need --max-cycles, --max-insns, --until-pc or --stop-on-halt\n");
+        return 1;
+    }
+
+    if (lockstep_engine >= 0 && !run_cfg.max_insns) {
+        printf("--lockstep needs --max-insns\n");
         return 1;
     }
 
-    if(load_hex(&sys, argv[1])) return 1;
+    if (cover_lcov_path && !cover_path) {
+        printf("--cover-lcov needs --cover\n");
+        return 1;
+    }
+
+    report_t report;
+    if (headless && report_open(&report, report_path, report_format)) return 1;
+    journal_t journal;
+    if (diff_path || diff_format) {
+        if (journal_open(&journal, diff_path, diff_format)) return 1;
+        sys.journal = &journal;
+    }
+
+    if (random_rom) {
+        int opcodes = lockstep_random_rom(&sys, random_seed);
+        if (!headless && !dump_cfg && !aot_emit_path && !bench_insns && !cover_lcov_path) printf("Random code from seed %llu (%d opcodes)\n", (unsigned long long)random_seed, opcodes);
+    }
+    else {
+        if(load_hex(&sys, argv[optind])) return 1;
+        if (!headless && !dump_cfg && !aot_emit_path && !bench_insns && !cover_lcov_path) printf("File loaded\n");
+    }
+    if (load_state_path && savestate_load(&sys, load_state_path)) return 1;
+
+    if (dump_cfg) {
+        cfg_t *cfg = cfg_build(&sys);
+        if (cfg == NULL) return 1;
+        cfg_dump(cfg, &sys, stdout);
+        cfg_free(cfg);
+        return 0;
+    }
+
+    if (aot_emit_path) return aot_emit(&sys, aot_emit_path, image);
+    if (cover_lcov_path) {
+        coverage_t *cov = malloc(sizeof(coverage_t));
+        uint64_t runs;
+        int err = cov == NULL || cover_load(&sys, cov, cover_path, &runs);
+        if (!err) {
+            cover_print(&sys, cov, runs);
+            err = cover_lcov(&sys, cov, cover_rst, cover_rst_count, cover_lcov_path);
+        }
+        free(cov);
+        return err;
+    }
+    if (bench_insns) {
+        bench_result_t result;
+        bench_run(&sys, bench_insns, bench_batch, &result);
+        bench_print(&result);
+        return 0;
+    }
+    if (aot_path) {
+        sys.aot = aot_load(&sys, aot_path);
+        if (sys.aot == NULL) return 1;
+    }
+    if (lockstep_engine >= 0) {
+        int status = lockstep_run(&sys, lockstep_engine, run_cfg.max_insns, lockstep_every);
+        aot_close(sys.aot);
+        return status;
+    }
+
+    hostio_t *uart_io = NULL;
+    if (uart_tx || uart_rx || uart_pty) {
+        uart_io = hostio_open(uart_tx, uart_rx, uart_pty);
+        if (uart_io == NULL) return 1;
+        uart_bind(&sys, hostio_txq(uart_io), hostio_rxq(uart_io));
+        if (hostio_pty_name(uart_io)) printf("Serial port on %s\n", hostio_pty_name(uart_io));
+    }
+
+    if (port_shm) {
+        sys.portlog = portlog_open(port_shm, port_shm_size, port_shm_lossless);
+        if (sys.portlog == NULL) return 1;
+    }
+
+    if (cover_path) {
+        sys.cover = calloc(1, sizeof(coverage_t));
+        if (sys.cover == NULL) return 1;
+    }
+
+    profiler_t *prof = NULL;
+    if (profile_path) {
+        prof = prof_start(&sys, profile_path, profile_hz);
+        if (prof == NULL) return 1;
+    }
 
-    printf("Use 's', 'r' or 'q', where:\n");
-    printf("'r' is to directly view state after max ~20000000 instructions\n's' for stepwise status\n'q' for exiting emulator");
+    if (headless) {
+        int status = run_headless(&sys, &run_cfg, &report);
+#ifdef EMU_SANITIZE
+        sanitize_print_stats(&sys);
+        if (status == 0 && sanitize_findings(&sys)) status = 3;
+#endif
+        prof_stop(prof);
+        if (cover_path && cover_merge(&sys, sys.cover, cover_path) && status == 0) status = 1;
+        if (save_state_path && savestate_save(&sys, save_state_path) && status == 0) status = 1;
+        if (sys.journal) journal_close(sys.journal);
+        report_close(&report);
+        hostio_close(uart_io);
+        portlog_close(sys.portlog);
+        aot_close(sys.aot);
+        return status;
+    }
+
+    if (gdb_endpoint) {
+        int err = gdbstub_serve(&sys, gdb_endpoint);
+        prof_stop(prof);
+        if (cover_path && cover_merge(&sys, sys.cover, cover_path)) err = 1;
+        hostio_close(uart_io);
+        portlog_close(sys.portlog);
+        aot_close(sys.aot);
+        return err;
+    }
+
+    printf("Use 's', 't', 'r', 'p', 'i', 'a', 'b', 'w', 'd', 'v' or 'q', where:\n");
+    printf("'r' is to directly view state after max ~20000000 instructions\n's' for stepwise status\n't [n]' steps n instructions, printing only what each changed\n'p' for a run paced to the crystal (Ctrl-C stops)\n'i' for interrupt latency and ISR time statistics\n'a' for the static control-flow graph of the loaded code\n");
+    printf("'b <addr>' toggles a breakpoint\n'w <i|s|x> <addr> [r|w|rw]' watches an IRAM, SFR or XRAM byte\n'd' deletes all breakpoints and watchpoints\n'v <path>' saves the machine state for --load-state\n'q' for exiting emulator");
     char input_buffer[100];
 
     while(1) {
@@ -171,39 +457,86 @@ int main(int argc, char *argv[]) {
             break;
         }
         else if(cmd == 's' || cmd == '\n') {
-            uint64_t prev_cycles = sys.cpu.cycles;
-            cpu_step(&sys);
-            int step_cycles = (int)(sys.cpu.cycles - prev_cycles);
-            peripherals_step(&sys, step_cycles);
+            system_step(&sys);
             print_state(&sys);
         }
+        else if(cmd == 't') {
+            unsigned long count = strtoul(input_buffer + 1, NULL, 0);
+            journal_t steps;
+            journal_open(&steps, NULL, NULL);
+            sys.journal = &steps;
+            for (unsigned long i = 0; i < (count ? count : 1); i++) {
+                journal_begin(&sys);
+                system_step(&sys);
+                journal_end(&sys);
+            }
+            sys.journal = NULL;
+            journal_close(&steps);
+        }
         else if(cmd == 'r') {
-            int instructions_executed = 0;
-            int batch_limit = 20000000;
-            int halted = 0;
-
-            while(instructions_executed < batch_limit) {
-                uint8_t op = system_read_code(&sys, sys.cpu.PC);
-                uint8_t arg = system_read_code(&sys, sys.cpu.PC+1);
-    
-                if (op == 0x80 && arg == 0xFE) {
-                    halted = 1;
-                    break;
-                }
-                uint64_t prev_cycles = sys.cpu.cycles;
-                cpu_step(&sys);
-                int step_cycles = (int)(sys.cpu.cycles - prev_cycles);
-                peripherals_step(&sys, step_cycles);
-                instructions_executed++;
+            run_result_t result = system_run(&sys, 20000000, RUN_NO_LIMIT);
+            if (result == RUN_LIMIT) printf("Execution Paused (Batch limit reached).\n");
+            else report_stop(&sys, result);
+
+            print_state(&sys);
+        }
+        else if(cmd == 'p') {
+            pacing_stats_t stats;
+            run_result_t result = pacing_run(&sys, &pacing, &stats);
+            if (result == RUN_LIMIT) printf("Paced run stopped.\n");
+            else report_stop(&sys, result);
+            pacing_print_stats(&pacing, &stats);
+            print_state(&sys);
+        }
+        else if(cmd == 'b') {
+            unsigned int addr;
+            if (sscanf(input_buffer + 1, "%x", &addr) != 1 || addr > 0xFFFF) {
+                printf("Usage: b <hex code address>");
             }
-            if (halted) {
-                printf("Program Halted normally (SJMP $ detected).\n");
+            else if (debug_is_breakpoint(&sys.dbg, addr)) {
+                debug_clear_breakpoint(&sys, addr);
+                printf("Breakpoint at 0x%04X removed", addr);
             }
             else {
-                printf("Execution Paused (Batch limit reached).\n");
+                debug_set_breakpoint(&sys, addr);
+                printf("Breakpoint at 0x%04X set", addr);
+            }
+        }
+        else if(cmd == 'w') {
+            char space_ch;
+            unsigned int addr;
+            char type_str[4] = "w";
+            int n = sscanf(input_buffer + 1, " %c %x %3s", &space_ch, &addr, type_str);
+            uint8_t space = space_ch == 'i' ? SPACE_IRAM : space_ch == 's' ? SPACE_SFR : space_ch == 'x' ? SPACE_XRAM : 0;
+            uint8_t type = 0;
+            if (strchr(type_str, 'r')) type |= WATCH_READ;
+            if (strchr(type_str, 'w')) type |= WATCH_WRITE;
+
+            if (n < 2 || space == 0 || type == 0) {
+                printf("Usage: w <i|s|x> <hex address> [r|w|rw]");
+            }
+            else if (debug_add_watch(&sys, space, addr, 1, type) == 0) {
+                printf("Watchpoint set");
+            }
+        }
+        else if(cmd == 'd') {
+            debug_clear_all(&sys);
+            printf("All breakpoints and watchpoints deleted");
+        }
+        else if(cmd == 'v') {
+            char path[96];
+            if (sscanf(input_buffer + 1, " %95s", path) != 1) printf("Usage: v <path>");
+            else if (savestate_save(&sys, path) == 0) printf("State saved to %s", path);
+        }
+        else if(cmd == 'i') {
+            interrupt_print_stats(&sys);
+        }
+        else if(cmd == 'a') {
+            cfg_t *cfg = cfg_build(&sys);
+            if (cfg) {
+                cfg_dump(cfg, &sys, stdout);
+                cfg_free(cfg);
             }
-
-            print_state(&sys);
         }
         else {
             printf("Unknown command.");
@@ -211,5 +544,11 @@ int main(int argc, char *argv[]) {
 
     }
 
+    SANITIZE(sanitize_print_stats(&sys));
+    prof_stop(prof);
+    if (cover_path) cover_merge(&sys, sys.cover, cover_path);
+    hostio_close(uart_io);
+    portlog_close(sys.portlog);
+    aot_close(sys.aot);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,241 @@
+// Build-time check: runs every instruction handler once per operand pattern
+// and compares length, control flow and cycles with opcodes.def, checks the
+// classic core's cycle column against the datasheet rules below, then tests
+// the accumulator arithmetic over all operands against the reference
+// formulas in alu_ref.h: the lookups in alu.h on their own, then the
+// interpreter.
+#include <stdio.h>
+#include "system.h"
+#include "opcodes.h"
+#include "alu.h"
+#include "alu_ref.h"
+
+#define ORIGIN 0x0100
+
+static const uint8_t operand_sets[][2] = {
+    { 0x30, 0x05 },     // RAM operands, forward branch
+    { 0x31, 0xF0 },     // backward branch
+};
+
+static int check(const cpu_variant_t *variant, uint8_t opcode, const uint8_t *operands) {
+    const opcode_info_t *info = &opcode_table[opcode];
+    static system_8051_t sys;
+    system_reset(&sys);
+    system_set_variant(&sys, variant);
+
+    uint8_t code[3] = { opcode, operands[0], operands[1] };
+    for (int i = 0; i < 3; i++) system_write_code(&sys, ORIGIN + i, code[i]);
+
+    // Enough state for returns and pointers to land somewhere known
+    sys.cpu.PC = ORIGIN;
+    sys.cpu.A = 0x5A;
+    sys.cpu.DPTR = 0x2000;
+    sys.cpu.SP = 0x40;
+    sys.iram[0x40] = 0x12;
+    sys.iram[0x3F] = 0x34;
+    sys.iram[0] = 0x30;
+    sys.iram[1] = 0x31;
+
+    variant->step(&sys);
+
+    uint16_t next = ORIGIN + info->length;
+    uint16_t target = 0;
+    int has_target = opcode_target(code, ORIGIN, &target);
+    int taken = 0;
+    int ok;
+
+    if (info->flags & OPF_RETURN) ok = sys.cpu.PC == 0x1234;
+    else if (info->flags & OPF_INDIRECT_JUMP) ok = sys.cpu.PC == (uint16_t)(0x2000 + 0x5A);
+    else if (info->flags & OPF_BRANCH) {
+        taken = sys.cpu.PC != next;
+        ok = has_target && (!taken || sys.cpu.PC == target);
+    }
+    else if (info->flags & (OPF_JUMP | OPF_CALL)) ok = has_target && sys.cpu.PC == target;
+    else ok = sys.cpu.PC == next;
+
+    if (!ok) {
+        printf("opcheck: %s 0x%02X (%s): PC 0x%04X after a %d-byte instruction\n",
+               variant->name, opcode, info->mnemonic, sys.cpu.PC, info->length);
+        return 1;
+    }
+
+    if ((info->flags & OPF_CALL) && !(sys.cpu.SP == 0x42 && sys.iram[0x41] == (next & 0xFF) && sys.iram[0x42] == next >> 8)) {
+        printf("opcheck: %s 0x%02X (%s): bad return address on the stack\n", variant->name, opcode, info->mnemonic);
+        return 1;
+    }
+
+    // The handler charges what the variant's table says
+    uint64_t expected = (uint64_t)variant->cycles[opcode] * variant->cycle_clocks;
+    if (taken) expected += variant->taken_extra * variant->cycle_clocks;
+    if (sys.cpu.cycles != expected) {
+        printf("opcheck: %s 0x%02X (%s): %lu clocks, table says %lu\n",
+               variant->name, opcode, info->mnemonic, sys.cpu.cycles, expected);
+        return 1;
+    }
+    return 0;
+}
+
+// Machine cycles on the classic core, from the MCS-51 instruction set
+// summary rather than from opcodes.def: MUL and DIV take four, the
+// instructions listed here two, and everything else one
+static int datasheet_cycles(uint8_t op) {
+    if (op == 0xA4 || op == 0x84) return 4;                 // MUL AB, DIV AB
+    if ((op & 0x1F) == 0x01 || (op & 0x1F) == 0x11) return 2;   // AJMP, ACALL
+    if ((op & 0xF8) == 0x88 || (op & 0xF8) == 0xA8) return 2;   // MOV direct, Rn / MOV Rn, direct
+    if ((op & 0xF8) == 0xB8 || (op & 0xF8) == 0xD8) return 2;   // CJNE Rn, DJNZ Rn
+    switch (op) {
+        case 0x02: case 0x12: case 0x22: case 0x32:         // LJMP, LCALL, RET, RETI
+        case 0x80: case 0x73:                               // SJMP, JMP @A+DPTR
+        case 0x10: case 0x20: case 0x30: case 0x40:         // JBC, JB, JNB, JC
+        case 0x50: case 0x60: case 0x70:                    // JNC, JZ, JNZ
+        case 0xB4: case 0xB5: case 0xB6: case 0xB7:         // CJNE A / @Ri
+        case 0xD5:                                          // DJNZ direct
+        case 0xE0: case 0xE2: case 0xE3:                    // MOVX A, ...
+        case 0xF0: case 0xF2: case 0xF3:                    // MOVX ..., A
+        case 0x83: case 0x93:                               // MOVC
+        case 0xA3: case 0x90:                               // INC DPTR, MOV DPTR, #data16
+        case 0x85: case 0x75: case 0x86: case 0x87:         // MOV direct, direct / #data / @Ri
+        case 0xA6: case 0xA7:                               // MOV @Ri, direct
+        case 0xC0: case 0xD0:                               // PUSH, POP
+        case 0x43: case 0x53: case 0x63:                    // ORL/ANL/XRL direct, #data
+        case 0x72: case 0xA0: case 0x82: case 0xB0:         // ORL/ANL C, bit and /bit
+        case 0x92:                                          // MOV bit, C
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+static int check_datasheet(void) {
+    int failures = 0;
+    for (int op = 0; op < 256; op++) {
+        const opcode_info_t *info = &opcode_table[op];
+        if (info->flags & OPF_INVALID) continue;
+        if (info->cycles != datasheet_cycles(op)) {
+            printf("opcheck: 0x%02X (%s): opcodes.def says %d machine cycles, the datasheet %d\n",
+                   op, info->mnemonic, info->cycles, datasheet_cycles(op));
+            failures++;
+        }
+    }
+    return failures;
+}
+
+// The alu.h lookups for every A, operand, carry and PSW
+static int check_alu_tables(void) {
+    for (int psw_in = 0; psw_in < 256; psw_in++) {
+        for (int a = 0; a < 256; a++) {
+            for (int v = 0; v < 256; v++) {
+                for (uint8_t carry = 0; carry < 2; carry++) {
+                    uint8_t got, want;
+                    uint8_t want_psw = psw_in;
+                    want = alu_ref_addc(a, v, carry, &want_psw);
+                    uint8_t psw = alu_addc_psw(a, v, carry, psw_in, &got);
+                    if (got != want || psw != want_psw) {
+                        printf("opcheck: alu_addc_psw(%02X, %02X, %d, PSW=%02X) gives A=%02X PSW=%02X, reference A=%02X PSW=%02X\n",
+                               a, v, carry, psw_in, got, psw, want, want_psw);
+                        return 1;
+                    }
+
+                    want_psw = psw_in;
+                    want = alu_ref_subb(a, v, carry, &want_psw);
+                    psw = alu_subb_psw(a, v, carry, psw_in, &got);
+                    if (got != want || psw != want_psw) {
+                        printf("opcheck: alu_subb_psw(%02X, %02X, %d, PSW=%02X) gives A=%02X PSW=%02X, reference A=%02X PSW=%02X\n",
+                               a, v, carry, psw_in, got, psw, want, want_psw);
+                        return 1;
+                    }
+                }
+            }
+
+            uint8_t got;
+            uint8_t want_psw = psw_in;
+            uint8_t want = alu_ref_da(a, &want_psw);
+            uint8_t psw = alu_da_psw(a, psw_in, &got);
+            if (got != want || psw != want_psw) {
+                printf("opcheck: alu_da_psw(%02X, PSW=%02X) gives A=%02X PSW=%02X, reference A=%02X PSW=%02X\n",
+                       a, psw_in, got, psw, want, want_psw);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// ADD, ADDC and SUBB immediate for every A, operand and carry, and DA A
+// for every A, CY and AC. The other PSW bits ride along to show that they
+// are left alone.
+static int check_alu(const cpu_variant_t *variant) {
+    static system_8051_t sys;
+    system_reset(&sys);
+    system_set_variant(&sys, variant);
+    const uint8_t psws[] = { 0x00, PSW_CY, PSW_AC | PSW_F0 | PSW_OV | PSW_P, 0xFF };
+    const uint8_t ops[] = { 0x24, 0x34, 0x94 };     // ADD, ADDC, SUBB A, #data
+
+    for (size_t o = 0; o < sizeof(ops); o++) {
+        system_write_code(&sys, ORIGIN, ops[o]);
+        for (size_t p = 0; p < sizeof(psws); p++) {
+            for (int a = 0; a < 256; a++) {
+                for (int v = 0; v < 256; v++) {
+                    system_write_code(&sys, ORIGIN + 1, v);
+                    sys.cpu.PC = ORIGIN;
+                    sys.cpu.A = a;
+                    sys.cpu.PSW = psws[p];
+                    variant->step(&sys);
+
+                    uint8_t carry = ops[o] == 0x24 ? 0 : (psws[p] & PSW_CY) != 0;
+                    uint8_t psw = psws[p];
+                    uint8_t want = ops[o] == 0x94 ? alu_ref_subb(a, v, carry, &psw) : alu_ref_addc(a, v, carry, &psw);
+                    if (sys.cpu.A != want || sys.cpu.PSW != psw) {
+                        printf("opcheck: %s 0x%02X (%s): A=%02X #%02X PSW=%02X gives A=%02X PSW=%02X, reference A=%02X PSW=%02X\n",
+                               variant->name, ops[o], opcode_table[ops[o]].mnemonic, a, v, psws[p], sys.cpu.A, sys.cpu.PSW, want, psw);
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+
+    system_write_code(&sys, ORIGIN, 0xD4);
+    for (size_t p = 0; p < sizeof(psws); p++) {
+        for (int a = 0; a < 256; a++) {
+            sys.cpu.PC = ORIGIN;
+            sys.cpu.A = a;
+            sys.cpu.PSW = psws[p];
+            variant->step(&sys);
+
+            uint8_t psw = psws[p];
+            uint8_t want = alu_ref_da(a, &psw);
+            if (sys.cpu.A != want || sys.cpu.PSW != psw) {
+                printf("opcheck: %s 0xD4 (DA): A=%02X PSW=%02X gives A=%02X PSW=%02X, reference A=%02X PSW=%02X\n",
+                       variant->name, a, psws[p], sys.cpu.A, sys.cpu.PSW, want, psw);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(void) {
+    const char *variants[] = { "8052", "1t" };
+    int failures = check_datasheet() + check_alu_tables();
+    int checked = 0;
+
+    for (int v = 0; v < 2; v++) {
+        const cpu_variant_t *variant = cpu_variant_find(variants[v]);
+        for (int op = 0; op < 256; op++) {
+            if (opcode_table[op].flags & OPF_INVALID) continue;
+            for (size_t s = 0; s < sizeof(operand_sets) / sizeof(operand_sets[0]); s++) {
+                failures += check(variant, op, operand_sets[s]);
+            }
+            checked++;
+        }
+        failures += check_alu(variant);
+    }
+
+    if (failures) {
+        printf("opcheck: %d checks failed\n", failures);
+        return 1;
+    }
+    printf("opcheck: %d opcode handlers match opcodes.def\n", checked / 2);
+    return 0;
+}
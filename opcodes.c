@@ -0,0 +1,103 @@
+// Opcode metadata table and disassembler, both generated from opcodes.def
+#include <stdio.h>
+#include "opcodes.h"
+
+const opcode_info_t opcode_table[256] = {
+#define OP(code, mn, len, cyc, cyc1t, a, b, c, fl) \
+    [code] = { mn, len, cyc, cyc1t, { OPK_##a, OPK_##b, OPK_##c }, fl },
+#include "opcodes.def"
+#undef OP
+};
+
+// Byte index of each operand's encoding (0 = none)
+static int operand_offset(uint8_t opcode, int n) {
+    const opcode_info_t *info = &opcode_table[opcode];
+    if (opcode == 0x85) return n == 0 ? 2 : 1; // MOV dst, src is encoded src, dst
+
+    int offset = 1;
+    for (int i = 0; i < n; i++) {
+        switch (info->operands[i]) {
+            case OPK_DIRECT: case OPK_IMM8: case OPK_BIT: case OPK_NBIT: case OPK_REL: case OPK_ADDR11:
+                offset += 1;
+                break;
+            case OPK_IMM16: case OPK_ADDR16:
+                offset += 2;
+                break;
+            default:
+                break;
+        }
+    }
+    return offset;
+}
+
+static uint16_t rel_target(uint16_t pc, int len, uint8_t rel) {
+    return (uint16_t)(pc + len + (int8_t)rel);
+}
+
+int opcode_target(const uint8_t *code, uint16_t pc, uint16_t *target) {
+    const opcode_info_t *info = &opcode_table[code[0]];
+    if (!(info->flags & (OPF_BRANCH | OPF_JUMP | OPF_CALL)) || (info->flags & OPF_INDIRECT_JUMP)) return 0;
+
+    for (int i = 0; i < 3; i++) {
+        const uint8_t *p = code + operand_offset(code[0], i);
+        switch (info->operands[i]) {
+            case OPK_REL:
+                *target = rel_target(pc, info->length, p[0]);
+                return 1;
+            case OPK_ADDR11:
+                *target = ((pc + info->length) & 0xF800) | ((code[0] & 0xE0) << 3) | p[0];
+                return 1;
+            case OPK_ADDR16:
+                *target = (uint16_t)(p[0] << 8 | p[1]);
+                return 1;
+            default:
+                break;
+        }
+    }
+    return 0;
+}
+
+static int format_operand(char *out, size_t size, const uint8_t *code, uint16_t pc, int n) {
+    uint8_t opcode = code[0];
+    const opcode_info_t *info = &opcode_table[opcode];
+    const uint8_t *p = code + operand_offset(opcode, n);
+
+    switch (info->operands[n]) {
+        case OPK_A: return snprintf(out, size, "A");
+        case OPK_AB: return snprintf(out, size, "AB");
+        case OPK_C: return snprintf(out, size, "C");
+        case OPK_DPTR: return snprintf(out, size, "DPTR");
+        case OPK_AT_DPTR: return snprintf(out, size, "@DPTR");
+        case OPK_AT_A_DPTR: return snprintf(out, size, "@A+DPTR");
+        case OPK_AT_A_PC: return snprintf(out, size, "@A+PC");
+        case OPK_RN: return snprintf(out, size, "R%d", opcode & 0x07);
+        case OPK_AT_RI: return snprintf(out, size, "@R%d", opcode & 0x01);
+        case OPK_DIRECT: return snprintf(out, size, "0x%02X", p[0]);
+        case OPK_IMM8: return snprintf(out, size, "#0x%02X", p[0]);
+        case OPK_IMM16: return snprintf(out, size, "#0x%04X", p[0] << 8 | p[1]);
+        case OPK_BIT: return snprintf(out, size, "0x%02X", p[0]);
+        case OPK_NBIT: return snprintf(out, size, "/0x%02X", p[0]);
+        case OPK_REL:
+        case OPK_ADDR11:
+        case OPK_ADDR16: {
+            uint16_t target = 0;
+            opcode_target(code, pc, &target);
+            return snprintf(out, size, "0x%04X", target);
+        }
+        default:
+            return 0;
+    }
+}
+
+int opcode_disasm(const uint8_t *code, uint16_t pc, char *out, size_t size) {
+    const opcode_info_t *info = &opcode_table[code[0]];
+    int pos = snprintf(out, size, "%s", info->mnemonic);
+
+    for (int i = 0; i < 3 && info->operands[i] != OPK_NONE; i++) {
+        if ((size_t)pos >= size) break;
+        pos += snprintf(out + pos, size - pos, i == 0 ? " " : ", ");
+        if ((size_t)pos >= size) break;
+        pos += format_operand(out + pos, size - pos, code, pc, i);
+    }
+    return info->length;
+}
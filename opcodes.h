@@ -0,0 +1,70 @@
+#ifndef OPCODES_H
+#define OPCODES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Operand kinds (see opcodes.def)
+typedef enum {
+    OPK_NONE,
+    OPK_A,
+    OPK_AB,
+    OPK_C,
+    OPK_DPTR,
+    OPK_AT_DPTR,        // @DPTR
+    OPK_AT_A_DPTR,      // @A+DPTR
+    OPK_AT_A_PC,        // @A+PC
+    OPK_RN,             // R0-R7 from the low opcode bits
+    OPK_AT_RI,          // @R0/@R1 from opcode bit 0
+    OPK_DIRECT,         // 1 byte: IRAM 0x00-0x7F or SFR
+    OPK_IMM8,           // 1 byte: #data
+    OPK_IMM16,          // 2 bytes: #data16, high byte first
+    OPK_BIT,            // 1 byte: bit address
+    OPK_NBIT,           // 1 byte: /bit (complemented)
+    OPK_REL,            // 1 byte: signed offset from the next instruction
+    OPK_ADDR11,         // 1 byte + opcode bits 7-5, within the current 2K page
+    OPK_ADDR16          // 2 bytes, high byte first
+} operand_kind_t;
+
+// Control flow
+#define OPF_BRANCH          0x0001  // Conditional relative branch
+#define OPF_JUMP            0x0002  // Unconditional jump
+#define OPF_CALL            0x0004
+#define OPF_RETURN          0x0008  // RET / RETI
+#define OPF_RETI            0x0010
+#define OPF_INDIRECT_JUMP   0x0020  // Target not known statically (JMP @A+DPTR)
+#define OPF_INVALID         0x0040  // Reserved opcode (0xA5)
+
+// Memory effects (bit operands count as their containing byte)
+#define OPF_RD_DIRECT       0x0100  // Direct address read: may be an SFR
+#define OPF_WR_DIRECT       0x0200  // Direct address write: may be an SFR
+#define OPF_RD_INDIRECT     0x0400  // @Ri IRAM read
+#define OPF_WR_INDIRECT     0x0800  // @Ri IRAM write
+#define OPF_RD_XRAM         0x1000
+#define OPF_WR_XRAM         0x2000
+#define OPF_RD_CODE         0x4000  // MOVC
+#define OPF_STACK           0x8000  // Pushes or pops
+
+// Anything after which the next PC is not simply pc + length
+#define OPF_CONTROL (OPF_BRANCH | OPF_JUMP | OPF_CALL | OPF_RETURN)
+
+typedef struct {
+    const char *mnemonic;
+    uint8_t length;
+    uint8_t cycles;         // Machine cycles, classic core
+    uint8_t cycles_1t;      // Clocks, single-cycle core (branch not taken)
+    uint8_t operands[3];    // operand_kind_t
+    uint16_t flags;         // OPF_*
+} opcode_info_t;
+
+extern const opcode_info_t opcode_table[256];
+
+// Disassembles the instruction in `code` (at least its length in bytes)
+// located at `pc`. Returns the instruction length.
+int opcode_disasm(const uint8_t *code, uint16_t pc, char *out, size_t size);
+
+// Branch/jump/call target known from the encoding alone; returns 0 for
+// anything else (returns, JMP @A+DPTR, plain instructions)
+int opcode_target(const uint8_t *code, uint16_t pc, uint16_t *target);
+
+#endif
@@ -0,0 +1,110 @@
+// Real-time pacing: runs the CPU in batches and sleeps between them so that
+// sys->cpu.cycles tracks a real oscillator.
+#include <stdio.h>
+#include <signal.h>
+#include <time.h>
+#include "pacing.h"
+
+static volatile sig_atomic_t pacing_stop = 0;
+
+static void pacing_sigint(int sig) {
+    (void)sig;
+    pacing_stop = 1;
+}
+
+static int64_t ts_to_ns(const struct timespec *ts) {
+    return (int64_t)ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts_to_ns(&ts);
+}
+
+void pacing_config_default(pacing_config_t *cfg) {
+    cfg->crystal_hz = PACING_DEFAULT_CRYSTAL_HZ;
+    cfg->warp = 1.0;
+    cfg->batch_cycles = 0;
+    cfg->max_cycles = 0;
+}
+
+run_result_t pacing_run(system_8051_t *sys, const pacing_config_t *cfg, pacing_stats_t *stats) {
+    // ns of host time per emulated clock
+    double ns_per_cycle = 1e9 / (cfg->crystal_hz * cfg->warp);
+    uint64_t batch = cfg->batch_cycles;
+    if (batch == 0) batch = (uint64_t)(cfg->crystal_hz * cfg->warp / 1000.0); // ~1 ms
+    if (batch == 0) batch = 1;
+
+    *stats = (pacing_stats_t){0};
+
+    struct sigaction sa = {0}, old_sa;
+    sa.sa_handler = pacing_sigint;
+    sigemptyset(&sa.sa_mask);
+    pacing_stop = 0;
+    sigaction(SIGINT, &sa, &old_sa);
+
+    uint64_t start_cycles = sys->cpu.cycles;
+    uint64_t anchor_cycles = start_cycles; // Schedule is measured from here
+    int64_t start_ns = now_ns();
+    int64_t anchor_ns = start_ns;
+    run_result_t result = RUN_LIMIT;
+
+    while (!pacing_stop) {
+        uint64_t batch_end = sys->cpu.cycles + batch;
+        if (cfg->max_cycles && batch_end > start_cycles + cfg->max_cycles) {
+            batch_end = start_cycles + cfg->max_cycles;
+        }
+
+        // Run the batch flat out, no syscalls in here
+        result = system_run(sys, RUN_NO_LIMIT, batch_end);
+        stats->batches++;
+
+        int64_t deadline = anchor_ns + (int64_t)((double)(sys->cpu.cycles - anchor_cycles) * ns_per_cycle);
+        int64_t late = now_ns() - deadline;
+
+        if (late > 0) {
+            if (late > stats->max_late_ns) stats->max_late_ns = late;
+            if (late > PACING_LATE_NS) stats->late_batches++;
+            if (late > PACING_RESYNC_NS) {
+                // Host could not keep up (or was stopped); slip rather than burst
+                anchor_ns = deadline + late;
+                anchor_cycles = sys->cpu.cycles;
+                stats->resyncs++;
+            }
+        }
+        else {
+            struct timespec ts;
+            ts.tv_sec = deadline / 1000000000LL;
+            ts.tv_nsec = deadline % 1000000000LL;
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0 && !pacing_stop);
+
+            int64_t wake = now_ns() - deadline;
+            if (wake > stats->max_wake_ns) stats->max_wake_ns = wake;
+        }
+
+        if (result != RUN_LIMIT) break;
+        if (cfg->max_cycles && sys->cpu.cycles - start_cycles >= cfg->max_cycles) break;
+    }
+
+    sigaction(SIGINT, &old_sa, NULL);
+
+    int64_t end_ns = now_ns();
+    stats->cycles = sys->cpu.cycles - start_cycles;
+    stats->host_seconds = (double)(end_ns - start_ns) / 1e9;
+    stats->drift_ns = (end_ns - start_ns) - (int64_t)((double)stats->cycles * ns_per_cycle);
+    return result;
+}
+
+void pacing_print_stats(const pacing_config_t *cfg, const pacing_stats_t *stats) {
+    double emulated = (double)stats->cycles / cfg->crystal_hz;
+
+    printf("\n| REAL-TIME PACING    | CRYSTAL: %.4f MHz | WARP: %.2fx\n", cfg->crystal_hz / 1e6, cfg->warp);
+    printf("|---------------------+--------------------------------------------\n");
+    printf("| Emulated time       : %.6f s (%lu cycles)\n", emulated, stats->cycles);
+    printf("| Host time           : %.6f s\n", stats->host_seconds);
+    printf("| Drift               : %+.3f ms\n", stats->drift_ns / 1e6);
+    printf("| Batches             : %lu (%lu late, %lu resyncs)\n", stats->batches, stats->late_batches, stats->resyncs);
+    printf("| Worst lateness      : %.3f ms\n", stats->max_late_ns / 1e6);
+    printf("| Worst wake jitter   : %.3f ms\n", stats->max_wake_ns / 1e6);
+}
@@ -0,0 +1,42 @@
+#ifndef PACING_H
+#define PACING_H
+
+#include <stdint.h>
+#include "system.h"
+
+// Default crystal: 11.0592 MHz (standard UART-friendly 8051 oscillator)
+#define PACING_DEFAULT_CRYSTAL_HZ 11059200.0
+
+// A batch later than this is counted as late
+#define PACING_LATE_NS 1000000LL
+
+// Fall this far behind and the schedule is re-anchored instead of racing to catch up
+#define PACING_RESYNC_NS 100000000LL
+
+typedef struct {
+    double crystal_hz;      // Oscillator frequency. sys->cpu.cycles counts oscillator clocks
+    double warp;            // 1.0 = real time, 2.0 = twice as fast, ...
+    uint64_t batch_cycles;  // Emulated clocks per batch (0 = ~1 ms worth)
+    uint64_t max_cycles;    // Stop after this many clocks (0 = run until halt)
+} pacing_config_t;
+
+typedef struct {
+    uint64_t batches;
+    uint64_t late_batches;  // Batches that finished more than PACING_LATE_NS behind schedule
+    uint64_t resyncs;       // Times the schedule was re-anchored
+    int64_t max_late_ns;    // Worst lateness seen at a batch boundary
+    int64_t max_wake_ns;    // Worst oversleep after clock_nanosleep()
+    int64_t drift_ns;       // Host time minus emulated time at the end of the run
+    uint64_t cycles;        // Emulated clocks covered by this run
+    double host_seconds;
+} pacing_stats_t;
+
+void pacing_config_default(pacing_config_t *cfg);
+
+// Runs the CPU locked to the configured crystal until a stop condition,
+// max_cycles or SIGINT (the latter two return RUN_LIMIT).
+run_result_t pacing_run(system_8051_t *sys, const pacing_config_t *cfg, pacing_stats_t *stats);
+
+void pacing_print_stats(const pacing_config_t *cfg, const pacing_stats_t *stats);
+
+#endif
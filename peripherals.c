@@ -1,92 +1,183 @@
 #include "system.h"
 #include <stdio.h>
 
-void peripherals_step(system_8051_t * sys, uint64_t step_cycles) {
-    int ticks = step_cycles / 12;
-    if(ticks == 0) ticks = 1;
+// Timers advance once per sys->variant->timer_clocks oscillator clocks (a
+// machine cycle on classic cores). Every helper below takes any number of
+// ticks and returns how many times the counter overflowed, so a single call
+// can cover an arbitrarily large batch.
+
+// 8-, 13- or 16-bit up-counter
+static uint64_t count_up(uint32_t *value, uint32_t modulus, uint64_t ticks) {
+    uint64_t total = *value + ticks;
+    *value = total % modulus;
+    return total / modulus;
+}
+
+// Counter of `modulus` states reloaded from `reload` on every overflow
+// (Timer 0/1 mode 2, Timer 2 auto-reload and baud modes)
+static uint64_t count_reload(uint32_t *value, uint32_t reload, uint32_t modulus, uint64_t ticks) {
+    uint64_t to_first = modulus - *value;
+    if (ticks < to_first) {
+        *value += ticks;
+        return 0;
+    }
+    uint64_t period = modulus - reload;
+    uint64_t rest = ticks - to_first;
+    *value = reload + rest % period;
+    return 1 + rest / period;
+}
+
+// One timer in modes 0-2 (mode 3 is handled by the caller)
+static uint64_t timer_advance(uint8_t mode, uint8_t *tl, uint8_t *th, uint64_t ticks) {
+    uint32_t value;
+    uint64_t overflows;
+
+    switch (mode) {
+        case 0: // 13-bit: TH:TL[4:0]
+            value = ((uint32_t)*th << 5) | (*tl & 0x1F);
+            overflows = count_up(&value, 0x2000, ticks);
+            *th = value >> 5;
+            *tl = value & 0x1F;
+            return overflows;
+        case 1: // 16-bit
+            value = ((uint32_t)*th << 8) | *tl;
+            overflows = count_up(&value, 0x10000, ticks);
+            *th = value >> 8;
+            *tl = value & 0xFF;
+            return overflows;
+        case 2:
+            value = *tl;
+            overflows = count_reload(&value, *th, 0x100, ticks);
+            *tl = value;
+            return overflows;
+        default:
+            return 0;
+    }
+}
+
+// Timer 2 (8052 and later). C/T2 and T2EX are not modelled: capture mode
+// just counts freely.
+static uint64_t timer2_advance(system_8051_t *sys, uint64_t step_cycles, uint64_t ticks) {
+    uint8_t con = sys->sfr.T2CON;
+    uint32_t value = ((uint32_t)sys->sfr.TH2 << 8) | sys->sfr.TL2;
+    uint32_t reload = ((uint32_t)sys->sfr.RCAP2H << 8) | sys->sfr.RCAP2L;
+    uint64_t overflows;
+
+    if (con & (T2CON_RCLK | T2CON_TCLK)) {
+        // Baud rate generator: counts at fosc/2 whatever the core speed
+        uint64_t clocks = sys->sfr.t2_clock_rem + step_cycles;
+        sys->sfr.t2_clock_rem = clocks & 1;
+        overflows = count_reload(&value, reload, 0x10000, clocks >> 1);
+    }
+    else if (con & T2CON_CPRL2) {
+        overflows = count_up(&value, 0x10000, ticks);
+    }
+    else {
+        overflows = count_reload(&value, reload, 0x10000, ticks);
+    }
+
+    sys->sfr.TH2 = value >> 8;
+    sys->sfr.TL2 = value & 0xFF;
+    return overflows;
+}
+
+uint64_t peripherals_timer_ticks(uint8_t mode, uint8_t tl, uint8_t th) {
+    switch (mode) {
+        case 0: return 0x2000 - (((uint32_t)th << 5) | (tl & 0x1F));
+        case 1: return 0x10000 - (((uint32_t)th << 8) | tl);
+        case 2: return 0x100 - tl;
+        default: return RUN_NO_LIMIT;
+    }
+}
+
+uint64_t peripherals_ticks_clocks(system_8051_t *sys, uint64_t ticks) {
+    if (ticks == RUN_NO_LIMIT) return RUN_NO_LIMIT;
+    return ticks * sys->variant->timer_clocks - sys->sfr.clock_rem;
+}
+
+uint64_t peripherals_next_event(system_8051_t *sys, uint8_t wake) {
     uint8_t t0_mode = sys->sfr.TMOD & 0x03;
-    uint8_t t1_mode = sys->sfr.TMOD & 0x30;
-
-    if(t0_mode == 0x03) {
-        if (sys->sfr.TCON & TCON_TR0) { 
-             uint16_t val = sys->sfr.TL0 + ticks;
-             if (val > 0xFF) {
-                 sys->sfr.TCON |= TCON_TF0;
-                 val &= 0xFF;
-             }
-             sys->sfr.TL0 = (uint8_t)val;
-        }
-        if (sys->sfr.TCON & TCON_TR1) {
-             uint16_t val = sys->sfr.TH0 + ticks;
-             if (val > 0xFF) {
-                 sys->sfr.TCON |= TCON_TF1;
-                 val &= 0xFF;
-             }
-             sys->sfr.TH0 = (uint8_t)val;
-        }
+    uint8_t t1_mode = (sys->sfr.TMOD >> 4) & 0x03;
+    uint64_t ticks = RUN_NO_LIMIT;
+    uint64_t left;
 
-        return;
+    // Timer flags only matter when their interrupt could be taken
+    if (t0_mode == 0x03) {
+        if ((sys->sfr.TCON & TCON_TR0) && (wake & (1 << IRQ_TIMER0))) ticks = 0x100 - sys->sfr.TL0;
+        if ((sys->sfr.TCON & TCON_TR1) && (wake & (1 << IRQ_TIMER1)) && (left = 0x100 - sys->sfr.TH0) < ticks) ticks = left;
     }
+    else {
+        if ((sys->sfr.TCON & TCON_TR0) && (wake & (1 << IRQ_TIMER0))) ticks = peripherals_timer_ticks(t0_mode, sys->sfr.TL0, sys->sfr.TH0);
+        if ((sys->sfr.TCON & TCON_TR1) && (wake & (1 << IRQ_TIMER1)) &&
+            (left = peripherals_timer_ticks(t1_mode, sys->sfr.TL1, sys->sfr.TH1)) < ticks) ticks = left;
+    }
+    if (sys->variant->has_timer2 && (sys->sfr.T2CON & T2CON_TR2) && !(sys->sfr.T2CON & (T2CON_RCLK | T2CON_TCLK)) &&
+        (wake & (1 << IRQ_TIMER2)) && (left = 0x10000 - (((uint32_t)sys->sfr.TH2 << 8) | sys->sfr.TL2)) < ticks) {
+        ticks = left;
+    }
+
+    uint64_t clocks = peripherals_ticks_clocks(sys, ticks);
+    uint64_t serial = uart_next_event(sys, wake & (1 << IRQ_SERIAL));
+    return serial < clocks ? serial : clocks;
+}
+
+void peripherals_step(system_8051_t * sys, uint64_t step_cycles) {
+    uint64_t clocks = sys->sfr.clock_rem + step_cycles;
+    uint64_t ticks = clocks / sys->variant->timer_clocks;
+    sys->sfr.clock_rem = clocks % sys->variant->timer_clocks;
 
-    if(sys->sfr.TCON & TCON_TR0) {
-        int count;
-        if(t0_mode == 0x01) {
-            count = ((uint16_t)sys->sfr.TH0 << 8) + sys->sfr.TL0 + ticks;
-            if(count > 0xFFFF) {
-                sys->sfr.TCON |= TCON_TF0;
-                count &= 0xFFFF;
+    uint8_t t0_mode = sys->sfr.TMOD & 0x03;
+    uint8_t t1_mode = (sys->sfr.TMOD >> 4) & 0x03;
+    uint8_t flags = 0;
+    uint64_t t1_overflows = 0;  // Baud clocks for serial modes 1 and 3
+    uint64_t t2_overflows = 0;
+    int t2_flag = 0;
+
+    if (ticks) {
+        if (t0_mode == 0x03) {
+            // Split mode: TL0 is timer 0 (TR0/TF0), TH0 borrows TR1/TF1
+            uint32_t value;
+            if (sys->sfr.TCON & TCON_TR0) {
+                value = sys->sfr.TL0;
+                if (count_up(&value, 0x100, ticks)) flags |= TCON_TF0;
+                sys->sfr.TL0 = value;
             }
-            sys->sfr.TH0 = count >> 8;
-            sys->sfr.TL0 = count & 0xFF;
-        }
-        else if(t0_mode == 0x00) {
-            count = ((uint16_t)sys->sfr.TH0 << 5) + (sys->sfr.TL0 & 0x1F) + ticks;
-            if(count > 0x1FFF) {
-                sys->sfr.TCON |= TCON_TF0;
-                count &= 0x1FFF;
+            if (sys->sfr.TCON & TCON_TR1) {
+                value = sys->sfr.TH0;
+                if (count_up(&value, 0x100, ticks)) flags |= TCON_TF1;
+                sys->sfr.TH0 = value;
             }
-            sys->sfr.TH0 = count >> 5;
-            sys->sfr.TL0 = count & 0x1F;
+
+            // Timer 1 keeps running without TR1 or TF1 (usually as the baud
+            // generator); putting it in mode 3 stops it
+            t1_overflows = timer_advance(t1_mode, &sys->sfr.TL1, &sys->sfr.TH1, ticks);
         }
-        else if(t0_mode == 0x02) {
-            count = sys->sfr.TL0 + ticks;
-            if(count > 0xFF) {
-                sys->sfr.TCON |= TCON_TF0;
-                int ov = count - 0x100;
-                count = sys->sfr.TH0 + ov;
+        else {
+            if ((sys->sfr.TCON & TCON_TR0) && timer_advance(t0_mode, &sys->sfr.TL0, &sys->sfr.TH0, ticks)) {
+                flags |= TCON_TF0;
+            }
+            if (sys->sfr.TCON & TCON_TR1) {
+                t1_overflows = timer_advance(t1_mode, &sys->sfr.TL1, &sys->sfr.TH1, ticks);
+                if (t1_overflows) flags |= TCON_TF1;
             }
-            sys->sfr.TL0 = count & 0xFF;
         }
     }
 
-    if(sys->sfr.TCON & TCON_TR1) {
-        int count;
-        if(t1_mode == 0x10) {
-            count = ((uint16_t)sys->sfr.TH1 << 8) + sys->sfr.TL1 + ticks;
-            if(count > 0xFFFF) {
-                sys->sfr.TCON |= TCON_TF1;
-                count &= 0xFFFF;
-            }
-            sys->sfr.TH1 = count >> 8;
-            sys->sfr.TL1 = count & 0xFF;
-        }
-        else if(t1_mode == 0x00) {
-            count = ((uint16_t)sys->sfr.TH1 << 5) + (sys->sfr.TL1 & 0x1F) + ticks;
-            if(count > 0x1FFF) {
-                sys->sfr.TCON |= TCON_TF1;
-                count &= 0x1FFF;
-            }
-            sys->sfr.TH1 = count >> 5;
-            sys->sfr.TL1 = count & 0x1F;
-        }
-        else if(t1_mode == 0x20) {
-            count = sys->sfr.TL1 + ticks;
-            if(count > 0xFF) {
-                sys->sfr.TCON |= TCON_TF1;
-                int ov = count - 0x100;
-                count = sys->sfr.TH1 + ov;
-            }
-            sys->sfr.TL1 = count & 0xFF;
+    if (sys->variant->has_timer2 && (sys->sfr.T2CON & T2CON_TR2)) {
+        t2_overflows = timer2_advance(sys, step_cycles, ticks);
+
+        // The baud generator modes never set TF2
+        if (t2_overflows && !(sys->sfr.T2CON & (T2CON_RCLK | T2CON_TCLK))) {
+            sys->sfr.T2CON |= T2CON_TF2;
+            t2_flag = 1;
         }
     }
+
+    if (flags || t2_flag) {
+        sys->sfr.TCON |= flags;
+        interrupt_update(sys);
+    }
+    if (sys->uart.tx_busy || sys->uart.rx_busy || (sys->sfr.SCON & SCON_REN)) {
+        uart_step(sys, step_cycles, t1_overflows, t2_overflows);
+    }
 }
\ No newline at end of file
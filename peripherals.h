@@ -12,6 +12,14 @@ typedef struct {
     uint8_t TL1;        // Timer 1 Low
     uint8_t TH1;        // Timer 1 High
 
+    // TIMER 2 (variants with has_timer2)
+    uint8_t T2CON;      // Timer 2 Control (Bit Addressable)
+    uint8_t T2MOD;      // Timer 2 Mode
+    uint8_t RCAP2L;     // Reload / capture Low
+    uint8_t RCAP2H;     // Reload / capture High
+    uint8_t TL2;        // Timer 2 Low
+    uint8_t TH2;        // Timer 2 High
+
     // SERIAL
     uint8_t SCON;       // Serial Control (Bit Addressable)
     uint8_t SBUF;       // Serial Buffer
@@ -26,6 +34,11 @@ typedef struct {
     uint8_t IE;         // Interrupt Enable (Bit Addressable)
     uint8_t IP;         // Interrupt Priority (Bit Addressable)
     uint8_t PCON;       // Power Control
+    uint8_t AUXR1;      // Bit 0 selects the data pointer (dual DPTR variants)
+
+    // TIMING (not an SFR)
+    uint8_t clock_rem;  // Oscillator clocks carried over until they make a timer tick
+    uint8_t t2_clock_rem; // Same for Timer 2 as a baud generator (fosc/2)
 } peripherals_t;
 
 // BIT MASKS
@@ -57,6 +70,26 @@ typedef struct {
 #define IP_PT0   0x02
 #define IP_PX0   0x01
 
+// T2CON (Timer 2 Control)
+#define T2CON_TF2    0x80
+#define T2CON_EXF2   0x40
+#define T2CON_RCLK   0x20
+#define T2CON_TCLK   0x10
+#define T2CON_EXEN2  0x08
+#define T2CON_TR2    0x04
+#define T2CON_CT2    0x02
+#define T2CON_CPRL2  0x01
+
+// AUXR1
+#define AUXR1_DPS    0x01
+
+// PCON (Power Control; SMOD is with the serial port)
+#define PCON_GF1     0x08
+#define PCON_GF0     0x04
+#define PCON_PD      0x02  // Power-down: oscillator stopped
+#define PCON_IDL     0x01  // Idle: CPU stopped, peripherals running
+#define PCON_SLEEP   (PCON_PD | PCON_IDL)
+
 // SCON (Serial Control)
 #define SCON_SM0 0x80
 #define SCON_SM1 0x40
@@ -0,0 +1,122 @@
+// Port edge events in a shared-memory ring
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "portlog.h"
+
+_Static_assert(sizeof(portlog_shm_t) == 256, "portlog header layout changed");
+_Static_assert(sizeof(port_event_t) == 16, "port_event_t layout changed");
+
+struct portlog {
+    portlog_shm_t *shm;
+    port_event_t *events;
+    size_t map_size;
+    uint64_t head;          // Local copy, published after each event
+    uint64_t tail_cache;
+    uint32_t mask;
+    int lossless;
+    char name[256];
+};
+
+portlog_t *portlog_open(const char *name, uint32_t capacity, int lossless) {
+    uint32_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+
+    portlog_t *log = calloc(1, sizeof(portlog_t));
+    if (log == NULL) return NULL;
+    snprintf(log->name, sizeof(log->name), "%s%s", name[0] == '/' ? "" : "/", name);
+
+    log->map_size = sizeof(portlog_shm_t) + (size_t)cap * sizeof(port_event_t);
+    int fd = shm_open(log->name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, log->map_size) != 0) {
+        printf("Could not create shared memory %s: %s\n", log->name, strerror(errno));
+        if (fd >= 0) close(fd);
+        free(log);
+        return NULL;
+    }
+
+    log->shm = mmap(NULL, log->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (log->shm == MAP_FAILED) {
+        printf("Could not map shared memory %s: %s\n", log->name, strerror(errno));
+        free(log);
+        return NULL;
+    }
+
+    log->events = portlog_events(log->shm);
+    log->mask = cap - 1;
+    log->lossless = lossless;
+
+    log->shm->capacity = cap;
+    log->shm->event_size = sizeof(port_event_t);
+    log->shm->version = PORTLOG_VERSION;
+    // Magic last: a consumer polling for it sees a complete header
+    atomic_thread_fence(memory_order_release);
+    log->shm->magic = PORTLOG_MAGIC;
+    return log;
+}
+
+void portlog_emit(portlog_t *log, uint64_t cycle, uint8_t port, uint8_t old_value, uint8_t new_value) {
+    if (log->head - log->tail_cache > log->mask) {
+        log->tail_cache = atomic_load_explicit(&log->shm->tail, memory_order_acquire);
+        while (log->head - log->tail_cache > log->mask) {
+            if (!log->lossless) {
+                atomic_fetch_add_explicit(&log->shm->dropped, 1, memory_order_relaxed);
+                return;
+            }
+            sched_yield();
+            log->tail_cache = atomic_load_explicit(&log->shm->tail, memory_order_acquire);
+        }
+    }
+
+    port_event_t *ev = &log->events[log->head & log->mask];
+    ev->cycle = cycle;
+    ev->port = port;
+    ev->old_value = old_value;
+    ev->new_value = new_value;
+
+    log->head++;
+    atomic_store_explicit(&log->shm->head, log->head, memory_order_release);
+}
+
+void portlog_close(portlog_t *log) {
+    if (log == NULL) return;
+
+    printf("Port log %s: %lu events, %lu dropped\n", log->name, log->head,
+           atomic_load(&log->shm->dropped));
+    atomic_store_explicit(&log->shm->closed, 1, memory_order_release);
+    munmap(log->shm, log->map_size);
+    // The object stays in /dev/shm so a slower consumer can finish; it is
+    // replaced on the next run or removed by the consumer
+    free(log);
+}
+
+portlog_shm_t *portlog_attach(const char *name) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s%s", name[0] == '/' ? "" : "/", name);
+
+    int fd = shm_open(path, O_RDWR, 0);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(portlog_shm_t)) {
+        close(fd);
+        return NULL;
+    }
+
+    portlog_shm_t *shm = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED) return NULL;
+
+    if (shm->magic != PORTLOG_MAGIC || shm->version != PORTLOG_VERSION) {
+        munmap(shm, st.st_size);
+        return NULL;
+    }
+    return shm;
+}
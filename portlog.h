@@ -0,0 +1,66 @@
+#ifndef PORTLOG_H
+#define PORTLOG_H
+
+// Port activity event stream. Every change of a P0-P3 latch is appended to a
+// ring in POSIX shared memory (/dev/shm/<name>) that an external process maps
+// and reads in place.
+//
+// Layout of the shared object:
+//   portlog_shm_t header (fixed, 256 bytes)
+//   port_event_t events[capacity]
+//
+// Protocol: the emulator writes events[head % capacity] and then publishes
+// head (release). The consumer reads events[tail % capacity] while
+// tail < head (acquire) and then publishes tail. When the ring is full the
+// emulator either drops the event (counted in `dropped`) or, in lossless
+// mode, waits for the consumer.
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define PORTLOG_MAGIC   0x31354550u  // "PE51"
+#define PORTLOG_VERSION 1
+#define PORTLOG_DEFAULT_CAPACITY (1u << 20)
+
+typedef struct {
+    uint64_t cycle;     // sys->cpu.cycles at the start of the writing instruction
+    uint8_t port;       // 0-3
+    uint8_t old_value;
+    uint8_t new_value;
+    uint8_t reserved[5];
+} port_event_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;          // Events, power of two
+    uint32_t event_size;        // sizeof(port_event_t)
+    uint8_t pad0[48];
+
+    _Atomic uint64_t head;      // Written by the emulator
+    uint8_t pad1[56];
+
+    _Atomic uint64_t tail;      // Written by the consumer
+    uint8_t pad2[56];
+
+    _Atomic uint64_t dropped;   // Events lost to a full ring
+    _Atomic uint32_t closed;    // Set by the emulator on exit
+    uint8_t pad3[52];
+} portlog_shm_t;
+
+typedef struct portlog portlog_t;
+
+// Creates (or replaces) /dev/shm/<name>. Returns NULL on failure.
+portlog_t *portlog_open(const char *name, uint32_t capacity, int lossless);
+void portlog_close(portlog_t *log);
+
+// Producer side, called only when a latch actually changes
+void portlog_emit(portlog_t *log, uint64_t cycle, uint8_t port, uint8_t old_value, uint8_t new_value);
+
+// Consumer side helper for C tools: maps an existing ring read-write
+portlog_shm_t *portlog_attach(const char *name);
+
+static inline port_event_t *portlog_events(portlog_shm_t *shm) {
+    return (port_event_t *)(shm + 1);
+}
+
+#endif
@@ -0,0 +1,215 @@
+// Sampling profiler: SIGPROF from a per-thread CPU-time timer
+#define _GNU_SOURCE
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "prof.h"
+#include "cfg.h"
+#include "sym.h"
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+#define PROF_MAX_PROBES 32
+
+// The profiler of the system this thread is running
+static __thread profiler_t *prof_current;
+
+// LCALL or ACALL immediately before `ret`: returns the call's address
+static int call_site(system_8051_t *sys, uint16_t ret, uint16_t *site) {
+    if (system_read_code(sys, ret - 3) == 0x12) {
+        *site = ret - 3;
+        return 1;
+    }
+    if ((system_read_code(sys, ret - 2) & 0x1F) == 0x11) {
+        *site = ret - 2;
+        return 1;
+    }
+    return 0;
+}
+
+// Scans the 8051 stack from SP down for return addresses that follow a call.
+// The frames pushed by interrupt entry are known exactly from irq.isr_sp.
+static uint32_t unwind(system_8051_t *sys, uint16_t *frames) {
+    uint32_t depth = 0;
+    int level = sys->irq.depth;
+    int sp = sys->cpu.SP;
+
+    frames[depth++] = sys->cpu.PC;
+    while (depth < PROF_MAX_DEPTH) {
+        int floor = level > 0 ? sys->irq.isr_sp[level - 1] : 0x07;
+        if (sp - 1 > floor) {
+            uint16_t ret = sys->iram[sp] << 8 | sys->iram[sp - 1];
+            if (call_site(sys, ret, &frames[depth])) {
+                depth++;
+                sp -= 2;
+            }
+            else sp--;
+            continue;
+        }
+        if (level == 0) break;
+
+        // The interrupted code resumes at the address pushed by the vector call
+        sp = floor;
+        frames[depth++] = sys->iram[sp] << 8 | sys->iram[sp - 1];
+        sp -= 2;
+        level--;
+    }
+    return depth;
+}
+
+static void prof_signal(int sig, siginfo_t *info, void *context) {
+    profiler_t *prof = prof_current;
+    (void)sig;
+    (void)info;
+    (void)context;
+    if (prof == NULL) return;
+
+    uint16_t frames[PROF_MAX_DEPTH];
+    uint32_t depth = unwind(prof->sys, frames);
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < depth; i++) hash = (hash ^ frames[i]) * 16777619u;
+
+    prof->samples++;
+    for (uint32_t probe = 0; probe < PROF_MAX_PROBES; probe++) {
+        prof_stack_t *slot = &prof->table[(hash + probe) & (PROF_TABLE_SIZE - 1)];
+        if (slot->depth == 0) {
+            memcpy(slot->frames, frames, depth * sizeof(uint16_t));
+            slot->hash = hash;
+            slot->count = 1;
+            slot->depth = depth;
+            return;
+        }
+        if (slot->hash == hash && slot->depth == depth && memcmp(slot->frames, frames, depth * sizeof(uint16_t)) == 0) {
+            slot->count++;
+            return;
+        }
+    }
+    prof->dropped++;
+}
+
+profiler_t *prof_start(system_8051_t *sys, const char *path, unsigned hz) {
+    profiler_t *prof = calloc(1, sizeof(profiler_t));
+    if (prof == NULL) return NULL;
+    prof->sys = sys;
+
+    // Expand %p so that every process of a fleet writes its own file
+    size_t out = 0;
+    for (const char *p = path; *p && out + 12 < sizeof(prof->path); p++) {
+        if (p[0] == '%' && p[1] == 'p') {
+            out += snprintf(prof->path + out, sizeof(prof->path) - out, "%d", (int)getpid());
+            p++;
+        }
+        else prof->path[out++] = *p;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = prof_signal;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGPROF, &sa, NULL);
+
+    struct sigevent sev;
+    memset(&sev, 0, sizeof(sev));
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = SIGPROF;
+    sev.sigev_notify_thread_id = syscall(SYS_gettid);
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, &prof->timer) != 0) {
+        printf("Error: Could not create the profiling timer: %s\n", strerror(errno));
+        free(prof);
+        return NULL;
+    }
+
+    prof_current = prof;
+
+    if (hz == 0) hz = PROF_DEFAULT_HZ;
+    struct itimerspec its;
+    its.it_interval.tv_sec = 0;
+    its.it_interval.tv_nsec = hz > 1 ? 1000000000L / hz : 999999999L;
+    its.it_value = its.it_interval;
+    timer_settime(prof->timer, 0, &its, NULL);
+    return prof;
+}
+
+typedef struct {
+    char *line;
+    uint64_t count;
+} prof_line_t;
+
+static int compare_lines(const void *a, const void *b) {
+    return strcmp(((const prof_line_t *)a)->line, ((const prof_line_t *)b)->line);
+}
+
+// Function holding `pc`: its symbol if loaded, else its vector name or entry
+// address. A sample can land after the fetch has moved PC past the last byte
+// of an instruction.
+static int frame_name(const symtab_t *syms, const cfg_t *cfg, uint16_t pc, char *out, size_t size) {
+    const sym_t *sym = sym_lookup(syms, SYM_CODE, pc);
+    if (sym) return snprintf(out, size, "%s", sym->name);
+
+    const cfg_block_t *block = NULL;
+    for (int back = 0; cfg && block == NULL && back < 3; back++) block = cfg_block_at(cfg, pc - back);
+    if (block == NULL || block->func < 0) return snprintf(out, size, "0x%04X", pc);
+
+    const cfg_func_t *func = &cfg->funcs[block->func];
+    if (func->name) return snprintf(out, size, "%s", func->name);
+    return snprintf(out, size, "fn_%04X", func->entry);
+}
+
+void prof_stop(profiler_t *prof) {
+    if (prof == NULL) return;
+    timer_delete(prof->timer);
+    prof_current = NULL;
+
+    FILE *out = fopen(prof->path, "w");
+    if (out == NULL) {
+        printf("Error: Could not open %s\n", prof->path);
+        free(prof);
+        return;
+    }
+
+    // Several raw stacks can name the same functions; merge them
+    cfg_t *cfg = cfg_build(prof->sys);
+    prof_line_t *lines = calloc(PROF_TABLE_SIZE, sizeof(prof_line_t));
+    size_t count = 0;
+    for (uint32_t i = 0; lines && i < PROF_TABLE_SIZE; i++) {
+        const prof_stack_t *stack = &prof->table[i];
+        if (stack->depth == 0) continue;
+
+        // Symbol names run up to 255 characters; deep stacks of long
+        // names are cut off at the end of the line
+        char line[PROF_MAX_DEPTH * 16];
+        size_t pos = 0;
+        for (int f = stack->depth - 1; f >= 0 && pos < sizeof(line) - 1; f--) {
+            int len = frame_name(prof->sys->syms, cfg, stack->frames[f], line + pos, sizeof(line) - pos);
+            if (len > 0) pos += len;
+            if (pos >= sizeof(line) - 1) pos = sizeof(line) - 1;
+            else if (f > 0) line[pos++] = ';';
+        }
+        line[pos] = '\0';
+        lines[count].line = strdup(line);
+        if (lines[count].line == NULL) continue;
+        lines[count].count = stack->count;
+        count++;
+    }
+    qsort(lines, count, sizeof(prof_line_t), compare_lines);
+
+    for (size_t i = 0; i < count; i++) {
+        uint64_t total = lines[i].count;
+        while (i + 1 < count && strcmp(lines[i].line, lines[i + 1].line) == 0) total += lines[++i].count;
+        fprintf(out, "%s %lu\n", lines[i].line, total);
+    }
+    if (prof->dropped) fprintf(stderr, "Profiler: %lu of %lu samples dropped (too many distinct stacks)\n", prof->dropped, prof->samples);
+
+    for (size_t i = 0; i < count; i++) free(lines[i].line);
+    free(lines);
+    cfg_free(cfg);
+    fclose(out);
+    free(prof);
+}
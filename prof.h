@@ -0,0 +1,45 @@
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdint.h>
+#include <time.h>
+#include "system.h"
+
+// Statistical profiler. A per-thread CPU-time timer (timer_create with
+// SIGEV_THREAD_ID) sends SIGPROF to the thread running the emulator; the
+// handler reads PC, unwinds the 8051 stack and counts the stack in a
+// preallocated table. The run loop is not touched, so the cost is only the
+// handler itself. Each emulator thread can profile its own system.
+//
+// At prof_stop() the stacks are written in collapsed form, one line per
+// distinct stack, outermost function first:
+//   reset;fn_0120;timer0 42
+
+#define PROF_DEFAULT_HZ 997     // Off the round numbers, to avoid lockstep with periodic work
+#define PROF_MAX_DEPTH  24
+#define PROF_TABLE_SIZE 4096    // Distinct stacks kept (power of two)
+
+typedef struct {
+    uint32_t hash;
+    uint32_t depth;             // 0 = free slot
+    uint64_t count;
+    uint16_t frames[PROF_MAX_DEPTH];    // Innermost first: PC, then return sites
+} prof_stack_t;
+
+typedef struct {
+    system_8051_t *sys;
+    timer_t timer;
+    char path[256];
+    uint64_t samples;
+    uint64_t dropped;           // Table full
+    prof_stack_t table[PROF_TABLE_SIZE];
+} profiler_t;
+
+// Starts sampling `sys` on the calling thread at `hz` CPU-time samples per
+// second. "%p" in `path` is replaced by the process id. NULL on failure.
+profiler_t *prof_start(system_8051_t *sys, const char *path, unsigned hz);
+
+// Stops the timer, writes the profile and frees the profiler
+void prof_stop(profiler_t *prof);
+
+#endif
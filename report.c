@@ -0,0 +1,185 @@
+// Headless state output: the same fields as print_state(), as JSON lines or CSV
+#include <string.h>
+#include "report.h"
+#include "opcodes.h"
+#include "sym.h"
+
+typedef struct {
+    const char *name;
+    uint64_t value;
+} report_field_t;
+
+#define REPORT_FIELDS 32
+
+static void collect(system_8051_t *sys, report_field_t *f) {
+    uint8_t bank = sys->cpu.PSW & (PSW_RS1 | PSW_RS0);
+    static const char *rn[8] = { "r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7" };
+    int n = 0;
+
+    f[n++] = (report_field_t){ "instructions", sys->cpu.instructions };
+    f[n++] = (report_field_t){ "cycles", sys->cpu.cycles };
+    f[n++] = (report_field_t){ "pc", sys->cpu.PC };
+    f[n++] = (report_field_t){ "a", sys->cpu.A };
+    f[n++] = (report_field_t){ "b", sys->cpu.B };
+    f[n++] = (report_field_t){ "psw", sys->cpu.PSW };
+    f[n++] = (report_field_t){ "sp", sys->cpu.SP };
+    f[n++] = (report_field_t){ "dptr", sys->cpu.DPTR };
+    for (int i = 0; i < 8; i++) f[n++] = (report_field_t){ rn[i], sys->iram[bank + i] };
+    f[n++] = (report_field_t){ "tcon", sys->sfr.TCON };
+    f[n++] = (report_field_t){ "tmod", sys->sfr.TMOD };
+    f[n++] = (report_field_t){ "tl0", sys->sfr.TL0 };
+    f[n++] = (report_field_t){ "th0", sys->sfr.TH0 };
+    f[n++] = (report_field_t){ "tl1", sys->sfr.TL1 };
+    f[n++] = (report_field_t){ "th1", sys->sfr.TH1 };
+    f[n++] = (report_field_t){ "scon", sys->sfr.SCON };
+    f[n++] = (report_field_t){ "sbuf", sys->sfr.SBUF };
+    f[n++] = (report_field_t){ "ie", sys->sfr.IE };
+    f[n++] = (report_field_t){ "ip", sys->sfr.IP };
+    f[n++] = (report_field_t){ "pcon", sys->sfr.PCON };
+    f[n++] = (report_field_t){ "p0", sys->sfr.P0 };
+    f[n++] = (report_field_t){ "p1", sys->sfr.P1 };
+    f[n++] = (report_field_t){ "p2", sys->sfr.P2 };
+    f[n++] = (report_field_t){ "p3", sys->sfr.P3 };
+    f[n++] = (report_field_t){ "irq_depth", sys->irq.depth };
+}
+
+int report_open(report_t *rep, const char *path, const char *format) {
+    memset(rep, 0, sizeof(*rep));
+
+    if (format == NULL || strcmp(format, "json") == 0) rep->format = REPORT_JSON;
+    else if (strcmp(format, "csv") == 0) rep->format = REPORT_CSV;
+    else {
+        printf("Unknown output format %s (use json or csv)\n", format);
+        return 1;
+    }
+
+    if (path == NULL || strcmp(path, "-") == 0) {
+        rep->out = stdout;
+    }
+    else {
+        rep->out = fopen(path, "w");
+        if (rep->out == NULL) {
+            printf("Could not open %s for writing\n", path);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void report_state(report_t *rep, system_8051_t *sys, const char *event) {
+    report_field_t f[REPORT_FIELDS];
+    collect(sys, f);
+
+    // PC by name, with symbols loaded
+    char symbol[64] = "";
+    if (sys->syms) sym_format(sys->syms, SYM_CODE, sys->cpu.PC, symbol, sizeof(symbol));
+
+    if (rep->format == REPORT_CSV) {
+        if (!rep->header_done) {
+            fprintf(rep->out, "event");
+            for (int i = 0; i < REPORT_FIELDS; i++) fprintf(rep->out, ",%s", f[i].name);
+            fprintf(rep->out, sys->syms ? ",symbol\n" : "\n");
+            rep->header_done = 1;
+        }
+        fprintf(rep->out, "%s", event);
+        for (int i = 0; i < REPORT_FIELDS; i++) fprintf(rep->out, ",%lu", f[i].value);
+        if (sys->syms) fprintf(rep->out, ",%s", symbol);
+        fprintf(rep->out, "\n");
+    }
+    else {
+        fprintf(rep->out, "{\"event\":\"%s\"", event);
+        for (int i = 0; i < REPORT_FIELDS; i++) fprintf(rep->out, ",\"%s\":%lu", f[i].name, f[i].value);
+        if (sys->syms) fprintf(rep->out, ",\"symbol\":\"%s\"", symbol);
+        fprintf(rep->out, "}\n");
+    }
+}
+
+void report_close(report_t *rep) {
+    if (rep->out == NULL) return;
+    if (rep->out == stdout) fflush(stdout);
+    else fclose(rep->out);
+    rep->out = NULL;
+}
+
+void print_state(system_8051_t *sys) {
+    // 1. Decode PSW (Flags)
+    char psw_str[9] = "--------";
+    if (sys->cpu.PSW & 0x80) psw_str[0] = 'C'; // Carry
+    if (sys->cpu.PSW & 0x40) psw_str[1] = 'A'; // Aux Carry
+    if (sys->cpu.PSW & 0x20) psw_str[2] = 'F'; // Flag 0
+    if (sys->cpu.PSW & 0x04) psw_str[5] = 'V'; // Overflow
+    if (sys->cpu.PSW & 0x01) psw_str[7] = 'P'; // Parity
+
+    //Decode Register Bank (R0-R7)
+    uint8_t bank_num = (sys->cpu.PSW & 0x18) >> 3;
+    uint8_t bank_addr = bank_num * 8;
+    
+    //Decode Timers (Logic Updated for Mode 3)
+    uint8_t t0_mode = sys->sfr.TMOD & 0x03;
+    uint8_t t1_mode = (sys->sfr.TMOD >> 4) & 0x03;
+
+    char t0_val_str[20];
+    char t0_status_str[20];
+    char t1_val_str[20];
+    char t1_status_str[20];
+
+    // --- TIMER 0 HANDLING ---
+    if (t0_mode == 3) {
+        // Mode 3: Split Timer. TL0 uses TR0, TH0 uses TR1.
+        sprintf(t0_val_str, "TL:%02X TH:%02X", sys->sfr.TL0, sys->sfr.TH0);
+        sprintf(t0_status_str, "TR0:%d TR1:%d", 
+               (sys->sfr.TCON & 0x10) ? 1 : 0, 
+               (sys->sfr.TCON & 0x40) ? 1 : 0);
+    } 
+    else {
+        // Standard Modes (0, 1, 2)
+        uint16_t val = ((uint16_t)sys->sfr.TH0 << 8) | sys->sfr.TL0;
+        sprintf(t0_val_str, "0x%04X     ", val);
+        sprintf(t0_status_str, "%s       ", (sys->sfr.TCON & 0x10) ? "RUN" : "STP");
+    }
+
+    uint16_t t1_val = ((uint16_t)sys->sfr.TH1 << 8) | sys->sfr.TL1;
+    sprintf(t1_val_str, "0x%04X     ", t1_val);
+    
+    if (t0_mode == 3) {
+        sprintf(t1_status_str, "No Int(Baud)"); 
+    } else {
+        sprintf(t1_status_str, "%s       ", (sys->sfr.TCON & 0x40) ? "RUN" : "STP");
+    }
+
+
+    printf("\n");
+    printf("====================================================================\n");
+    uint8_t code[3];
+    char disasm[32];
+    for (int i = 0; i < 3; i++) code[i] = system_read_code(sys, sys->cpu.PC + i);
+    opcode_disasm(code, sys->cpu.PC, disasm, sizeof(disasm));
+
+    printf(" SYSTEM TIME: %-10lu CYCLES  |  PC: 0x%04X  |  OPCODE: 0x%02X  %s\n", 
+           sys->cpu.cycles, sys->cpu.PC, code[0], disasm);
+    printf("====================================================================\n");
+
+    // --- TABLE 1: CPU CORE & REGISTERS (Removed Raw PSW Row) ---
+    printf("| CORE REGISTERS      | FLAGS: %s | ACTIVE BANK: %d (0x%02X)  |\n", psw_str, bank_num, bank_addr);
+    printf("|---------------------+------------------+-----------------------|\n");
+    printf("| A    : 0x%02X         | R0 : 0x%02X        | R4 : 0x%02X             |\n", sys->cpu.A, sys->iram[bank_addr+0], sys->iram[bank_addr+4]);
+    printf("| B    : 0x%02X         | R1 : 0x%02X        | R5 : 0x%02X             |\n", sys->cpu.B, sys->iram[bank_addr+1], sys->iram[bank_addr+5]);
+    printf("| SP   : 0x%02X         | R2 : 0x%02X        | R6 : 0x%02X             |\n", sys->cpu.SP, sys->iram[bank_addr+2], sys->iram[bank_addr+6]);
+    printf("| DPTR : 0x%04X       | R3 : 0x%02X        | R7 : 0x%02X             |\n", sys->cpu.DPTR, sys->iram[bank_addr+3], sys->iram[bank_addr+7]);
+    printf("|---------------------+------------------+-----------------------|\n");
+
+    // --- TABLE 2: TIMERS & INTERRUPTS (Dynamic Strings) ---
+    printf("\n| TIMERS & INTERRUPTS | TCON: 0x%02X       | TMOD: 0x%02X            |\n", sys->sfr.TCON, sys->sfr.TMOD);
+    printf("|---------------------+------------------+-----------------------|\n");
+    printf("| TIMER 0: %s|STATUS: %s| MODE: %d               |\n", t0_val_str, t0_status_str, t0_mode);
+    printf("| TIMER 1: %s|STATUS: %s| MODE: %d               |\n", t1_val_str, t1_status_str, t1_mode);
+    printf("| IE     : 0x%02X       | IP    : 0x%02X     |                       |\n", sys->sfr.IE, sys->sfr.IP);
+    printf("|---------------------+------------------+-----------------------|\n");
+
+    // --- TABLE 3: PORTS ---
+    printf("\n| I/O PORTS           |                                          |\n");
+    printf("|---------------------+------------------+-----------------------|\n");
+    printf("| P0: 0x%02X            | P1: 0x%02X         | P2: 0x%02X   | P3: 0x%02X |\n", 
+           sys->sfr.P0, sys->sfr.P1, sys->sfr.P2, sys->sfr.P3);
+    printf("====================================================================\n");
+}
@@ -0,0 +1,30 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <stdio.h>
+#include "system.h"
+
+// Machine-readable state records for headless runs
+typedef enum {
+    REPORT_JSON,        // One JSON object per line
+    REPORT_CSV          // Header line, then one row per record
+} report_format_t;
+
+typedef struct {
+    FILE *out;
+    report_format_t format;
+    int header_done;
+} report_t;
+
+// path NULL or "-" = stdout. format is "json" or "csv".
+int report_open(report_t *rep, const char *path, const char *format);
+
+// event names why the record was written ("periodic", "halt", "limit", ...)
+void report_state(report_t *rep, system_8051_t *sys, const char *event);
+
+void report_close(report_t *rep);
+
+// The state table the interactive prompt shows, on stdout
+void print_state(system_8051_t *sys);
+
+#endif
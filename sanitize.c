@@ -0,0 +1,80 @@
+// Shadow-memory checks: reporting and stack bookkeeping
+#include <stdio.h>
+#include <string.h>
+#include "system.h"
+
+static const char *kind_names[SAN_KINDS] = {
+    "uninitialized IRAM", "uninitialized XRAM", "no upper IRAM", "stack overflow", "stack underflow"
+};
+
+void sanitize_reset(system_8051_t *sys) {
+    memset(&sys->san, 0, sizeof(sys->san));
+    sys->san.stack_base = 0x07;
+    sys->san.banks_used = 0x01;
+}
+
+void sanitize_report(system_8051_t *sys, sanitize_kind_t kind, uint16_t address) {
+    sanitize_state_t *san = &sys->san;
+    san->found[kind]++;
+
+    // Once per byte: it counts as written from now on
+    if (kind == SAN_UNINIT_IRAM) sanitize_set_bit(san->iram_written, address);
+    if (kind == SAN_UNINIT_XRAM) sanitize_set_bit(san->xram_written, address);
+
+    if (san->printed >= SANITIZE_MAX_REPORTS) return;
+    san->printed++;
+
+    fprintf(stderr, "Sanitizer: PC 0x%04X: ", san->insn_pc);
+    switch (kind) {
+        case SAN_UNINIT_IRAM: fprintf(stderr, "read of IRAM 0x%02X before any write", address); break;
+        case SAN_UNINIT_XRAM: fprintf(stderr, "read of XRAM 0x%04X before any write", address); break;
+        case SAN_NO_UPPER_IRAM: fprintf(stderr, "access to IRAM 0x%02X, which the %s does not have", address, sys->variant->name); break;
+        case SAN_STACK_OVERFLOW: fprintf(stderr, "push to 0x%02X overwrites %s", address, address <= san->stack_base ? "the bottom of RAM (SP wrapped)" : "a register bank in use"); break;
+        case SAN_STACK_UNDERFLOW: fprintf(stderr, "pop from 0x%02X, at or below the stack base 0x%02X", address, san->stack_base); break;
+        default: break;
+    }
+    fprintf(stderr, " (%lu clocks)\n", sys->cpu.cycles);
+    if (san->printed == SANITIZE_MAX_REPORTS) fprintf(stderr, "Sanitizer: further findings are only counted\n");
+}
+
+// SP has just been incremented for the write
+void sanitize_stack_write(system_8051_t *sys) {
+    uint8_t sp = sys->cpu.SP;
+    if (sp <= sys->san.stack_base) sanitize_report(sys, SAN_STACK_OVERFLOW, sp);
+    else if (sp < 0x20 && ((sys->san.banks_used >> (sp >> 3)) & 1)) sanitize_report(sys, SAN_STACK_OVERFLOW, sp);
+}
+
+// The hardware LCALL of interrupt entry writes IRAM itself
+void sanitize_isr_push(system_8051_t *sys) {
+    uint8_t sp = sys->cpu.SP;
+    if (sys->variant->iram_size == 128 && sp >= 0x80) sanitize_report(sys, SAN_NO_UPPER_IRAM, sp);
+    else sanitize_stack_write(sys);
+    sanitize_set_bit(sys->san.iram_written, sp);
+}
+
+// SP still points at the byte being popped
+void sanitize_stack_read(system_8051_t *sys) {
+    if (sys->cpu.SP <= sys->san.stack_base) sanitize_report(sys, SAN_STACK_UNDERFLOW, sys->cpu.SP);
+}
+
+void sanitize_set_sp(system_8051_t *sys, uint8_t sp) {
+    sys->san.stack_base = sp;
+}
+
+void sanitize_set_psw(system_8051_t *sys, uint8_t psw) {
+    sys->san.banks_used |= 1 << ((psw >> 3) & 0x03);
+}
+
+uint64_t sanitize_findings(system_8051_t *sys) {
+    uint64_t total = 0;
+    for (int k = 0; k < SAN_KINDS; k++) total += sys->san.found[k];
+    return total;
+}
+
+void sanitize_print_stats(system_8051_t *sys) {
+    printf("\n| SANITIZER           | %lu findings\n", sanitize_findings(sys));
+    printf("|---------------------+--------------------------------------------\n");
+    for (int k = 0; k < SAN_KINDS; k++) {
+        printf("| %-19s : %lu\n", kind_names[k], sys->san.found[k]);
+    }
+}
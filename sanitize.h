@@ -0,0 +1,67 @@
+#ifndef SANITIZE_H
+#define SANITIZE_H
+
+#include <stdint.h>
+
+// Shadow-memory checks for firmware bugs, compiled in with -DEMU_SANITIZE
+// (make SANITIZE=1). One shadow bit per IRAM and XRAM byte records whether
+// it was ever written, and the stack pointer is followed against the base
+// software gave it. Reported:
+//   - reads of IRAM or XRAM bytes never written since reset
+//   - @Ri or stack accesses above 0x7F on cores with 128 bytes of IRAM
+//   - pushes that wrap past the top of RAM or land in a register bank the
+//     program has selected, and pops below the stack base
+// Each finding is printed once (the byte then counts as written) to stderr.
+// The state is part of system_8051_t in every build so that the layout does
+// not depend on the flag; without it, nothing reads or updates it.
+
+#ifdef EMU_SANITIZE
+#define SANITIZE(...) do { __VA_ARGS__; } while (0)
+#else
+#define SANITIZE(...) do { } while (0)
+#endif
+
+#define SANITIZE_MAX_REPORTS 64     // Printed; further findings are only counted
+
+typedef enum {
+    SAN_UNINIT_IRAM,
+    SAN_UNINIT_XRAM,
+    SAN_NO_UPPER_IRAM,
+    SAN_STACK_OVERFLOW,
+    SAN_STACK_UNDERFLOW,
+    SAN_KINDS
+} sanitize_kind_t;
+
+typedef struct {
+    uint64_t iram_written[256 / 64];
+    uint64_t xram_written[65536 / 64];
+    uint8_t stack_base;         // Last SP software set (0x07 at reset)
+    uint8_t banks_used;         // Bit n: register bank n was selected
+    uint16_t insn_pc;           // Start of the instruction being executed
+    uint64_t found[SAN_KINDS];
+    uint64_t printed;
+} sanitize_state_t;
+
+typedef struct system_8051 system_8051_t;
+
+// Slow paths and bookkeeping (sanitize.c)
+void sanitize_reset(system_8051_t *sys);
+void sanitize_report(system_8051_t *sys, sanitize_kind_t kind, uint16_t address);
+void sanitize_stack_write(system_8051_t *sys);
+void sanitize_stack_read(system_8051_t *sys);
+void sanitize_isr_push(system_8051_t *sys);
+void sanitize_set_sp(system_8051_t *sys, uint8_t sp);
+void sanitize_set_psw(system_8051_t *sys, uint8_t psw);
+uint64_t sanitize_findings(system_8051_t *sys);
+void sanitize_print_stats(system_8051_t *sys);
+
+// Fast paths: a single word load and bit test
+static inline int sanitize_bit(const uint64_t *map, uint32_t index) {
+    return (map[index >> 6] >> (index & 63)) & 1;
+}
+
+static inline void sanitize_set_bit(uint64_t *map, uint32_t index) {
+    map[index >> 6] |= 1ULL << (index & 63);
+}
+
+#endif
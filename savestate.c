@@ -0,0 +1,135 @@
+// Save states: writing them and mapping them back
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "savestate.h"
+
+#define XRAM_PAGE_SIZE (1 << XDATA_PAGE_SHIFT)
+
+static uint8_t variant_id(const system_8051_t *sys) {
+    return (uint8_t)(sys->variant - cpu_variant_get(CPU_8051));
+}
+
+// The 64K code view the CPU fetches from, a word at a time in four
+// independent lanes. aot_rom_hash() goes byte by byte and would cost more
+// than the rest of a restore many times over.
+static uint64_t code_hash(const system_8051_t *sys) {
+    uint32_t internal = sys->EA ? sys->variant->rom_size : 0;     // A multiple of 32
+    uint64_t lane[4] = { 1, 2, 3, 4 };
+    for (uint32_t addr = 0; addr < 65536; addr += 32) {
+        const uint8_t *mem = addr < internal ? sys->irom : sys->xrom;
+        for (int l = 0; l < 4; l++) {
+            uint64_t word;
+            memcpy(&word, mem + addr + l * 8, 8);
+            lane[l] = (lane[l] ^ word) * 0x9E3779B97F4A7C15ull;
+            lane[l] ^= lane[l] >> 29;
+        }
+    }
+    return lane[0] ^ (lane[1] << 16 | lane[1] >> 48) ^ (lane[2] << 32 | lane[2] >> 32) ^ (lane[3] << 48 | lane[3] >> 16);
+}
+
+int savestate_save(system_8051_t *sys, const char *path) {
+    savestate_t state;
+    memset(&state, 0, sizeof(state));
+    state.magic = SAVESTATE_MAGIC;
+    state.version = SAVESTATE_VERSION;
+    state.header_size = sizeof(savestate_t);
+    state.code_hash = code_hash(sys);
+    state.variant = variant_id(sys);
+    state.EA = sys->EA;
+
+    // Trailing zero pages are left out: most programs touch little XRAM
+    uint32_t pages = XDATA_PAGES;
+    while (pages > 0) {
+        const uint8_t *page = &sys->xram[(pages - 1) * XRAM_PAGE_SIZE];
+        if (page[0] != 0 || memcmp(page, page + 1, XRAM_PAGE_SIZE - 1) != 0) break;
+        pages--;
+    }
+    state.xram_pages = pages;
+
+    state.cpu = sys->cpu;
+    state.sfr = sys->sfr;
+    state.irq = sys->irq;
+    state.uart = sys->uart;
+    state.uart.txq = NULL;
+    state.uart.rxq = NULL;
+    state.san = sys->san;
+    memcpy(state.iram, sys->iram, sizeof(state.iram));
+
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "wb");
+    if (f == NULL) {
+        printf("Error: Could not open %s for writing\n", tmp);
+        return 1;
+    }
+    int err = fwrite(&state, sizeof(state), 1, f) != 1;
+    if (pages) err |= fwrite(sys->xram, (size_t)pages * XRAM_PAGE_SIZE, 1, f) != 1;
+    err |= fclose(f) != 0;
+    if (err || rename(tmp, path) != 0) {
+        printf("Error: Could not write %s\n", path);
+        unlink(tmp);
+        return 1;
+    }
+    return 0;
+}
+
+int savestate_load(system_8051_t *sys, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("Error: Could not open %s\n", path);
+        return 1;
+    }
+
+    const char *problem = NULL;
+    struct stat st;
+    const savestate_t *state = NULL;
+    if (fstat(fd, &st) != 0) problem = "cannot stat";
+    else if ((size_t)st.st_size < sizeof(savestate_t)) problem = "not a save state";
+    else {
+        state = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (state == MAP_FAILED) {
+            state = NULL;
+            problem = "cannot map";
+        }
+    }
+    close(fd);
+
+    if (problem == NULL) {
+        if (state->magic != SAVESTATE_MAGIC) problem = "not a save state";
+        else if (state->version != SAVESTATE_VERSION || state->header_size != sizeof(savestate_t)) problem = "saved by an incompatible build";
+        else if (state->xram_pages > XDATA_PAGES || (size_t)st.st_size != sizeof(savestate_t) + (size_t)state->xram_pages * XRAM_PAGE_SIZE) problem = "truncated";
+        else if (state->variant != variant_id(sys)) problem = "saved on a different core variant";
+        else if (state->code_hash != code_hash(sys)) problem = "saved from a different ROM image";
+    }
+    if (problem) {
+        printf("Error: Not restoring %s: %s\n", path, problem);
+        if (state) munmap((void *)state, st.st_size);
+        return 1;
+    }
+
+    // The host side (queues, page map, attachments) stays as it is
+    spsc_t *txq = sys->uart.txq;
+    spsc_t *rxq = sys->uart.rxq;
+    sys->cpu = state->cpu;
+    sys->sfr = state->sfr;
+    sys->irq = state->irq;
+    sys->uart = state->uart;
+    sys->uart.txq = txq;
+    sys->uart.rxq = rxq;
+    sys->san = state->san;
+    sys->EA = state->EA;
+    memcpy(sys->iram, state->iram, sizeof(sys->iram));
+
+    size_t xram_bytes = (size_t)state->xram_pages * XRAM_PAGE_SIZE;
+    memcpy(sys->xram, state + 1, xram_bytes);
+    memset(sys->xram + xram_bytes, 0, sizeof(sys->xram) - xram_bytes);
+    munmap((void *)state, st.st_size);
+
+    // Nothing half-done is left from the session before the restore
+    sys->dbg.stop = 0;
+    return 0;
+}
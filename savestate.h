@@ -0,0 +1,51 @@
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#include <stdint.h>
+#include "system.h"
+
+// Save states: the machine at one instant, so that runs can start past a
+// long boot instead of replaying it. A file is a fixed header holding the
+// core, SFRs, interrupt controller, serial port, shadow memory and IRAM as
+// they sit in system_8051_t, followed by XRAM up to its last nonzero page.
+// Restoring maps the file and copies those few blocks back: no parsing.
+//
+// Code memory is not stored. The state records a hash of the code view and
+// the core variant instead, and only restores over the same image on the
+// same core.
+// What belongs to the host side is left as the target system has it: the
+// XDATA page map (device callbacks), breakpoints and watchpoints, the
+// serial queues, and the portlog/aot/cosim/cover/syms/journal attachments.
+//
+// The layout is the in-memory one of this build. SAVESTATE_VERSION changes
+// with any of the structs above; header_size catches most forgotten bumps.
+
+#define SAVESTATE_MAGIC   0x31355353u   // "SS51"
+#define SAVESTATE_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;       // sizeof(savestate_t)
+    uint8_t variant;            // cpu_variant_id_t
+    uint8_t EA;
+    uint16_t xram_pages;        // Pages of XRAM after the header; the rest is zero
+    uint64_t code_hash;
+
+    cpu_core_t cpu;
+    peripherals_t sfr;
+    irq_state_t irq;
+    uart_state_t uart;          // txq/rxq are not restored
+    sanitize_state_t san;
+    uint8_t iram[256];
+} savestate_t;
+
+// Written to a temporary file and renamed over `path`, so that readers
+// never see half a state. Returns 0 on success.
+int savestate_save(system_8051_t *sys, const char *path);
+
+// Restores a state saved from the code now loaded. Returns 0 on success;
+// on failure prints why and leaves the system untouched.
+int savestate_load(system_8051_t *sys, const char *path);
+
+#endif
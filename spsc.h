@@ -0,0 +1,106 @@
+#ifndef SPSC_H
+#define SPSC_H
+
+// Lock-free single-producer / single-consumer ring buffer.
+// One thread may push, one other thread may pop; no locks, no syscalls.
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define SPSC_CACHE_LINE 64
+
+typedef struct {
+    _Atomic size_t head;        // Next slot to write (producer owned)
+    size_t tail_cache;          // Producer's last view of tail
+    char pad0[SPSC_CACHE_LINE - sizeof(size_t) * 2];
+
+    _Atomic size_t tail;        // Next slot to read (consumer owned)
+    size_t head_cache;          // Consumer's last view of head
+    char pad1[SPSC_CACHE_LINE - sizeof(size_t) * 2];
+
+    size_t mask;                // capacity - 1 (capacity is a power of two)
+    size_t elem_size;
+    uint8_t *buf;
+} spsc_t;
+
+// capacity is rounded up to a power of two. Returns 0 on success.
+static inline int spsc_init(spsc_t *q, size_t elem_size, size_t capacity) {
+    size_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+
+    memset(q, 0, sizeof(*q));
+    q->buf = (uint8_t *)malloc(cap * elem_size);
+    if (q->buf == NULL) return 1;
+    q->mask = cap - 1;
+    q->elem_size = elem_size;
+    return 0;
+}
+
+static inline void spsc_free(spsc_t *q) {
+    free(q->buf);
+    q->buf = NULL;
+}
+
+// Returns 0 if the queue is full
+static inline int spsc_push(spsc_t *q, const void *elem) {
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    if (head - q->tail_cache > q->mask) {
+        q->tail_cache = atomic_load_explicit(&q->tail, memory_order_acquire);
+        if (head - q->tail_cache > q->mask) return 0;
+    }
+    memcpy(q->buf + (head & q->mask) * q->elem_size, elem, q->elem_size);
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return 1;
+}
+
+// Returns 0 if the queue is empty
+static inline int spsc_pop(spsc_t *q, void *elem) {
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    if (tail == q->head_cache) {
+        q->head_cache = atomic_load_explicit(&q->head, memory_order_acquire);
+        if (tail == q->head_cache) return 0;
+    }
+    memcpy(elem, q->buf + (tail & q->mask) * q->elem_size, q->elem_size);
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+// Consumer side: peeks at the next element without removing it
+static inline void *spsc_front(spsc_t *q) {
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    if (tail == q->head_cache) {
+        q->head_cache = atomic_load_explicit(&q->head, memory_order_acquire);
+        if (tail == q->head_cache) return NULL;
+    }
+    return q->buf + (tail & q->mask) * q->elem_size;
+}
+
+// Approximate fill level; exact when called from either owner thread while the other is idle
+static inline size_t spsc_count(spsc_t *q) {
+    return atomic_load_explicit(&q->head, memory_order_acquire) -
+           atomic_load_explicit(&q->tail, memory_order_acquire);
+}
+
+// Bulk variants for byte streams (elem_size == 1). Return the number of bytes moved.
+static inline size_t spsc_push_bytes(spsc_t *q, const uint8_t *src, size_t len) {
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    size_t space = (q->mask + 1) - (head - tail);
+    if (len > space) len = space;
+    for (size_t i = 0; i < len; i++) q->buf[(head + i) & q->mask] = src[i];
+    atomic_store_explicit(&q->head, head + len, memory_order_release);
+    return len;
+}
+
+static inline size_t spsc_pop_bytes(spsc_t *q, uint8_t *dst, size_t len) {
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+    size_t avail = head - tail;
+    if (len > avail) len = avail;
+    for (size_t i = 0; i < len; i++) dst[i] = q->buf[(tail + i) & q->mask];
+    atomic_store_explicit(&q->tail, tail + len, memory_order_release);
+    return len;
+}
+
+#endif
@@ -0,0 +1,366 @@
+// Symbol tables: loaders for the toolchain formats and the interval index
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "sym.h"
+
+static const uint32_t space_size[SYM_SPACES] = { 65536, 256, 65536 };
+
+symtab_t *sym_create(void) {
+    return calloc(1, sizeof(symtab_t));
+}
+
+void sym_free(symtab_t *tab) {
+    if (tab == NULL) return;
+    for (int s = 0; s < SYM_SPACES; s++) {
+        for (uint32_t i = 0; i < tab->space[s].count; i++) free((char *)tab->space[s].syms[i].name);
+        free(tab->space[s].syms);
+    }
+    free(tab);
+}
+
+// end 0 = size unknown
+static int sym_add(symtab_t *tab, sym_space_t space, uint32_t start, uint32_t end, const char *name) {
+    sym_index_t *index = &tab->space[space];
+    if (start >= space_size[space] || name[0] == '\0') return 0;
+    if (index->count == index->capacity) {
+        uint32_t capacity = index->capacity ? index->capacity * 2 : 256;
+        sym_t *syms = realloc(index->syms, capacity * sizeof(sym_t));
+        if (syms == NULL) return 1;
+        index->syms = syms;
+        index->capacity = capacity;
+    }
+    char *copy = strdup(name);
+    if (copy == NULL) return 1;
+    index->syms[index->count++] = (sym_t){ start, end > start ? end : 0, copy };
+    return 0;
+}
+
+// Same start: a symbol with a known size wins, then the smaller name, so
+// the result does not depend on the order files were given in
+static int compare_syms(const void *a, const void *b) {
+    const sym_t *x = a, *y = b;
+    if (x->start != y->start) return x->start < y->start ? -1 : 1;
+    if ((x->end != 0) != (y->end != 0)) return x->end ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+// Sorts, drops duplicates, makes the intervals disjoint and fills the page
+// table. Unknown ends become the start of the next symbol.
+static void sym_reindex(sym_index_t *index, uint32_t size) {
+    qsort(index->syms, index->count, sizeof(sym_t), compare_syms);
+
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < index->count; i++) {
+        if (n > 0 && index->syms[n - 1].start == index->syms[i].start) {
+            free((char *)index->syms[i].name);
+            continue;
+        }
+        index->syms[n++] = index->syms[i];
+    }
+    index->count = n;
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t next = i + 1 < n ? index->syms[i + 1].start : size;
+        sym_t *sym = &index->syms[i];
+        if (sym->end == 0 || sym->end > next) sym->end = next;
+    }
+
+    uint32_t first = 0, last = 0;
+    for (uint32_t p = 0; p < SYM_PAGES; p++) {
+        uint32_t page = p << 8;
+        while (first < n && index->syms[first].end <= page) first++;
+        while (last < n && index->syms[last].start < page + 256) last++;
+        index->first[p] = first;
+        index->last[p] = last;
+    }
+}
+
+const sym_t *sym_lookup(const symtab_t *tab, sym_space_t space, uint32_t address) {
+    if (tab == NULL || address >= space_size[space]) return NULL;
+    const sym_index_t *index = &tab->space[space];
+    uint32_t lo = index->first[address >> 8], hi = index->last[address >> 8];
+
+    // Last symbol starting at or before the address
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (index->syms[mid].start <= address) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == index->first[address >> 8]) return NULL;
+    const sym_t *sym = &index->syms[lo - 1];
+    return address < sym->end ? sym : NULL;
+}
+
+int sym_format(const symtab_t *tab, sym_space_t space, uint32_t address, char *out, size_t size) {
+    const sym_t *sym = sym_lookup(tab, space, address);
+    if (sym == NULL) return snprintf(out, size, "0x%04X", address);
+    if (address == sym->start) return snprintf(out, size, "%s", sym->name);
+    return snprintf(out, size, "%s+0x%X", sym->name, address - sym->start);
+}
+
+// SDCC LINKER MAPS
+// Symbol lines follow the areas they belong to:
+//   CSEG      00000062    0000002B =    43. bytes (REL,CON,CODE)
+//        C:  00000062  _main                 main
+// Older linkers print no space letter; the area attributes tell the space.
+static int space_letter(char letter, sym_space_t *space) {
+    switch (letter) {
+        case 'C': *space = SYM_CODE; return 1;
+        case 'D': case 'I': *space = SYM_IRAM; return 1;
+        case 'X': *space = SYM_XRAM; return 1;
+        default: return 0;      // Bits, registers
+    }
+}
+
+static int load_map(symtab_t *tab, FILE *in) {
+    char buf[512];
+    int area_space = -1;
+    while (fgets(buf, sizeof(buf), in)) {
+        char first[64], second[64], third[128];
+        int n = sscanf(buf, "%63s %63s %127s", first, second, third);
+        if (n < 2) continue;
+
+        char *attrs = strchr(buf, '(');
+        if (attrs && strstr(buf, "bytes")) {
+            if (strstr(attrs, "XDATA")) area_space = SYM_XRAM;
+            else if (strstr(attrs, "CODE")) area_space = SYM_CODE;
+            else if (strstr(attrs, "DATA")) area_space = SYM_IRAM;
+            else area_space = -1;
+            continue;
+        }
+
+        sym_space_t space;
+        const char *value = first, *name = second;
+        if (strlen(first) == 2 && first[1] == ':') {
+            if (n < 3 || !space_letter(first[0], &space)) continue;
+            value = second;
+            name = third;
+        }
+        else if (area_space >= 0) space = area_space;
+        else continue;
+
+        size_t digits = strspn(value, "0123456789ABCDEFabcdef");
+        if (value[digits] != '\0' || (digits != 4 && digits != 8)) continue;
+        if (!(isalpha((unsigned char)name[0]) || name[0] == '_' || name[0] == '.')) continue;
+        if (strncmp(name, "s_", 2) == 0 || strncmp(name, "l_", 2) == 0) continue;     // Area start/length
+        if (sym_add(tab, space, strtoul(value, NULL, 16), 0, name)) return 1;
+    }
+    return 0;
+}
+
+// NOICE COMMAND FILES: "DEF name value"; the other commands are ignored
+static int load_noi(symtab_t *tab, FILE *in) {
+    char buf[512];
+    while (fgets(buf, sizeof(buf), in)) {
+        char name[256];
+        long value;
+        if (sscanf(buf, "DEF %255s %li", name, &value) != 2 || value < 0) continue;
+        if (sym_add(tab, SYM_CODE, value, 0, name)) return 1;
+    }
+    return 0;
+}
+
+// SDCC DEBUG FILES
+// L:G$main$0$0:62        start of a global (F<module>$ for statics,
+// L:XG$main$0$0:8C       last byte of a function  L<function>$ for locals)
+// S:G$main$0$0({2}DF,SV:S),C,0,0    the address space follows "),"
+typedef struct {
+    char *key;
+    char space;
+} cdb_space_t;
+
+static int compare_keys(const void *a, const void *b) {
+    return strcmp(((const cdb_space_t *)a)->key, ((const cdb_space_t *)b)->key);
+}
+
+static int cdb_space(char letter, sym_space_t *space) {
+    switch (letter) {
+        case 'C': case 'D': *space = SYM_CODE; return 1;
+        case 'B': case 'E': case 'G': *space = SYM_IRAM; return 1;
+        case 'A': case 'F': *space = SYM_XRAM; return 1;
+        default: return 0;      // SFRs, bits, registers
+    }
+}
+
+// "G$main$0$0" -> "main", "Lmain$i$1$1" -> "main.i"
+static void cdb_name(const char *key, char *out, size_t size) {
+    char scope[128] = "", name[128] = "";
+    if (key[0] == 'G') sscanf(key, "G$%127[^$]", name);
+    else if (key[0] == 'F') sscanf(key, "F%*[^$]$%127[^$]", name);
+    else if (key[0] == 'L' && sscanf(key, "L%127[^$]$%127[^$]", scope, name) == 2) {
+        snprintf(out, size, "%s.%s", scope, name);
+        return;
+    }
+    snprintf(out, size, "%s", name);
+}
+
+static int load_cdb(symtab_t *tab, FILE *in) {
+    char buf[1024];
+    cdb_space_t *spaces = NULL;
+    size_t count = 0, capacity = 0;
+    int err = 0;
+
+    while (!err && fgets(buf, sizeof(buf), in)) {
+        char *paren = strstr(buf, "),");
+        if (strncmp(buf, "S:", 2) != 0 || paren == NULL) continue;
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            cdb_space_t *grown = realloc(spaces, capacity * sizeof(cdb_space_t));
+            if (grown == NULL) {
+                err = 1;
+                break;
+            }
+            spaces = grown;
+        }
+        char *end = strchr(buf + 2, '(');
+        spaces[count].key = strndup(buf + 2, end - (buf + 2));
+        spaces[count].space = paren[2];
+        err = spaces[count++].key == NULL;
+    }
+    if (count) qsort(spaces, count, sizeof(cdb_space_t), compare_keys);
+
+    // Functions are added once both ends are known
+    rewind(in);
+    while (!err && fgets(buf, sizeof(buf), in)) {
+        char key[256];
+        unsigned address;
+        if (sscanf(buf, "L:%255[^:]:%x", key, &address) != 2) continue;
+
+        int is_end = key[0] == 'X';
+        cdb_space_t probe = { key + is_end, 0 };
+        cdb_space_t *found = count ? bsearch(&probe, spaces, count, sizeof(cdb_space_t), compare_keys) : NULL;
+        sym_space_t space;
+        if (found == NULL || !cdb_space(found->space, &space)) continue;   // Line records, SFRs, ...
+
+        char name[256];
+        cdb_name(key + is_end, name, sizeof(name));
+        if (is_end) {
+            // Closes the function opened by its start record
+            sym_index_t *index = &tab->space[space];
+            for (uint32_t i = index->count; i-- > 0; ) {
+                if (strcmp(index->syms[i].name, name) == 0) {
+                    if (address + 1 > index->syms[i].start) index->syms[i].end = address + 1;
+                    break;
+                }
+            }
+        }
+        else err = sym_add(tab, space, address, 0, name);
+    }
+
+    for (size_t i = 0; i < count; i++) free(spaces[i].key);
+    free(spaces);
+    return err;
+}
+
+// OMF-51 ABSOLUTE OBJECTS
+// Records are a type byte, a 16-bit little-endian length and the contents,
+// whose last byte is a checksum. Symbols come from DEBUG ITEMS (0x12; local
+// and public lists) and PUBLIC DEFINITIONS (0x16), as
+//   SEG ID, SYM INFO, OFFSET (2), unused, name (length-prefixed)
+// Only absolute symbols (SEG ID 0) are placed; SYM INFO bits 2-0 give the
+// space.
+#define OMF_MODULE_HEADER  0x02
+#define OMF_DEBUG_ITEMS    0x12
+#define OMF_PUBLIC_DEFS    0x16
+
+static int omf_symbols(symtab_t *tab, const uint8_t *p, const uint8_t *end) {
+    while (end - p >= 6) {
+        uint8_t seg = p[0], info = p[1], length = p[5];
+        uint16_t offset = p[2] | p[3] << 8;
+        if (end - p < 6 + length) break;
+
+        char name[256];
+        memcpy(name, p + 6, length);
+        name[length] = '\0';
+        p += 6 + length;
+
+        static const int spaces[8] = { SYM_CODE, SYM_XRAM, SYM_IRAM, SYM_IRAM, -1, -1, -1, -1 };
+        if (seg != 0 || spaces[info & 0x07] < 0) continue;
+        if (sym_add(tab, spaces[info & 0x07], offset, 0, name)) return 1;
+    }
+    return 0;
+}
+
+static int load_omf(symtab_t *tab, FILE *in) {
+    uint8_t header[3];
+    uint8_t *record = malloc(65536);
+    int err = record == NULL;
+    while (!err && fread(header, 1, 3, in) == 3) {
+        uint16_t length = header[1] | header[2] << 8;
+        if (fread(record, 1, length, in) != length || length == 0) break;
+        if (header[0] == OMF_DEBUG_ITEMS && length > 1 && record[0] <= 1) {
+            err = omf_symbols(tab, record + 1, record + length - 1);     // 0 local, 1 public
+        }
+        else if (header[0] == OMF_PUBLIC_DEFS) {
+            err = omf_symbols(tab, record, record + length - 1);
+        }
+    }
+    free(record);
+    return err;
+}
+
+typedef enum { FORMAT_MAP, FORMAT_NOI, FORMAT_CDB, FORMAT_OMF } sym_format_t;
+
+static sym_format_t detect(FILE *in) {
+    char buf[512];
+    int c = fgetc(in);
+    sym_format_t format = FORMAT_MAP;
+    if (c == OMF_MODULE_HEADER) format = FORMAT_OMF;
+    else {
+        ungetc(c, in);
+        for (int i = 0; i < 64 && fgets(buf, sizeof(buf), in); i++) {
+            if (strncmp(buf, "DEF ", 4) == 0) {
+                format = FORMAT_NOI;
+                break;
+            }
+            if (buf[1] == ':' && strchr("MSLFT", buf[0])) {
+                format = FORMAT_CDB;
+                break;
+            }
+        }
+    }
+    rewind(in);
+    return format;
+}
+
+int sym_load(symtab_t *tab, const char *path) {
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+        printf("Error: Could not open %s\n", path);
+        return 1;
+    }
+
+    uint32_t before[SYM_SPACES];
+    for (int s = 0; s < SYM_SPACES; s++) before[s] = tab->space[s].count;
+
+    int err;
+    switch (detect(in)) {
+        case FORMAT_OMF: err = load_omf(tab, in); break;
+        case FORMAT_NOI: err = load_noi(tab, in); break;
+        case FORMAT_CDB: err = load_cdb(tab, in); break;
+        default: err = load_map(tab, in); break;
+    }
+    fclose(in);
+
+    uint32_t added = 0;
+    for (int s = 0; s < SYM_SPACES; s++) {
+        sym_index_t *index = &tab->space[s];
+        if (err) {
+            for (uint32_t i = before[s]; i < index->count; i++) free((char *)index->syms[i].name);
+            index->count = before[s];
+        }
+        added += index->count - before[s];
+    }
+    if (err) {
+        printf("Error: Out of memory reading %s\n", path);
+        return 1;
+    }
+    if (added == 0) {
+        printf("Error: No symbols in %s\n", path);
+        return 1;
+    }
+    for (int s = 0; s < SYM_SPACES; s++) sym_reindex(&tab->space[s], space_size[s]);
+    return 0;
+}
@@ -0,0 +1,60 @@
+#ifndef SYM_H
+#define SYM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Symbol tables from the toolchain's outputs, for naming addresses in
+// profiles, state records and debugger messages. Accepted (detected from
+// the content):
+//   - SDCC linker maps (.map, aslink -m)
+//   - NoICE command files (.noi, DEF lines; code addresses)
+//   - SDCC debug files (.cdb, L: linker records placed through S: records)
+//   - OMF-51 absolute objects (Keil BL51 output, public and local symbols)
+// Every space keeps its symbols as sorted, disjoint intervals: a symbol
+// covers its known size, or the bytes up to the next symbol. A page table
+// over each space narrows a lookup to the few symbols of one 256-byte page,
+// so a lookup costs a short binary search whatever the table size.
+
+typedef enum {
+    SYM_CODE,
+    SYM_IRAM,           // Direct and indirect internal RAM
+    SYM_XRAM,
+    SYM_SPACES
+} sym_space_t;
+
+typedef struct {
+    uint32_t start;
+    uint32_t end;       // Exclusive
+    const char *name;
+} sym_t;
+
+#define SYM_PAGES 256   // Of 256 bytes: the 64K spaces
+
+typedef struct {
+    sym_t *syms;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t first[SYM_PAGES];  // First symbol that may hold an address of the page
+    uint32_t last[SYM_PAGES];   // One past the last such symbol
+} sym_index_t;
+
+typedef struct symtab {
+    sym_index_t space[SYM_SPACES];
+} symtab_t;
+
+symtab_t *sym_create(void);
+void sym_free(symtab_t *tab);
+
+// Adds the symbols of a file in any accepted format and rebuilds the index.
+// Returns 0 on success; on failure prints why and leaves the table as it was
+// before the file.
+int sym_load(symtab_t *tab, const char *path);
+
+// Symbol covering `address`, or NULL. NULL `tab` is allowed.
+const sym_t *sym_lookup(const symtab_t *tab, sym_space_t space, uint32_t address);
+
+// "name", "name+0x12", or the bare address in hex when no symbol covers it
+int sym_format(const symtab_t *tab, sym_space_t space, uint32_t address, char *out, size_t size);
+
+#endif
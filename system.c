@@ -1,4 +1,6 @@
 #include "system.h"
+#include "aot.h"
+#include "journal.h"
 #include <string.h> // for memset
 
 void system_reset(system_8051_t *sys) {
@@ -19,6 +21,14 @@ void system_reset(system_8051_t *sys) {
     
     // 4. Set Hardware Config
     sys->EA = 1;            // Default: Boot from Internal ROM
+    xdata_map_ram(sys, 0, XDATA_PAGES);
+    sys->variant = cpu_variant_get(CPU_8051);
+    sanitize_reset(sys);
+}
+
+void system_set_variant(system_8051_t *sys, const cpu_variant_t *variant) {
+    sys->variant = variant;
+    interrupt_update(sys);
 }
 
 // CODE FETCH (ROM)
@@ -30,7 +40,7 @@ uint8_t system_read_code(system_8051_t *sys, uint16_t address) {
     
     // IF EA Pin is High (1): Use Internal ROM for low addresses
     else {
-        if (address < INT_ROM_SIZE) {
+        if (address < sys->variant->rom_size) {
             return sys->irom[address];
         } else {
             return sys->xrom[address];
@@ -38,27 +48,151 @@ uint8_t system_read_code(system_8051_t *sys, uint16_t address) {
     }
 }
 
+// Code memory writes (loaders, debuggers), mapped the same way as fetches
+void system_write_code(system_8051_t *sys, uint16_t address, uint8_t value) {
+    if (sys->aot) aot_invalidate(sys->aot, address);
+    if (sys->EA != 0 && address < sys->variant->rom_size) sys->irom[address] = value;
+    else sys->xrom[address] = value;
+}
+
 // INTERNAL RAM (IRAM + SFR)
 uint8_t system_read_iram(system_8051_t *sys, uint8_t address) {
     if (address < 0x80) {
         return sys->iram[address]; // 0x00-0x7F: Direct RAM
     } else {
-        return 0; // TODO: Implement SFR Read Logic (Phase 2)
+        return sfr_read(sys, address); // 0x80-0xFF: SFRs
     }
 }
 
 void system_write_iram(system_8051_t *sys, uint8_t address, uint8_t value) {
     if (address < 0x80) {
         sys->iram[address] = value; // 0x00-0x7F: Direct RAM
-    } 
-    // TODO: Implement SFR Write Logic (Phase 2)
+    } else {
+        sfr_write(sys, address, value);
+    }
 }
 
 // EXTERNAL RAM (XRAM)
 uint8_t system_read_xram(system_8051_t *sys, uint16_t address) {
-    return sys->xram[address];
+    const xdata_page_t *page = &sys->xdata[address >> XDATA_PAGE_SHIFT];
+    if (page->mem) return page->mem[address & 0xFF];
+    return page->read ? page->read(page->ctx, address) : 0xFF;
 }
 
 void system_write_xram(system_8051_t *sys, uint16_t address, uint8_t value) {
-    sys->xram[address] = value;
-}
\ No newline at end of file
+    const xdata_page_t *page = &sys->xdata[address >> XDATA_PAGE_SHIFT];
+    if (page->mem) page->mem[address & 0xFF] = value;
+    else if (page->write) page->write(page->ctx, address, value);
+}
+
+// RUN HELPERS
+typedef void (*step_fn_t)(system_8051_t *sys);
+
+static inline uint64_t step_with(system_8051_t *sys, step_fn_t exec) {
+    uint64_t prev_cycles = sys->cpu.cycles;
+    exec(sys);
+    sys->cpu.instructions++;
+    uint64_t step_cycles = sys->cpu.cycles - prev_cycles;
+    peripherals_step(sys, step_cycles);
+    if (sys->irq.pending) interrupt_dispatch(sys);
+    else sys->irq.hold = 0;     // Lasts one instruction, whether or not a request came
+    return step_cycles;
+}
+
+// The variant's interpreter for the current watchpoint and coverage settings
+static inline step_fn_t step_for(system_8051_t *sys) {
+    if (sys->dbg.watch_count || sys->journal) return sys->variant->step_watch;     // Covers too
+    return sys->cover ? sys->variant->step_cover : sys->variant->step;
+}
+
+// IDLE AND POWER-DOWN
+// Nothing is fetched while PCON.IDL or PCON.PD is set. In idle the timers
+// and serial port keep running, so time jumps straight to the next event
+// that could raise an interrupt able to end it: peripherals_step() covers
+// any number of clocks exactly. In power-down the oscillator is stopped;
+// only the cycle count moves, and an external interrupt wakes the core (as
+// on most CMOS derivatives; the original NMOS part needed a reset).
+// Returns 0 when nothing can ever wake the core and there is no limit.
+#define IRQ_EXTERNAL ((1 << IRQ_INT0) | (1 << IRQ_INT1))
+
+static int system_sleep(system_8051_t *sys, uint64_t cycle_limit) {
+    int powered_down = sys->sfr.PCON & PCON_PD;
+    if (sys->irq.pending && (!powered_down || (sys->irq.live & IRQ_EXTERNAL))) {
+        interrupt_dispatch(sys);
+        return 1;
+    }
+
+    uint64_t clocks = powered_down ? RUN_NO_LIMIT : peripherals_next_event(sys, interrupt_wake_sources(sys));
+    if (clocks == RUN_NO_LIMIT && cycle_limit == RUN_NO_LIMIT) return 0;
+    if (clocks > cycle_limit - sys->cpu.cycles) clocks = cycle_limit - sys->cpu.cycles;
+
+    sys->cpu.cycles += clocks;
+    if (!powered_down) {
+        peripherals_step(sys, clocks);
+        if (sys->irq.pending) interrupt_dispatch(sys);
+    }
+    return 1;
+}
+
+uint64_t system_step(system_8051_t *sys) {
+    if (sys->sfr.PCON & PCON_SLEEP) {
+        uint64_t prev_cycles = sys->cpu.cycles;
+        system_sleep(sys, prev_cycles + sys->variant->cycle_clocks);
+        return sys->cpu.cycles - prev_cycles;
+    }
+    return step_with(sys, step_for(sys));
+}
+
+int system_halted(system_8051_t *sys) {
+    uint8_t op = system_read_code(sys, sys->cpu.PC);
+    uint8_t arg = system_read_code(sys, sys->cpu.PC + 1);
+    return (op == 0x80 && arg == 0xFE);
+}
+
+// Slow loop: breakpoints and/or watchpoints are set
+static run_result_t run_debug(system_8051_t *sys, uint64_t max_instructions, uint64_t cycle_limit) {
+    step_fn_t exec = step_for(sys);
+    uint64_t executed = 0;
+
+    sys->dbg.stop = 0;
+    while (executed < max_instructions && sys->cpu.cycles < cycle_limit) {
+        if (sys->sfr.PCON & PCON_SLEEP) {
+            if (!system_sleep(sys, cycle_limit)) return RUN_HALT;
+            continue;
+        }
+        if (executed > 0 && debug_is_breakpoint(&sys->dbg, sys->cpu.PC)) return RUN_BREAKPOINT;
+        if (system_halted(sys)) return RUN_HALT;
+        step_with(sys, exec);
+        executed++;
+        if (sys->dbg.stop) return RUN_WATCHPOINT;
+    }
+    return RUN_LIMIT;
+}
+
+run_result_t system_run(system_8051_t *sys, uint64_t max_instructions, uint64_t cycle_limit) {
+    if (sys->dbg.bp_count || sys->dbg.watch_count) {
+        return run_debug(sys, max_instructions, cycle_limit);
+    }
+
+    // Loaded once: the step function is the variant's specialised interpreter
+    step_fn_t exec = step_for(sys);
+    uint64_t executed = 0;
+    while (executed < max_instructions && sys->cpu.cycles < cycle_limit) {
+        if (sys->sfr.PCON & PCON_SLEEP) {
+            if (!system_sleep(sys, cycle_limit)) return RUN_HALT;
+            continue;
+        }
+        if (system_halted(sys)) return RUN_HALT;
+
+        // Translated block at PC: runs until control leaves it (coverage
+        // and journalled runs interpret everything)
+        aot_block_fn block = sys->aot && !sys->cover && !sys->journal ? sys->aot->table[sys->cpu.PC] : NULL;
+        if (block) {
+            executed += block(sys, max_instructions - executed, cycle_limit);
+            continue;
+        }
+        step_with(sys, exec);
+        executed++;
+    }
+    return RUN_LIMIT;
+}
@@ -3,41 +3,141 @@
 
 #include "cpu.h"
 #include "peripherals.h"
+#include "interrupt.h"
+#include "uart.h"
+#include "portlog.h"
+#include "debug.h"
+#include "xdata.h"
+#include "sanitize.h"
 
-#define INT_ROM_SIZE 4096
+// Largest on-chip ROM of any variant; sys->variant->rom_size is the real size
+#define INT_ROM_MAX 65536
 
 
 //  THE MOTHERBOARD
-typedef struct {
+struct system_8051 {
+    const cpu_variant_t *variant;
     cpu_core_t cpu;        
     peripherals_t sfr;        
+    irq_state_t irq;
+    uart_state_t uart;
+    debug_state_t dbg;
     uint8_t EA; //External access  
     
     // Internal RAM
     uint8_t iram[128 + 128]; //to handle indirect addressing (case where Rx contains value greater than 0x7F)
 
-    // External RAM
+    // External RAM, and the page map MOVX goes through
     uint8_t xram[65536]; 
+    xdata_page_t xdata[XDATA_PAGES];
     
     // CODE MEMORY
-    uint8_t irom[INT_ROM_SIZE]; 
+    uint8_t irom[INT_ROM_MAX]; 
 
     uint8_t xrom[65536]; 
 
-} system_8051_t;
+    // Port edge event stream (NULL = off)
+    portlog_t *portlog;
 
+    // Translated ROM blocks (NULL = interpret everything)
+    struct aot_map *aot;
+
+    // Co-simulation node this system runs as (NULL = standalone)
+    struct cosim_node *cosim;
+
+    // Coverage maps (NULL = off)
+    struct coverage *cover;
+
+    // Names for addresses in output (NULL = none loaded)
+    struct symtab *syms;
+
+    // Per-step write journal for state diffs (NULL = off)
+    struct journal *journal;
+
+    // Shadow memory (only maintained with EMU_SANITIZE)
+    sanitize_state_t san;
+
+};
+
+// Power-on state, as a classic 8051. Select another variant before loading code.
 void system_reset(system_8051_t *sys);
+void system_set_variant(system_8051_t *sys, const cpu_variant_t *variant);
 
 uint8_t system_read_code(system_8051_t *sys, uint16_t address);
+void system_write_code(system_8051_t *sys, uint16_t address, uint8_t value);
 
 uint8_t system_read_iram(system_8051_t *sys, uint8_t address);
 void system_write_iram(system_8051_t *sys, uint8_t address, uint8_t value);
 
+// MOVX through the XDATA page map (device pages have side effects)
 uint8_t system_read_xram(system_8051_t *sys, uint16_t address);
 void system_write_xram(system_8051_t *sys, uint16_t address, uint8_t value);
 
-void cpu_step(system_8051_t *sys);
+// Direct-address SFR access with all side effects (0x80-0xFF)
+uint8_t sfr_read(system_8051_t *sys, uint8_t address);
+void sfr_write(system_8051_t *sys, uint8_t address, uint8_t value);
+
+// The CPU is stepped through sys->variant->step (or step_watch, which also
+// checks watchpoints and fills the journal)
 
 void peripherals_step(system_8051_t *sys, uint64_t step_cycles);
 
+// Clocks until a timer or the serial port next does something that could
+// end idle mode (`wake` holds the interrupt sources that would be taken),
+// RUN_NO_LIMIT if nothing will
+uint64_t peripherals_next_event(system_8051_t *sys, uint8_t wake);
+
+// Ticks until a timer in modes 0-2 overflows next, and the clocks that
+// many ticks take from now
+uint64_t peripherals_timer_ticks(uint8_t mode, uint8_t tl, uint8_t th);
+uint64_t peripherals_ticks_clocks(system_8051_t *sys, uint64_t ticks);
+
+// Interrupt controller: call interrupt_update() whenever IE, IP, TCON, SCON or
+// PSW change; the run loop only calls interrupt_dispatch() if irq.pending is set.
+void interrupt_update(system_8051_t *sys);
+void interrupt_pins(system_8051_t *sys, uint8_t old_p3);
+void interrupt_dispatch(system_8051_t *sys);
+void interrupt_reti(system_8051_t *sys);
+void interrupt_print_stats(system_8051_t *sys);
+uint8_t interrupt_wake_sources(system_8051_t *sys);
+
+// Serial port. uart_step() is driven by peripherals_step() with the clocks
+// and Timer 1/Timer 2 overflows of the step.
+void uart_bind(system_8051_t *sys, spsc_t *txq, spsc_t *rxq);
+void uart_write_sbuf(system_8051_t *sys, uint8_t value);
+void uart_step(system_8051_t *sys, uint64_t step_cycles, uint64_t t1_overflows, uint64_t t2_overflows);
+uint64_t uart_next_event(system_8051_t *sys, int can_wake);
+
+// Breakpoints and watchpoints
+void debug_set_breakpoint(system_8051_t *sys, uint16_t addr);
+void debug_clear_breakpoint(system_8051_t *sys, uint16_t addr);
+int debug_add_watch(system_8051_t *sys, uint8_t space, uint16_t addr, uint16_t len, uint8_t type);
+int debug_remove_watch(system_8051_t *sys, uint8_t space, uint16_t addr, uint8_t type);
+void debug_clear_all(system_8051_t *sys);
+void debug_watch_check(system_8051_t *sys, uint8_t space, uint16_t addr, uint8_t type, uint8_t value);
+void debug_print_hit(system_8051_t *sys);
+
+// Executes one instruction and advances the peripherals by its cycles. In
+// idle or power-down, advances one machine cycle instead.
+uint64_t system_step(system_8051_t *sys);
+
+// True when the CPU sits on an SJMP $ (the usual end-of-program idiom)
+int system_halted(system_8051_t *sys);
+
+// Why system_run() returned
+typedef enum {
+    RUN_LIMIT,          // Instruction or cycle limit reached
+    RUN_HALT,           // SJMP $, or idle/power-down with nothing left to wake the core
+    RUN_BREAKPOINT,     // PC hit a breakpoint (not executed yet)
+    RUN_WATCHPOINT      // A watched access happened (instruction completed)
+} run_result_t;
+
+#define RUN_NO_LIMIT UINT64_MAX
+
+// Runs until max_instructions have executed, sys->cpu.cycles reaches
+// cycle_limit, or a stop condition. A breakpoint on the starting PC is
+// stepped over so that repeated calls make progress. Idle and power-down
+// (PCON.IDL/PD) skip straight to the next event that could end them.
+run_result_t system_run(system_8051_t *sys, uint64_t max_instructions, uint64_t cycle_limit);
+
 #endif
\ No newline at end of file
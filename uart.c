@@ -0,0 +1,165 @@
+// Serial port: modes 0-3 with TI/RI timing from the oscillator, Timer 1 or Timer 2
+#include "system.h"
+#include "cosim.h"
+#include <sched.h>
+
+static int uart_mode(system_8051_t *sys) {
+    return sys->sfr.SCON >> 6;
+}
+
+// Length of one frame in the units uart_step() counts for this mode
+static uint32_t uart_frame_units(system_8051_t *sys, int mode) {
+    int smod = (sys->sfr.PCON & PCON_SMOD) ? 1 : 0;
+    uint32_t tick = sys->variant->timer_clocks;
+
+    switch (mode) {
+        case UART_MODE0: return 8 * tick;                            // 8 bits, one per timer tick
+        case UART_MODE1: return 10 * UART_BIT_UNITS;                 // start + 8 + stop
+        case UART_MODE2: return 11 * (smod ? 32 : 64) * tick / 12;   // start + 9 + stop
+        default:         return 11 * UART_BIT_UNITS;
+    }
+}
+
+// Baud units for modes 1/3: Timer 1 needs 32 overflows per bit (16 with
+// SMOD), Timer 2 always 16
+static uint64_t uart_baud_units(system_8051_t *sys, int use_t2, uint64_t t1_overflows, uint64_t t2_overflows) {
+    if (use_t2) return t2_overflows * 2;
+    return (sys->sfr.PCON & PCON_SMOD) ? t1_overflows * 2 : t1_overflows;
+}
+
+void uart_bind(system_8051_t *sys, spsc_t *txq, spsc_t *rxq) {
+    sys->uart.txq = txq;
+    sys->uart.rxq = rxq;
+}
+
+// A write to SBUF starts a transmission
+void uart_write_sbuf(system_8051_t *sys, uint8_t value) {
+    sys->uart.tx_busy = 1;
+    sys->uart.tx_data = value;
+    sys->uart.tx_left = uart_frame_units(sys, uart_mode(sys));
+}
+
+static void uart_emit(system_8051_t *sys, uint8_t byte) {
+    uart_state_t *uart = &sys->uart;
+    uart->tx_bytes++;
+    if (sys->cosim) cosim_uart_tx(sys, byte);
+    if (uart->txq == NULL) return;
+
+    // Only blocks if the host side is a full queue behind
+    while (!spsc_push(uart->txq, &byte)) sched_yield();
+}
+
+// Delivers a received frame into SBUF, honouring SM2 in the 9-bit modes
+static void uart_receive(system_8051_t *sys, int mode) {
+    sys->uart.rx_bytes++;
+
+    if (mode == UART_MODE0) {
+        sys->sfr.SBUF = sys->uart.rx_data;
+        sys->sfr.SCON |= SCON_RI;
+        return;
+    }
+
+    // Host bytes carry no 9th bit; it (or the stop bit) always reads as 1,
+    // so SM2 never suppresses RI
+    sys->sfr.SBUF = sys->uart.rx_data;
+    sys->sfr.SCON |= SCON_RB8 | SCON_RI;
+}
+
+// The receiver only starts a frame once software has consumed the last
+// one, so a host stream never overruns SBUF
+static void uart_rx_start(system_8051_t *sys, int mode) {
+    uart_state_t *uart = &sys->uart;
+    if (uart->rxq == NULL) return;
+    if (!(sys->sfr.SCON & SCON_REN) || (sys->sfr.SCON & SCON_RI)) return;
+    if (!spsc_pop(uart->rxq, &uart->rx_data)) return;
+
+    uart->rx_busy = 1;
+    uart->rx_left = uart_frame_units(sys, mode);
+}
+
+// Clocks until `units` more units have passed in the current mode, from the
+// current timer state. Timer 1 is only followed exactly in mode 2 (the baud
+// rate mode); in other modes this is its next overflow, which is early.
+static uint64_t uart_units_clocks(system_8051_t *sys, int mode, int use_t2, uint32_t units) {
+    if (mode == UART_MODE0 || mode == UART_MODE2) return units;
+
+    if (use_t2) {
+        // Two units per overflow, counting at fosc/2
+        uint32_t value = ((uint32_t)sys->sfr.TH2 << 8) | sys->sfr.TL2;
+        uint32_t reload = ((uint32_t)sys->sfr.RCAP2H << 8) | sys->sfr.RCAP2L;
+        if (!(sys->sfr.T2CON & T2CON_TR2)) return RUN_NO_LIMIT;
+        uint64_t overflows = (units + 1) / 2;
+        return 2 * ((0x10000 - value) + (overflows - 1) * (0x10000 - reload)) - sys->sfr.t2_clock_rem;
+    }
+
+    // Timer 1 runs without TR1 while Timer 0 is in mode 3
+    uint8_t t1_mode = (sys->sfr.TMOD >> 4) & 0x03;
+    if (t1_mode == 0x03 || (!(sys->sfr.TCON & TCON_TR1) && (sys->sfr.TMOD & 0x03) != 0x03)) return RUN_NO_LIMIT;
+    if (t1_mode != 2) return peripherals_ticks_clocks(sys, peripherals_timer_ticks(t1_mode, sys->sfr.TL1, sys->sfr.TH1));
+    uint32_t per_overflow = (sys->sfr.PCON & PCON_SMOD) ? 2 : 1;
+    uint64_t overflows = (units + per_overflow - 1) / per_overflow;
+    return peripherals_ticks_clocks(sys, (0x100 - sys->sfr.TL1) + (overflows - 1) * (0x100 - sys->sfr.TH1));
+}
+
+uint64_t uart_next_event(system_8051_t *sys, int can_wake) {
+    uart_state_t *uart = &sys->uart;
+    int mode = uart_mode(sys);
+    uint8_t t2con = sys->variant->has_timer2 ? sys->sfr.T2CON : 0;
+    uint64_t next = RUN_NO_LIMIT;
+    uint64_t clocks;
+
+    // Frames end on time even when RI/TI cannot interrupt: the bytes leave
+    // for the host or other nodes when they are sent
+    if (uart->tx_busy) next = uart_units_clocks(sys, mode, t2con & T2CON_TCLK, uart->tx_left);
+    if (uart->rx_busy && (clocks = uart_units_clocks(sys, mode, t2con & T2CON_RCLK, uart->rx_left)) < next) next = clocks;
+
+    // A host byte can arrive at any time: look again once per frame
+    if (can_wake && !uart->rx_busy && uart->rxq && (sys->sfr.SCON & SCON_REN) && !(sys->sfr.SCON & SCON_RI) &&
+        (clocks = uart_units_clocks(sys, mode, t2con & T2CON_RCLK, uart_frame_units(sys, mode))) < next) {
+        next = clocks;
+    }
+    return next;
+}
+
+void uart_step(system_8051_t *sys, uint64_t step_cycles, uint64_t t1_overflows, uint64_t t2_overflows) {
+    uart_state_t *uart = &sys->uart;
+    int mode = uart_mode(sys);
+    uint64_t tx_units = step_cycles;
+    uint64_t rx_units = step_cycles;
+    int flags_set = 0;
+
+    if (mode == UART_MODE1 || mode == UART_MODE3) {
+        uint8_t t2con = sys->variant->has_timer2 ? sys->sfr.T2CON : 0;
+        tx_units = uart_baud_units(sys, t2con & T2CON_TCLK, t1_overflows, t2_overflows);
+        rx_units = uart_baud_units(sys, t2con & T2CON_RCLK, t1_overflows, t2_overflows);
+    }
+
+    if (uart->tx_busy) {
+        if (tx_units >= uart->tx_left) {
+            uart->tx_busy = 0;
+            uart->tx_left = 0;      // The same however the clocks were batched
+            uart_emit(sys, uart->tx_data);
+            sys->sfr.SCON |= SCON_TI;
+            flags_set = 1;
+        }
+        else {
+            uart->tx_left -= tx_units;
+        }
+    }
+
+    if (uart->rx_busy) {
+        if (rx_units >= uart->rx_left) {
+            uart->rx_busy = 0;
+            uart->rx_left = 0;
+            uart_receive(sys, mode);
+            flags_set = 1;
+        }
+        else {
+            uart->rx_left -= rx_units;
+        }
+    }
+
+    if (!uart->rx_busy) uart_rx_start(sys, mode);
+
+    if (flags_set) interrupt_update(sys);
+}
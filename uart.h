@@ -0,0 +1,39 @@
+#ifndef UART_H
+#define UART_H
+
+#include <stdint.h>
+#include "spsc.h"
+
+// Serial modes (SCON.SM0:SM1)
+#define UART_MODE0 0    // Shift register, fosc/12
+#define UART_MODE1 1    // 8-bit UART, Timer 1 (or Timer 2) baud
+#define UART_MODE2 2    // 9-bit UART, fosc/64 or fosc/32
+#define UART_MODE3 3    // 9-bit UART, Timer 1 (or Timer 2) baud
+
+// Baud units per bit in modes 1 and 3
+#define UART_BIT_UNITS 32
+
+// PCON.SMOD doubles the baud rate in modes 1, 2 and 3
+#define PCON_SMOD 0x80
+
+typedef struct {
+    // Frames in flight. "left" is in clocks for modes 0/2 and in
+    // 1/UART_BIT_UNITS of a bit for modes 1/3.
+    uint8_t tx_busy;
+    uint8_t tx_data;
+    uint32_t tx_left;
+
+    uint8_t rx_busy;
+    uint8_t rx_data;
+    uint32_t rx_left;
+
+    // Host side (NULL when the port is not bound). The CPU thread is the
+    // producer of txq and the consumer of rxq.
+    spsc_t *txq;
+    spsc_t *rxq;
+
+    uint64_t tx_bytes;
+    uint64_t rx_bytes;
+} uart_state_t;
+
+#endif
@@ -0,0 +1,28 @@
+#include <stdio.h>
+#include "system.h"
+
+void xdata_map_ram(system_8051_t *sys, uint16_t first_page, uint16_t pages) {
+    for (uint32_t p = first_page; p < (uint32_t)first_page + pages && p < XDATA_PAGES; p++) {
+        xdata_page_t *page = &sys->xdata[p];
+        page->mem = &sys->xram[p << XDATA_PAGE_SHIFT];
+        page->read = NULL;
+        page->write = NULL;
+        page->ctx = NULL;
+    }
+}
+
+int xdata_map_device(system_8051_t *sys, uint16_t first_page, uint16_t pages,
+                     xdata_read_fn read, xdata_write_fn write, void *ctx) {
+    if (pages == 0 || (uint32_t)first_page + pages > XDATA_PAGES) {
+        printf("XDATA pages 0x%02X+%u out of range\n", first_page, pages);
+        return 1;
+    }
+    for (uint32_t p = first_page; p < (uint32_t)first_page + pages; p++) {
+        xdata_page_t *page = &sys->xdata[p];
+        page->mem = NULL;
+        page->read = read;
+        page->write = write;
+        page->ctx = ctx;
+    }
+    return 0;
+}
@@ -0,0 +1,32 @@
+#ifndef XDATA_H
+#define XDATA_H
+
+#include <stdint.h>
+
+// XDATA bus: 256 pages of 256 bytes. A RAM page is a direct pointer into the
+// backing store; a device page dispatches MOVX accesses to callbacks, so
+// memory-mapped LCDs, ADCs or FIFOs cost nothing on the RAM pages.
+#define XDATA_PAGE_SHIFT 8
+#define XDATA_PAGES      256
+
+typedef struct system_8051 system_8051_t;
+
+// `address` is the full 16-bit MOVX address
+typedef uint8_t (*xdata_read_fn)(void *ctx, uint16_t address);
+typedef void (*xdata_write_fn)(void *ctx, uint16_t address, uint8_t value);
+
+typedef struct {
+    uint8_t *mem;           // Start of the page in RAM, NULL for a device
+    xdata_read_fn read;     // NULL reads float high (0xFF)
+    xdata_write_fn write;   // NULL drops writes
+    void *ctx;
+} xdata_page_t;
+
+// Maps pages back to sys->xram (the power-on state for all 256)
+void xdata_map_ram(system_8051_t *sys, uint16_t first_page, uint16_t pages);
+
+// Hands pages to a device. Returns 1 if the range does not fit.
+int xdata_map_device(system_8051_t *sys, uint16_t first_page, uint16_t pages,
+                     xdata_read_fn read, xdata_write_fn write, void *ctx);
+
+#endif